@@ -7,6 +7,8 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <fmt/chrono.h>
 
+#include <fstream>
+
 using namespace hitagi::math;
 using namespace hitagi::asset;
 using namespace std::literals;
@@ -34,6 +36,7 @@ void Editor::Tick() {
         FileImporter();
         SceneGraphViewer();
         SceneNodeModifier();
+        EcsMemoryViewer();
     });
 
     RuntimeModule::Tick();
@@ -251,6 +254,7 @@ void Editor::SceneNodeModifier() {
                             transform.rotation                                   = local_rotation;
                             transform.scaling                                    = local_scaling;
                         }
+                        m_SelectedEntity.MarkChanged<asset::Transform>();
 
                         ImGui::EndTabItem();
                     }
@@ -371,4 +375,73 @@ void Editor::AssetExplorer() {
     ImGui::End();
 }
 
+void Editor::EcsMemoryViewer() {
+    if (ImGui::Begin("ECS Memory")) {
+        auto scene = m_SceneViewPort->GetScene();
+        if (!scene) {
+            ImGui::Text("No Scene");
+            ImGui::End();
+            return;
+        }
+
+        const auto report = scene->GetWorld().GetEntityManager().GetMemoryReport();
+        ImGui::Text("Total: %.2f MiB | Pooled chunks: %zu (%.2f MiB)",
+                    static_cast<float>(report.total_bytes) / (1 << 20),
+                    report.chunk_pool.num_free_chunks,
+                    static_cast<float>(report.chunk_pool.free_memory) / (1 << 20));
+        ImGui::SameLine();
+        if (ImGui::Button("Dump JSON")) {
+            std::ofstream("ecs_memory.json") << report.ToJson();
+        }
+
+        constexpr ImGuiTableFlags table_flags =
+            ImGuiTableFlags_Resizable |
+            ImGuiTableFlags_RowBg |
+            ImGuiTableFlags_BordersInnerV;
+
+        if (ImGui::BeginTable("Archetypes", 5, table_flags)) {
+            ImGui::TableSetupColumn("Archetype", ImGuiTableColumnFlags_NoHide);
+            ImGui::TableSetupColumn("Chunks");
+            ImGui::TableSetupColumn("Entities");
+            ImGui::TableSetupColumn("Utilization");
+            ImGui::TableSetupColumn("Bytes");
+            ImGui::TableHeadersRow();
+
+            for (std::size_t index = 0; const auto& archetype : report.archetypes) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                const bool node_open = ImGui::TreeNodeEx(fmt::format("Archetype {}", index++).c_str(), ImGuiTreeNodeFlags_SpanFullWidth);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%zu x %zu KiB", archetype.num_chunks, archetype.chunk_size >> 10);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%zu", archetype.num_entities);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.1f%%", archetype.utilization * 100.0);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("padding %zu", archetype.padding_bytes);
+
+                if (node_open) {
+                    for (const auto& component : archetype.components) {
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0);
+                        ImGui::TreeNodeEx(component.name.c_str(), ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanFullWidth);
+                        ImGui::TableSetColumnIndex(4);
+                        ImGui::Text("%zu / %zu", component.used_bytes, component.reserved_bytes);
+                    }
+                    ImGui::TreePop();
+                }
+            }
+            for (const auto& component : report.sparse_components) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("Sparse %s", component.name.c_str());
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%zu / %zu", component.used_bytes, component.reserved_bytes);
+            }
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
 }  // namespace hitagi
\ No newline at end of file
@@ -17,6 +17,7 @@ private:
     void SceneGraphViewer();
     void SceneNodeModifier();
     void AssetExplorer();
+    void EcsMemoryViewer();
 
     Engine&      m_Engine;
     Application& m_App;
@@ -49,6 +49,7 @@ void SceneViewPort::MoveCamera() const {
             const auto mouse_delta = math::vec2f{input_manager.GetFloatDelta(hid::MouseEvent::MOVE_X), input_manager.GetFloatDelta(hid::MouseEvent::MOVE_Y)};
             camera_transform.Rotate(get_rotation(math::rotate_z(-mouse_delta.x * 0.01f) * math::rotate_x(-mouse_delta.y * 0.01f)));
         }
+        camera.MarkChanged<asset::Transform>();
     }
 }
 
@@ -69,6 +69,9 @@ auto main(int argc, char** argv) -> int {
 
                 ImGui::DragFloat3("Camera position", camera_transform.position, 0.01);
                 ImGui::DragFloat3("Camera eye", camera->parameters.eye, 0.01);
+
+                cube.MarkChanged<asset::Transform>();
+                camera_entity.MarkChanged<asset::Transform>();
             }
             ImGui::End();
         });
@@ -1,5 +1,6 @@
 #pragma once
 #include <hitagi/asset/resource.hpp>
+#include <hitagi/ecs/component.hpp>
 #include <hitagi/math/transform.hpp>
 #include <hitagi/gfx/common_types.hpp>
 
@@ -22,7 +23,20 @@ public:
 };
 
 struct CameraComponent {
+    constexpr static auto storage = ecs::ComponentStorage::Shared;
+
+    bool operator==(const CameraComponent&) const = default;
+
     std::shared_ptr<Camera> camera;
 };
 
-}  // namespace hitagi::asset
\ No newline at end of file
+}  // namespace hitagi::asset
+
+namespace std {
+template <>
+struct hash<hitagi::asset::CameraComponent> {
+    std::size_t operator()(const hitagi::asset::CameraComponent& component) const noexcept {
+        return std::hash<std::shared_ptr<hitagi::asset::Camera>>{}(component.camera);
+    }
+};
+}  // namespace std
\ No newline at end of file
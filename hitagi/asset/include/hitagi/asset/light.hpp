@@ -1,5 +1,6 @@
 #pragma once
 #include <hitagi/asset/resource.hpp>
+#include <hitagi/ecs/component.hpp>
 #include <hitagi/math/transform.hpp>
 
 namespace hitagi::asset {
@@ -27,7 +28,20 @@ public:
 };
 
 struct LightComponent {
+    constexpr static auto storage = ecs::ComponentStorage::Shared;
+
+    bool operator==(const LightComponent&) const = default;
+
     std::shared_ptr<Light> light;
 };
 
 }  // namespace hitagi::asset
+
+namespace std {
+template <>
+struct hash<hitagi::asset::LightComponent> {
+    std::size_t operator()(const hitagi::asset::LightComponent& component) const noexcept {
+        return std::hash<std::shared_ptr<hitagi::asset::Light>>{}(component.light);
+    }
+};
+}  // namespace std
@@ -1,5 +1,6 @@
 #pragma once
 #include <hitagi/asset/resource.hpp>
+#include <hitagi/ecs/component.hpp>
 #include <hitagi/core/buffer.hpp>
 #include <hitagi/math/vector.hpp>
 #include <hitagi/gfx/gpu_resource.hpp>
@@ -221,7 +222,12 @@ public:
     std::shared_ptr<IndexArray>  indices;
 };
 
+// entities referencing the same mesh share one component, so they are batched by chunk
 struct MeshComponent {
+    constexpr static auto storage = ecs::ComponentStorage::Shared;
+
+    bool operator==(const MeshComponent&) const = default;
+
     std::shared_ptr<Mesh> mesh;
 };
 
@@ -266,4 +272,13 @@ void IndexArray::Modify(std::function<void(std::span<IndexDataType<T>>)> modifie
     m_Data.dirty = true;
 }
 
-}  // namespace hitagi::asset
\ No newline at end of file
+}  // namespace hitagi::asset
+
+namespace std {
+template <>
+struct hash<hitagi::asset::MeshComponent> {
+    std::size_t operator()(const hitagi::asset::MeshComponent& component) const noexcept {
+        return std::hash<std::shared_ptr<hitagi::asset::Mesh>>{}(component.mesh);
+    }
+};
+}  // namespace std
\ No newline at end of file
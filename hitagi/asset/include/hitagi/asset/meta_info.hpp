@@ -1,4 +1,5 @@
 #include <hitagi/ecs/component.hpp>
+#include <hitagi/ecs/snapshot.hpp>
 
 #include <fmt/format.h>
 
@@ -7,7 +8,11 @@ struct MetaInfo {
     MetaInfo(std::string_view name) : name(name) {}
 
     std::pmr::string name;
+
+    inline void Serialize(ecs::SnapshotWriter& writer) const { writer.Write(name); }
+    inline static auto Deserialize(ecs::SnapshotReader& reader) -> MetaInfo { return {reader.ReadString()}; }
 };
 static_assert(ecs::Component<MetaInfo>);
+static_assert(ecs::SerializableComponent<MetaInfo>);
 
 }  // namespace hitagi::asset
\ No newline at end of file
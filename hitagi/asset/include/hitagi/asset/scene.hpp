@@ -30,6 +30,10 @@ public:
     auto GetWorld() noexcept -> ecs::World& { return m_World; }
 
 private:
+    // spawn the entity with all its components at once, so it is allocated in the final archetype directly
+    template <ecs::Component... Components>
+    auto CreateEntity(math::mat4f transform, ecs::Entity parent, std::string_view name, Components... components) -> ecs::Entity;
+
     ecs::World m_World;
 
     ecs::Entity m_CurrentCamera;
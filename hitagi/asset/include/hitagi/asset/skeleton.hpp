@@ -1,5 +1,6 @@
 #pragma once
 #include <hitagi/asset/resource.hpp>
+#include <hitagi/ecs/component.hpp>
 #include <hitagi/math/transform.hpp>
 
 namespace hitagi::asset {
@@ -18,7 +19,20 @@ struct Skeleton : public Resource {
 };
 
 struct SkeletonComponent {
+    constexpr static auto storage = ecs::ComponentStorage::Shared;
+
+    bool operator==(const SkeletonComponent&) const = default;
+
     std::shared_ptr<Skeleton> skeleton;
 };
 
-}  // namespace hitagi::asset
\ No newline at end of file
+}  // namespace hitagi::asset
+
+namespace std {
+template <>
+struct hash<hitagi::asset::SkeletonComponent> {
+    std::size_t operator()(const hitagi::asset::SkeletonComponent& component) const noexcept {
+        return std::hash<std::shared_ptr<hitagi::asset::Skeleton>>{}(component.skeleton);
+    }
+};
+}  // namespace std
\ No newline at end of file
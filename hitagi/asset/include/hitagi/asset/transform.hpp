@@ -1,27 +1,90 @@
 #pragma once
 #include <hitagi/ecs/entity.hpp>
 #include <hitagi/ecs/schedule.hpp>
+#include <hitagi/ecs/prefab.hpp>
+#include <hitagi/ecs/snapshot.hpp>
 #include <hitagi/math/transform.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <span>
 #include <unordered_set>
 
 namespace hitagi::asset {
 
+// Children are linked by first-child/next-sibling links stored in the components themselves,
+// so the component is trivially copyable and moving it between archetypes is a `memcpy`.
 struct RelationShip {
+    class ChildIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = ecs::Entity;
+        using difference_type   = std::ptrdiff_t;
+
+        ChildIterator() = default;
+        ChildIterator(ecs::Entity child) : m_Child(child) {}
+
+        inline auto operator*() const noexcept { return m_Child; }
+        inline auto operator++() -> ChildIterator& {
+            m_Child = m_Child.Get<RelationShip>().next_sibling;
+            return *this;
+        }
+        inline auto operator++(int) -> ChildIterator {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+        inline bool operator==(const ChildIterator&) const noexcept = default;
+
+    private:
+        ecs::Entity m_Child;
+    };
+
+    class Children {
+    public:
+        Children(const RelationShip& relation_ship) : m_RelationShip(relation_ship) {}
+
+        inline auto begin() const noexcept { return ChildIterator(m_RelationShip.first_child); }
+        inline auto end() const noexcept { return ChildIterator(); }
+        inline auto size() const noexcept { return m_RelationShip.num_children; }
+        inline bool empty() const noexcept { return m_RelationShip.num_children == 0; }
+        inline bool contains(ecs::Entity entity) const { return std::find(begin(), end(), entity) != end(); }
+
+    private:
+        const RelationShip& m_RelationShip;
+    };
+
     RelationShip(ecs::Entity parent = {}) : parent(parent) {}
 
-    ecs::Entity parent;
+    inline auto GetParent() const noexcept { return parent; }
+    inline auto GetChildren() const noexcept { return Children(*this); }
+
+    void        Serialize(ecs::SnapshotWriter& writer) const;
+    static auto Deserialize(ecs::SnapshotReader& reader) -> RelationShip;
 
-    const auto& GetChildren() const noexcept { return children; }
+    // the links out of the prefab are cleared, so the root of an instance is detached
+    void RemapEntities(const ecs::EntityRemap& remap);
 
 private:
     friend struct RelationShipSystem;
-    ecs::Entity                          prev_parent = {};
-    std::pmr::unordered_set<ecs::Entity> children;
+    ecs::Entity   parent;
+    ecs::Entity   prev_parent  = {};
+    ecs::Entity   first_child  = {};
+    ecs::Entity   next_sibling = {};
+    ecs::Entity   prev_sibling = {};
+    std::uint32_t num_children = 0;
 };
 static_assert(ecs::Component<RelationShip>);
+static_assert(ecs::SerializableComponent<RelationShip>);
+static_assert(ecs::EntityReferenceComponent<RelationShip>);
+static_assert(std::is_trivially_copyable_v<RelationShip>);
 
+// Links between parents and children are maintained only for the entities whose `RelationShip` is added or changed,
+// so static hierarchies cost nothing per frame.
 struct RelationShipSystem {
+    // Record the new parent of the entity, the children of both parents are updated in the next frame.
+    static void SetParent(ecs::Entity entity, ecs::Entity parent);
+
     static void OnUpdate(ecs::Schedule& schedule);
 };
 
@@ -35,6 +98,7 @@ struct Transform {
     math::quatf rotation;
     math::vec3f scaling;
 
+    math::mat4f local_matrix = math::mat4f::identity();
     math::mat4f world_matrix = math::mat4f::identity();
 
     inline void ApplyScale(float value) noexcept { scaling = value; }
@@ -42,9 +106,50 @@ struct Transform {
     inline void Rotate(const math::quatf& value) noexcept { rotation = value * rotation; }
 
     inline auto ToMatrix() const noexcept { return math::translate(position) * math::rotate(rotation) * math::scale(scaling); }
+
+private:
+    friend class TransformHierarchy;
+    friend struct TransformSystem;
+    // the local matrix is updated but not propagated to descendants yet
+    bool dirty = true;
+};
+
+// The nodes of all trees of `RelationShip` sorted by depth, parents always come before their children.
+// World matrices are propagated level by level, and the nodes in one level are updated in parallel.
+// It is only rebuilt when the parent of some entity changes.
+class TransformHierarchy {
+public:
+    inline auto NumNodes() const noexcept { return m_Nodes.size(); }
+    inline auto NumLevels() const noexcept { return m_LevelOffsets.empty() ? 0 : m_LevelOffsets.size() - 1; }
+
+    // it is a cache of `RelationShip`, so it is rebuilt after restored
+    inline void        Serialize(ecs::SnapshotWriter&) const {}
+    inline static auto Deserialize(ecs::SnapshotReader&) -> TransformHierarchy { return {}; }
+
+private:
+    friend struct TransformSystem;
+
+    // `entities` are the ones whose `RelationShip` may be changed
+    void Update(std::span<const ecs::Entity> entities);
+    void Rebuild();
+    void Propagate(ecs::World& world);
+
+    // roots which have at least one child
+    std::pmr::unordered_set<ecs::Entity> m_Roots;
+    bool                                 m_NeedRebuild = false;
+
+    std::pmr::vector<ecs::Entity>   m_Nodes;
+    std::pmr::vector<std::uint32_t> m_Parents;  // the index of parent in `m_Nodes`
+    std::pmr::vector<std::size_t>   m_LevelOffsets;
+
+    // scratch of propagation
+    std::pmr::vector<Transform*>   m_Transforms;
+    std::pmr::vector<std::uint8_t> m_Dirty;
 };
+static_assert(ecs::SerializableComponent<TransformHierarchy>);
 
 struct TransformSystem {
+    static void OnCreate(ecs::World& world);
     static void OnUpdate(ecs::Schedule& schedule);
 };
 
@@ -5,7 +5,9 @@
 namespace hitagi::asset {
 
 Scene::Scene(std::string_view name)
-    : Resource(Type::Scene, name), m_World(name) {
+    : Resource(Type::Scene, name),
+      // scene entities carry large components (transform, meta info and relationship), keep enough of them in a chunk
+      m_World(name, {.min_entities_per_chunk = 64}) {
     m_RootEntity = CreateEmptyEntity(math::mat4f::identity(), ecs::Entity(), name);
     m_World.GetSystemManager().Register<RelationShipSystem>();
     m_World.GetSystemManager().Register<TransformSystem>();
@@ -16,25 +18,13 @@ void Scene::Update() {
 }
 
 auto Scene::CreateEmptyEntity(math::mat4f transform, ecs::Entity parent, std::string_view name) -> ecs::Entity {
-    auto& em = m_World.GetEntityManager();
-
-    const auto [translation, rotation, scaling] = math::decompose(transform);
-    if (!parent && m_RootEntity) parent = m_RootEntity;
-
-    ecs::Entity entity = em.Create();
-    entity.Emplace<MetaInfo>(name);
-    entity.Emplace<Transform>(translation, rotation, scaling);
-    entity.Emplace<RelationShip>(parent);
-
-    return entity;
+    return CreateEntity(transform, parent, name);
 }
 
 auto Scene::CreateMeshEntity(std::shared_ptr<Mesh> mesh, math::mat4f transform, ecs::Entity parent, std::string_view name) -> ecs::Entity {
     assert(mesh != nullptr);
 
-    auto entity = CreateEmptyEntity(transform, parent, name);
-    entity.Emplace<MeshComponent>();
-    entity.Get<MeshComponent>().mesh = std::move(mesh);
+    auto entity = CreateEntity(transform, parent, name, MeshComponent{std::move(mesh)});
 
     return m_MeshEntities.emplace_back(entity);
 }
@@ -42,9 +32,7 @@ auto Scene::CreateMeshEntity(std::shared_ptr<Mesh> mesh, math::mat4f transform,
 auto Scene::CreateCameraEntity(std::shared_ptr<Camera> camera, math::mat4f transform, ecs::Entity parent, std::string_view name) -> ecs::Entity {
     assert(camera != nullptr);
 
-    auto entity = CreateEmptyEntity(transform, parent, name);
-    entity.Emplace<CameraComponent>();
-    entity.Get<CameraComponent>().camera = std::move(camera);
+    auto entity = CreateEntity(transform, parent, name, CameraComponent{std::move(camera)});
 
     m_CurrentCamera = entity;
     return m_CameraEntities.emplace_back(entity);
@@ -53,9 +41,7 @@ auto Scene::CreateCameraEntity(std::shared_ptr<Camera> camera, math::mat4f trans
 auto Scene::CreateLightEntity(std::shared_ptr<Light> light, math::mat4f transform, ecs::Entity parent, std::string_view name) -> ecs::Entity {
     assert(light != nullptr);
 
-    auto entity = CreateEmptyEntity(transform, parent, name);
-    entity.Emplace<LightComponent>();
-    entity.Get<LightComponent>().light = std::move(light);
+    auto entity = CreateEntity(transform, parent, name, LightComponent{std::move(light)});
 
     return m_LightEntities.emplace_back(entity);
 }
@@ -63,11 +49,19 @@ auto Scene::CreateLightEntity(std::shared_ptr<Light> light, math::mat4f transfor
 auto Scene::CreateSkeletonEntity(std::shared_ptr<Skeleton> skeleton, math::mat4f transform, ecs::Entity parent, std::string_view name) -> ecs::Entity {
     assert(skeleton != nullptr);
 
-    auto entity = CreateEmptyEntity(transform, parent, name);
-    entity.Emplace<SkeletonComponent>();
-    entity.Get<SkeletonComponent>().skeleton = std::move(skeleton);
+    return CreateEntity(transform, parent, name, SkeletonComponent{std::move(skeleton)});
+}
+
+template <ecs::Component... Components>
+auto Scene::CreateEntity(math::mat4f transform, ecs::Entity parent, std::string_view name, Components... components) -> ecs::Entity {
+    const auto [translation, rotation, scaling] = math::decompose(transform);
+    if (!parent && m_RootEntity) parent = m_RootEntity;
 
-    return entity;
+    return m_World.GetEntityManager().Spawn(
+        MetaInfo(name),
+        Transform(translation, rotation, scaling),
+        RelationShip(parent),
+        std::move(components)...);
 }
 
 }  // namespace hitagi::asset
\ No newline at end of file
@@ -4,52 +4,194 @@
 
 #include <spdlog/logger.h>
 
+#include <limits>
+
 namespace hitagi::asset {
 
+// the links are written as entity ids, since entities contain the pointer of entity manager
+void RelationShip::Serialize(ecs::SnapshotWriter& writer) const {
+    writer.Write(parent);
+    writer.Write(prev_parent);
+    writer.Write(first_child);
+    writer.Write(next_sibling);
+    writer.Write(prev_sibling);
+    writer.Write(num_children);
+}
+
+auto RelationShip::Deserialize(ecs::SnapshotReader& reader) -> RelationShip {
+    RelationShip result(reader.ReadEntity());
+    result.prev_parent  = reader.ReadEntity();
+    result.first_child  = reader.ReadEntity();
+    result.next_sibling = reader.ReadEntity();
+    result.prev_sibling = reader.ReadEntity();
+    result.num_children = reader.Read<std::uint32_t>();
+    return result;
+}
+
+void RelationShip::RemapEntities(const ecs::EntityRemap& remap) {
+    parent       = remap(parent);
+    prev_parent  = remap(prev_parent);
+    first_child  = remap(first_child);
+    next_sibling = remap(next_sibling);
+    prev_sibling = remap(prev_sibling);
+}
+
+void RelationShipSystem::SetParent(ecs::Entity entity, ecs::Entity parent) {
+    auto& relation_ship = entity.Get<RelationShip>();
+    if (relation_ship.parent == parent) return;
+
+    relation_ship.parent = parent;
+    entity.MarkChanged<RelationShip>();
+}
+
 void RelationShipSystem::OnUpdate(ecs::Schedule& schedule) {
-    schedule.Request("attach_parent", [](const ecs::Entity entity, RelationShip& relation_ship) {
-        if (relation_ship.prev_parent != relation_ship.parent) {  // parent changed
-            if (relation_ship.prev_parent) {
-                auto& prev_parent = relation_ship.prev_parent.Get<RelationShip>();
-                prev_parent.children.erase(entity);
+    // `RelationShip` is only written when the parent changed, so that only the chunks containing
+    // new or reparented entities are visited
+    schedule.Request("attach_parent", [](ecs::Entity entity, ecs::Changed<const RelationShip&> relation_ship) {
+        if (relation_ship->prev_parent != relation_ship->parent) {  // parent changed
+            auto& child = entity.Get<RelationShip>();
+            if (auto prev_parent = child.prev_parent; prev_parent) {
+                auto& prev_parent_relation_ship = prev_parent.Get<RelationShip>();
+                if (child.prev_sibling) {
+                    child.prev_sibling.Get<RelationShip>().next_sibling = child.next_sibling;
+                } else {
+                    prev_parent_relation_ship.first_child = child.next_sibling;
+                }
+                if (child.next_sibling) {
+                    child.next_sibling.Get<RelationShip>().prev_sibling = child.prev_sibling;
+                }
+                prev_parent_relation_ship.num_children--;
+                prev_parent.MarkChanged<RelationShip>();
             }
-            if (relation_ship.parent) {
-                auto& parent = relation_ship.parent.Get<RelationShip>();
-                parent.children.insert(entity);
+            child.prev_sibling = {};
+            child.next_sibling = {};
+
+            // push front
+            if (auto parent = child.parent; parent) {
+                auto& parent_relation_ship = parent.Get<RelationShip>();
+                if (parent_relation_ship.first_child) {
+                    parent_relation_ship.first_child.Get<RelationShip>().prev_sibling = entity;
+                }
+                child.next_sibling               = parent_relation_ship.first_child;
+                parent_relation_ship.first_child = entity;
+                parent_relation_ship.num_children++;
+                parent.MarkChanged<RelationShip>();
             }
-            relation_ship.prev_parent = relation_ship.parent;
+            child.prev_parent = child.parent;
+            entity.MarkChanged<RelationShip>();
+            // the world matrix depends on the new parent
+            entity.MarkChanged<Transform>();
         }
     });
 }
 
+void TransformHierarchy::Update(std::span<const ecs::Entity> entities) {
+    for (auto entity : entities) {
+        const auto& relation_ship = entity.Get<RelationShip>();
+        if (!relation_ship.GetParent() && !relation_ship.GetChildren().empty()) {
+            m_Roots.emplace(entity);
+        } else {
+            m_Roots.erase(entity);
+        }
+    }
+    m_NeedRebuild |= !entities.empty();
+}
+
+void TransformHierarchy::Rebuild() {
+    m_Nodes.clear();
+    m_Parents.clear();
+    m_LevelOffsets.clear();
+
+    std::erase_if(m_Roots, [](const ecs::Entity& root) { return !root.Valid(); });
+
+    constexpr auto no_parent = std::numeric_limits<std::uint32_t>::max();
+    for (auto root : m_Roots) {
+        if (!root.Has<Transform>()) continue;
+        m_Nodes.emplace_back(root);
+        m_Parents.emplace_back(no_parent);
+    }
+
+    // breadth first, so the nodes are sorted by depth
+    std::size_t level_begin = 0;
+    while (level_begin != m_Nodes.size()) {
+        m_LevelOffsets.emplace_back(level_begin);
+        const auto level_end = m_Nodes.size();
+        for (auto index = level_begin; index < level_end; index++) {
+            for (auto child : m_Nodes[index].Get<RelationShip>().GetChildren()) {
+                if (!child.Valid() || !child.Has<Transform>()) continue;
+                m_Nodes.emplace_back(child);
+                m_Parents.emplace_back(static_cast<std::uint32_t>(index));
+            }
+        }
+        level_begin = level_end;
+    }
+    m_LevelOffsets.emplace_back(m_Nodes.size());
+
+    m_NeedRebuild = false;
+}
+
+void TransformHierarchy::Propagate(ecs::World& world) {
+    if (m_NeedRebuild) Rebuild();
+    if (m_Nodes.empty()) return;
+
+    m_Transforms.resize(m_Nodes.size());
+    m_Dirty.resize(m_Nodes.size());
+
+    // roots, their world matrices are the local matrices
+    for (std::size_t index = m_LevelOffsets[0]; index < m_LevelOffsets[1]; index++) {
+        auto& transform     = m_Nodes[index].Get<Transform>();
+        m_Transforms[index] = &transform;
+        m_Dirty[index]      = transform.dirty;
+        transform.dirty     = false;
+    }
+
+    for (std::size_t level = 1; level < NumLevels(); level++) {
+        const auto offset = m_LevelOffsets[level];
+        world.ParallelFor(m_LevelOffsets[level + 1] - offset, [&](std::size_t index) {
+            index += offset;
+            auto& transform     = m_Nodes[index].Get<Transform>();
+            m_Transforms[index] = &transform;
+            m_Dirty[index]      = transform.dirty || m_Dirty[m_Parents[index]];
+            if (m_Dirty[index]) {
+                transform.world_matrix = m_Transforms[m_Parents[index]]->world_matrix * transform.local_matrix;
+            }
+            transform.dirty = false;
+        });
+    }
+}
+
+void TransformSystem::OnCreate(ecs::World& world) {
+    world.GetEntityManager().Spawn(TransformHierarchy{});
+}
+
 void TransformSystem::OnUpdate(ecs::Schedule& schedule) {
-    schedule.SetOrder("attach_parent", "update_world_matrix_from_root");
+    schedule.SetOrder("attach_parent", "update_local_matrix");
+    schedule.SetOrder("attach_parent", "collect_relation_ship_changes");
+    schedule.SetOrder("update_local_matrix", "update_world_matrix");
+    schedule.SetOrder("collect_relation_ship_changes", "update_world_matrix");
+
+    // the entities whose relation ship changed in this frame
+    auto changed_entities = std::make_shared<std::pmr::vector<ecs::Entity>>();
 
     schedule
         .Request(
             "update_local_matrix",
-            [](Transform& transform) {
-                transform.world_matrix = transform.ToMatrix();
+            [](ecs::Changed<Transform&> transform) {
+                transform->local_matrix = transform->ToMatrix();
+                transform->world_matrix = transform->local_matrix;
+                transform->dirty        = true;
             })
         .Request(
-            "update_world_matrix_from_root",
-            [](const Transform& transform, const RelationShip& relation_ship) {
-                const std::function<void(ecs::Entity, const math::mat4f)> recursive_update =
-                    [&](ecs::Entity entity, const math::mat4f parent_transform) {
-                        auto& transform        = entity.Get<Transform>();
-                        transform.world_matrix = parent_transform * transform.world_matrix;
-                        for (auto child : entity.Get<RelationShip>().GetChildren()) {
-                            recursive_update(child, transform.world_matrix);
-                        }
-                    };
-
-                // root entity
-                if (!relation_ship.parent) {
-                    for (auto entity : relation_ship.GetChildren()) {
-                        recursive_update(entity, transform.world_matrix);
-                    }
-                }
+            "collect_relation_ship_changes",
+            [=](ecs::Entity entity, ecs::Changed<const RelationShip&>) {
+                changed_entities->emplace_back(entity);
+            })
+        .Request(
+            "update_world_matrix",
+            [=, &world = schedule.world](TransformHierarchy& hierarchy) {
+                hierarchy.Update(*changed_entities);
+                hierarchy.Propagate(world);
             });
 }
 
-}  // namespace hitagi::asset
\ No newline at end of file
+}  // namespace hitagi::asset
@@ -30,10 +30,10 @@ TEST_F(RelationShipSystemTest, UpdateChildren) {
 
     world.Update();
 
-    EXPECT_EQ(entities[1].Get<RelationShip>().parent, entities[0])
+    EXPECT_EQ(entities[1].Get<RelationShip>().GetParent(), entities[0])
         << "the parent of entities[1] should be entities[0] after update";
 
-    EXPECT_EQ(entities[2].Get<RelationShip>().parent, entities[1])
+    EXPECT_EQ(entities[2].Get<RelationShip>().GetParent(), entities[1])
         << "the parent of entities[2] should be entities[1] after update";
 
     ASSERT_TRUE(entities[0].Get<RelationShip>().GetChildren().contains(entities[1]))
@@ -43,6 +43,79 @@ TEST_F(RelationShipSystemTest, UpdateChildren) {
         << "entities[2] should be in the children of entities[1] after update";
 }
 
+TEST_F(RelationShipSystemTest, RestoreFromSnapshot) {
+    auto entities = em.CreateMany<RelationShip>(2);
+    RelationShipSystem::SetParent(entities[1], entities[0]);
+    world.Update();
+
+    const auto snapshot = em.TakeSnapshot();
+    ASSERT_TRUE(snapshot.IsPersistable());
+
+    RelationShipSystem::SetParent(entities[1], {});
+    world.Update();
+    ASSERT_TRUE(entities[0].Get<RelationShip>().GetChildren().empty());
+
+    em.Restore(ecs::Snapshot(snapshot.GetData()));
+
+    EXPECT_EQ(entities[1].Get<RelationShip>().GetParent(), entities[0]);
+    EXPECT_TRUE(entities[0].Get<RelationShip>().GetChildren().contains(entities[1]));
+
+    world.Update();
+    EXPECT_TRUE(entities[0].Get<RelationShip>().GetChildren().contains(entities[1]))
+        << "the restored relationship should not be attached again";
+}
+
+TEST_F(RelationShipSystemTest, RemoveChildFromSiblings) {
+    auto parent   = em.Spawn(RelationShip());
+    auto children = em.SpawnBatch(3, [&](std::size_t) { return std::tuple{RelationShip(parent)}; });
+    world.Update();
+
+    ASSERT_EQ(parent.Get<RelationShip>().GetChildren().size(), 3);
+
+    for (auto removed : children) {
+        RelationShipSystem::SetParent(removed, {});
+        world.Update();
+
+        const auto remaining = parent.Get<RelationShip>().GetChildren();
+        EXPECT_EQ(remaining.size(), 2);
+        EXPECT_EQ(std::distance(remaining.begin(), remaining.end()), 2);
+        EXPECT_FALSE(remaining.contains(removed));
+
+        RelationShipSystem::SetParent(removed, parent);
+        world.Update();
+        EXPECT_TRUE(parent.Get<RelationShip>().GetChildren().contains(removed));
+    }
+}
+
+TEST_F(RelationShipSystemTest, StaticHierarchyIsNotVisited) {
+    static std::size_t num_visits = 0;
+    struct CountSystem {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule.SetOrder("attach_parent", "count");
+            schedule.Request("count", [](ecs::Changed<const RelationShip&>) { num_visits++; });
+        }
+    };
+    sm.Register<CountSystem>();
+
+    auto entities = em.CreateMany<RelationShip>(100);
+    for (std::size_t index = 1; index < entities.size(); index++) {
+        RelationShipSystem::SetParent(entities[index], entities[index - 1]);
+    }
+    // links are established in the first update, and the changes are seen by the next one
+    world.Update();
+    world.Update();
+
+    num_visits = 0;
+    world.Update();
+    EXPECT_EQ(num_visits, 0);
+
+    RelationShipSystem::SetParent(entities.back(), entities.front());
+    world.Update();
+    EXPECT_GT(num_visits, 0);
+    EXPECT_TRUE(entities.front().Get<RelationShip>().GetChildren().contains(entities.back()));
+    EXPECT_FALSE(entities[entities.size() - 2].Get<RelationShip>().GetChildren().contains(entities.back()));
+}
+
 TEST_F(RelationShipSystemTest, AutoAttachChildren) {
     auto entities = em.CreateMany(2);
 
@@ -98,6 +171,80 @@ TEST_F(LocalToWorldSystemTest, UpdateHierarchy) {
     EXPECT_EQ(child_entity.Get<Transform>().world_matrix, math::translate(math::vec3f{5.0f, 0.0f, 0.0f}));
 }
 
+TEST_F(LocalToWorldSystemTest, UpdateDeepHierarchy) {
+    constexpr std::size_t depth = 100;
+
+    std::pmr::vector<ecs::Entity> entities;
+    for (std::size_t index = 0; index < depth; index++) {
+        entities.emplace_back(em.Spawn(
+            Transform(math::vec3f{1.0f, 0.0f, 0.0f}),
+            RelationShip(index == 0 ? ecs::Entity{} : entities.back())));
+    }
+    world.Update();
+
+    for (std::size_t index = 0; index < depth; index++) {
+        EXPECT_EQ(entities[index].Get<Transform>().world_matrix, math::translate(math::vec3f{index + 1.0f, 0.0f, 0.0f}));
+    }
+
+    // only the root is moved, all descendants follow it
+    entities.front().Get<Transform>().Translate(math::vec3f{1.0f, 0.0f, 0.0f});
+    entities.front().MarkChanged<Transform>();
+    world.Update();
+
+    EXPECT_EQ(entities.back().Get<Transform>().world_matrix, math::translate(math::vec3f{depth + 1.0f, 0.0f, 0.0f}));
+}
+
+TEST_F(LocalToWorldSystemTest, ChangeParent) {
+    auto root_1 = em.Spawn(Transform(math::vec3f{1.0f, 0.0f, 0.0f}), RelationShip());
+    auto root_2 = em.Spawn(Transform(math::vec3f{2.0f, 0.0f, 0.0f}), RelationShip());
+    auto child  = em.Spawn(Transform(math::vec3f{3.0f, 0.0f, 0.0f}), RelationShip(root_1));
+    auto leaf   = em.Spawn(Transform(math::vec3f{4.0f, 0.0f, 0.0f}), RelationShip(child));
+    world.Update();
+
+    EXPECT_EQ(leaf.Get<Transform>().world_matrix, math::translate(math::vec3f{8.0f, 0.0f, 0.0f}));
+
+    RelationShipSystem::SetParent(child, root_2);
+    world.Update();
+
+    EXPECT_EQ(child.Get<Transform>().world_matrix, math::translate(math::vec3f{5.0f, 0.0f, 0.0f}));
+    EXPECT_EQ(leaf.Get<Transform>().world_matrix, math::translate(math::vec3f{9.0f, 0.0f, 0.0f}));
+
+    // detach from parent
+    RelationShipSystem::SetParent(child, {});
+    world.Update();
+
+    EXPECT_EQ(child.Get<Transform>().world_matrix, math::translate(math::vec3f{3.0f, 0.0f, 0.0f}));
+    EXPECT_EQ(leaf.Get<Transform>().world_matrix, math::translate(math::vec3f{7.0f, 0.0f, 0.0f}));
+}
+
+TEST_F(LocalToWorldSystemTest, InstantiatePrefab) {
+    auto root   = em.Spawn(Transform(math::vec3f{1.0f, 0.0f, 0.0f}), RelationShip());
+    auto child  = em.Spawn(Transform(math::vec3f{2.0f, 0.0f, 0.0f}), RelationShip(root));
+    auto leaf_1 = em.Spawn(Transform(math::vec3f{3.0f, 0.0f, 0.0f}), RelationShip(child));
+    auto leaf_2 = em.Spawn(Transform(math::vec3f{4.0f, 0.0f, 0.0f}), RelationShip(child));
+    world.Update();
+
+    // the subtree of `child`, whose parent is out of the prefab
+    const auto prefab    = em.CreatePrefab(std::array{child, leaf_1, leaf_2});
+    const auto instances = em.Instantiate(prefab, 3);
+    ASSERT_EQ(instances.size(), 9);
+    RelationShipSystem::SetParent(instances[3], root);
+    world.Update();
+
+    for (std::size_t index = 0; index < 3; index++) {
+        const auto instance_child = instances[index * 3];
+        const auto offset         = index == 1 ? 1.0f : 0.0f;
+        EXPECT_EQ(instance_child.Get<RelationShip>().GetParent(), index == 1 ? root : ecs::Entity{});
+        EXPECT_EQ(instance_child.Get<RelationShip>().GetChildren().size(), 2);
+        EXPECT_TRUE(instance_child.Get<RelationShip>().GetChildren().contains(instances[index * 3 + 1]));
+        EXPECT_TRUE(instance_child.Get<RelationShip>().GetChildren().contains(instances[index * 3 + 2]));
+        EXPECT_EQ(instances[index * 3 + 1].Get<RelationShip>().GetParent(), instance_child);
+        EXPECT_EQ(instances[index * 3 + 2].Get<Transform>().world_matrix, math::translate(math::vec3f{offset + 6.0f, 0.0f, 0.0f}));
+    }
+    EXPECT_EQ(root.Get<RelationShip>().GetChildren().size(), 2);
+    EXPECT_EQ(leaf_2.Get<Transform>().world_matrix, math::translate(math::vec3f{7.0f, 0.0f, 0.0f}));
+}
+
 int main(int argc, char** argv) {
     spdlog::set_level(spdlog::level::trace);
     ::testing::InitGoogleTest(&argc, argv);
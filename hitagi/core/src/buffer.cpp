@@ -71,7 +71,7 @@ Buffer& Buffer::operator=(Buffer&& rhs) noexcept {
         if (m_Allocator != rhs.m_Allocator) {
             return this->operator=(std::cref(rhs));
         } else {
-            if (m_Data != nullptr) m_Allocator.deallocate(m_Data, m_Size);
+            if (m_Data != nullptr) m_Allocator.deallocate_bytes(m_Data, m_Size, m_Alignment);
         }
         m_Data      = rhs.m_Data;
         m_Size      = rhs.m_Size;
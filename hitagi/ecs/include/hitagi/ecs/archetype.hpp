@@ -1,21 +1,57 @@
 #pragma once
 #include <hitagi/ecs/common_types.hpp>
 #include <hitagi/ecs/component.hpp>
+#include <hitagi/ecs/chunk_pool.hpp>
+#include <hitagi/ecs/entity_map.hpp>
+#include <hitagi/ecs/memory_report.hpp>
 #include <hitagi/core/buffer.hpp>
 #include <hitagi/utils/utils.hpp>
 #include <hitagi/utils/soa.hpp>
 
+#include <atomic>
+#include <limits>
+#include <span>
+
 namespace hitagi::ecs {
 
+// `chunk_size` must be positive and not greater than `max_chunk_size`, otherwise the world throws when it is created.
+struct ChunkConfig {
+    std::size_t chunk_size = 16_kB;
+    // If it is not zero, the chunk size of each archetype is doubled until a chunk
+    // holds at least `min_entities_per_chunk` entities or reaches `max_chunk_size`
+    std::size_t min_entities_per_chunk = 0;
+    std::size_t max_chunk_size         = 256_kB;
+
+    // the memory of free chunks kept in the chunk pool of world
+    std::size_t max_pooled_memory        = 4_MB;
+    // empty archetypes are destroyed after they stay empty for this number of updates
+    std::size_t empty_archetype_lifetime = 60;
+};
+
 class Archetype {
 public:
-    Archetype(detail::ComponentInfoSet component_infos);
+    // `serial` is the order of creation in the entity manager, it is never reused by other archetypes.
+    // `version` is the change version counter of entity manager, chunks are stamped with it when entities are allocated.
+    // `shared_values` must contain the values of all shared components, they are copied into the archetype.
+    // The chunks are acquired from `chunk_pool` and released back when they become empty.
+    Archetype(std::uint64_t serial, detail::ComponentInfoSet component_infos, const ChunkConfig& config, const std::atomic<std::uint64_t>& version,
+              ChunkPool& chunk_pool, const detail::SharedComponentValues& shared_values = {});
     ~Archetype();
 
+    inline auto GetSerial() const noexcept { return m_Serial; }
     const auto& GetComponentInfoSet() const noexcept { return m_ComponentInfoSet; }
+    inline auto& GetSignature() const noexcept { return m_Signature; }
+
+    inline auto& GetSharedComponentValues() const noexcept { return m_SharedComponentValues; }
+    bool MatchSharedComponentValues(const detail::SharedComponentValues& shared_values) const noexcept;
+
+    inline auto NumEntities() const noexcept { return m_EntityMap.size(); }
+    inline auto NumEntitiesPerChunk() const noexcept { return m_ChunkInfo.num_entities_per_chunk; }
+    inline auto GetChunkSize() const noexcept { return m_ChunkInfo.chunk_size; }
 
     // create a entity in this archetype without any initialization
     void AllocateFor(entity_id_t entity) noexcept;
+    void AllocateFor(std::span<const entity_id_t> entities) noexcept;
 
     // destroy a entity in this archetype without any destruction
     void DeallocateFor(entity_id_t entity) noexcept;
@@ -31,49 +67,81 @@ public:
     auto GetComponent(entity_id_t entity) noexcept -> T&;
 
     bool HasComponent(utils::TypeID component) const noexcept;
+    template <Component T>
+    inline bool HasComponent() const { return m_Signature.test(detail::get_component_index<T>()); }
+    // whether the archetype has all components in the signature
+    inline bool HasComponents(const ComponentSignature& signature) const noexcept { return (m_Signature & signature) == signature; }
 
-    // Raw pointer member functions
+    // Raw pointer member functions, the construction and destruction of chunk and shared components
+    // are ignored since they are not owned by entity.
     void DefaultConstructComponent(utils::TypeID component_id, entity_id_t entity);
     void CopyConstructComponent(utils::TypeID component_id, entity_id_t entity, const std::byte* src);
     void MoveConstructComponent(utils::TypeID component_id, entity_id_t entity, std::byte* src);
+    // move construct the component from `src` and destruct `src`
+    void RelocateComponent(utils::TypeID component_id, entity_id_t entity, std::byte* src);
     void DestructComponent(utils::TypeID component_id, entity_id_t entity) noexcept;
     void DestructAllComponents(entity_id_t entity) noexcept;
 
     auto GetComponentData(utils::TypeID component_id, entity_id_t entity) noexcept -> std::byte*;
-    auto GetAllComponentData(entity_id_t entity) noexcept -> std::unordered_map<utils::TypeID, std::byte*>;
 
+    // [(data, num_entities)] of each chunk, all entities of a chunk refer to the same chunk or shared component
     auto GetComponentBuffers(utils::TypeID component_id) const noexcept -> std::pmr::vector<std::pair<std::byte*, std::size_t>>;
 
+    // Each chunk records the version of last write for every component
+    void MarkChanged(utils::TypeID component_id, entity_id_t entity) noexcept;
+    auto GetComponentVersions(utils::TypeID component_id) const noexcept -> std::pmr::vector<std::uint64_t*>;
+
+    auto GetMemoryReport() const -> ArchetypeMemoryReport;
+
 private:
-    constexpr static auto sm_chunk_size = 2_kB;
     constexpr static auto sm_align_size = 64;
 
     struct ChunkInfo {
+        std::size_t                                         chunk_size;
         std::size_t                                         num_entities_per_chunk;
         std::pmr::unordered_map<utils::TypeID, std::size_t> component_offsets;
+        // the offsets in the order of component info set
+        std::pmr::vector<std::size_t>                       column_offsets;
+        std::pmr::unordered_map<utils::TypeID, std::size_t> component_indices;
     };
 
     struct Chunk {
-        Chunk();
+        Chunk(core::Buffer data, std::size_t num_components);
         Chunk(const Chunk&)            = delete;
         Chunk(Chunk&&)                 = default;
         Chunk& operator=(const Chunk&) = delete;
         Chunk& operator=(Chunk&&)      = default;
 
-        std::size_t  num_entity_in_chunk = 0;
-        core::Buffer data;
+        std::size_t                     num_entity_in_chunk = 0;
+        core::Buffer                    data;
+        std::pmr::vector<std::uint64_t> versions;
     };
 
     auto GetComponentInfo(utils::TypeID component_id) const noexcept -> const ComponentInfo&;
     auto GetComponentOffset(utils::TypeID component_id) const noexcept -> std::size_t;
     auto GetOrCreateChunk() noexcept -> Chunk&;
+    void ConstructChunkComponents(Chunk& chunk) noexcept;
+    void DestructChunkComponents(Chunk& chunk) noexcept;
     auto GetLastEntity() const -> entity_id_t;
+    auto GetChangeVersion() const noexcept -> std::uint64_t;
+
+    static void Relocate(const ComponentInfo& component_info, std::byte* dest, std::byte* src) noexcept;
+
+    const std::uint64_t               m_Serial;
+    const std::atomic<std::uint64_t>& m_Version;
+    ChunkPool&                        m_ChunkPool;
 
     detail::ComponentInfoSet m_ComponentInfoSet;
+    ComponentSignature       m_Signature;
     ChunkInfo                m_ChunkInfo;
     std::pmr::vector<Chunk>  m_Chunks;
 
-    std::pmr::unordered_map<entity_id_t, std::pair<std::size_t, std::size_t>> m_EntityMap;
+    std::pmr::unordered_map<utils::TypeID, core::Buffer> m_SharedComponents;
+    detail::SharedComponentValues                        m_SharedComponentValues;
+
+    // entity -> (chunk index, index in chunk), the chunks of an archetype are far fewer than 2^32
+    using EntityLocation = std::pair<std::uint32_t, std::uint32_t>;
+    EntityMap<EntityLocation, 1024> m_EntityMap{EntityLocation(std::numeric_limits<std::uint32_t>::max(), std::numeric_limits<std::uint32_t>::max())};
 };
 
 template <Component T, typename... Args>
@@ -83,7 +151,9 @@ auto Archetype::ConstructComponent(entity_id_t entity, Args&&... args) -> T& {
 
 template <Component T>
 void Archetype::DestructComponent(entity_id_t entity) {
-    std::destroy_at<T>(&GetComponent<T>(entity));
+    if constexpr (detail::get_component_storage<T>() == ComponentStorage::Entity) {
+        std::destroy_at<T>(&GetComponent<T>(entity));
+    }
 }
 
 template <Component T>
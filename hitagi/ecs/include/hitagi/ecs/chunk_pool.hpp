@@ -0,0 +1,44 @@
+#pragma once
+#include <hitagi/core/buffer.hpp>
+
+#include <unordered_map>
+
+namespace hitagi::ecs {
+
+struct ChunkPoolStats {
+    // the chunks held by archetypes
+    std::size_t num_used_chunks   = 0;
+    std::size_t used_memory       = 0;
+    // the chunks kept in the pool for reuse
+    std::size_t num_free_chunks   = 0;
+    std::size_t free_memory       = 0;
+    // the chunks allocated from and freed to the memory resource since the pool is created
+    std::size_t num_allocations   = 0;
+    std::size_t num_deallocations = 0;
+};
+
+// The chunks of all archetypes in a world. Chunks released by an archetype are kept for the archetypes
+// with the same chunk size, unless the memory of kept chunks exceeds the budget.
+class ChunkPool {
+public:
+    ChunkPool(std::size_t budget) : m_Budget(budget) {}
+    ChunkPool(const ChunkPool&)            = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    auto Acquire(std::size_t chunk_size) -> core::Buffer;
+    void Release(core::Buffer chunk);
+
+    inline auto& GetStats() const noexcept { return m_Stats; }
+
+private:
+    constexpr static std::size_t sm_AlignSize = 64;
+
+    std::size_t m_Budget;
+
+    // chunk size -> free chunks
+    std::pmr::unordered_map<std::size_t, std::pmr::vector<core::Buffer>> m_FreeChunks;
+
+    ChunkPoolStats m_Stats;
+};
+
+}  // namespace hitagi::ecs
@@ -0,0 +1,109 @@
+#pragma once
+#include <hitagi/ecs/entity.hpp>
+#include <hitagi/utils/concepts.hpp>
+#include <hitagi/utils/types.hpp>
+
+#include <memory_resource>
+#include <mutex>
+
+namespace hitagi::ecs {
+
+// Record structural changes (create, destroy, add and remove components) which will be
+// played back in a batch at the sync point after `Schedule::Run`, so that tasks running
+// in parallel can request them without touching archetypes that other tasks are iterating.
+// Commands of all buffers are played back in the order they are recorded, so an entity created
+// in one buffer can be used by the commands recorded later in other buffers.
+class CommandBuffer {
+public:
+    // a thread safe buffer can be recorded by many threads, it is the one for the threads outside the executor
+    CommandBuffer(EntityManager& entity_manager, bool thread_safe = false);
+    CommandBuffer(const CommandBuffer&)            = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+    ~CommandBuffer();
+
+    // The id of returned entity is reserved immediately,
+    // but the entity is valid only after the command buffer is played back.
+    [[nodiscard]] auto Create() -> Entity;
+    void               Destroy(Entity entity);
+
+    template <Component T, typename... Args>
+        requires utils::not_same_as<T, Entity>
+    void Emplace(Entity entity, Args&&... args);
+    void Add(Entity entity, std::string_view dynamic_component);
+
+    template <Component T>
+        requires utils::not_same_as<T, Entity>
+    void Remove(Entity entity);
+    void Remove(Entity entity, std::string_view dynamic_component);
+
+    inline auto NumCommands() const noexcept { return m_Commands.size(); }
+    inline bool Empty() const noexcept { return m_Commands.empty(); }
+
+private:
+    friend EntityManager;
+
+    enum struct CommandType : std::uint8_t {
+        Create,
+        Destroy,
+        Emplace,
+        Remove,
+    };
+
+    struct Command {
+        // the order of recording among all command buffers of the entity manager
+        std::uint64_t        sequence = 0;
+        CommandType          type;
+        entity_id_t          entity;
+        utils::TypeID        component_id = {};
+        // only valid for static component, dynamic component info is queried from entity manager
+        const ComponentInfo* component_info = nullptr;
+        // the constructed component value, nullptr means default construction
+        std::byte*           data = nullptr;
+    };
+
+    auto Allocate(std::size_t size, std::size_t alignment) -> std::byte*;
+    void Record(Command command);
+    void Clear() noexcept;
+    // lock the buffer if it is thread safe
+    auto Lock() -> std::unique_lock<std::mutex>;
+
+    EntityManager&                                       m_EntityManager;
+    std::unique_ptr<std::mutex>                          m_Mutex;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> m_Arena;
+    std::pmr::vector<Command>                            m_Commands;
+};
+
+namespace detail {
+template <Component T>
+auto get_static_component_info() -> const ComponentInfo& {
+    static const ComponentInfo info = create_static_component_info<T>();
+    return info;
+}
+}  // namespace detail
+
+template <Component T, typename... Args>
+    requires utils::not_same_as<T, Entity>
+void CommandBuffer::Emplace(Entity entity, Args&&... args) {
+    auto data = Allocate(sizeof(T), alignof(T));
+    std::construct_at(reinterpret_cast<T*>(data), std::forward<Args>(args)...);
+
+    Record({
+        .type           = CommandType::Emplace,
+        .entity         = entity.GetId(),
+        .component_id   = utils::TypeID::Create<T>(),
+        .component_info = &detail::get_static_component_info<T>(),
+        .data           = data,
+    });
+}
+
+template <Component T>
+    requires utils::not_same_as<T, Entity>
+void CommandBuffer::Remove(Entity entity) {
+    Record({
+        .type         = CommandType::Remove,
+        .entity       = entity.GetId(),
+        .component_id = utils::TypeID::Create<T>(),
+    });
+}
+
+}  // namespace hitagi::ecs
@@ -2,25 +2,148 @@
 #include <hitagi/utils/concepts.hpp>
 #include <hitagi/utils/types.hpp>
 
+#include <bitset>
+#include <limits>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <unordered_set>
-#include <functional>
 
 namespace hitagi::ecs {
+class SnapshotWriter;
+class SnapshotReader;
+class EntityRemap;
+
+// How the values of a component are stored in archetypes, a component declares it by
+// `constexpr static auto storage = ecs::ComponentStorage::Shared;`, the default is `Entity`.
+enum struct ComponentStorage : std::uint8_t {
+    // each entity has its own value
+    Entity,
+    // Each chunk has one value, which is default constructed when the chunk is created,
+    // e.g. the bounds of all entities in the chunk.
+    Chunk,
+    // Entities with the same value share one copy of it. The value is a part of the archetype identity,
+    // so entities are grouped into chunks by value.
+    Shared,
+    // Stored in a sparse set outside of archetypes, adding or removing it does not move the entity to another archetype.
+    // It suits the tags which are toggled frequently, e.g. selected or visible in this frame.
+    Sparse,
+};
 
 template <typename T>
 concept Component = std::is_class_v<T> && utils::no_cvref<T> && std::copy_constructible<T>;
 
+namespace detail {
+template <typename T>
+consteval auto get_component_storage() noexcept -> ComponentStorage {
+    if constexpr (requires { { T::storage } -> std::convertible_to<ComponentStorage>; }) {
+        return T::storage;
+    } else {
+        return ComponentStorage::Entity;
+    }
+}
+
+template <typename T>
+consteval bool is_double_buffered() noexcept {
+    if constexpr (requires { { T::double_buffered } -> std::convertible_to<bool>; }) {
+        return T::double_buffered;
+    } else {
+        return false;
+    }
+}
+
+template <typename T>
+consteval bool is_gpu_mirrored() noexcept {
+    if constexpr (requires { { T::gpu_mirrored } -> std::convertible_to<bool>; }) {
+        return T::gpu_mirrored;
+    } else {
+        return false;
+    }
+}
+}  // namespace detail
+
+template <typename T>
+concept ChunkComponent = Component<T> && std::default_initializable<T> &&
+                         detail::get_component_storage<T>() == ComponentStorage::Chunk;
+
+// Shared components are compared and hashed to find the archetype of their value
+template <typename T>
+concept SharedComponent = Component<T> && std::equality_comparable<T> &&
+                          detail::get_component_storage<T>() == ComponentStorage::Shared &&
+                          requires(const T& component) {
+                              { std::hash<T>{}(component) } -> std::convertible_to<std::size_t>;
+                          };
+
+template <typename T>
+concept SparseComponent = Component<T> && detail::get_component_storage<T>() == ComponentStorage::Sparse;
+
+// Archetypes keep a copy of the component taken at the start of each update, which `LastFrame<T>` reads.
+// Readers of the copy do not wait for the writers of the component, so they can run concurrently.
+// The copy is made by `memcpy`, and only the chunks changed since the last copy are copied.
+template <typename T>
+concept DoubleBufferedComponent = Component<T> && std::is_trivially_copyable_v<T> &&
+                                  detail::is_double_buffered<T>() &&
+                                  detail::get_component_storage<T>() == ComponentStorage::Entity;
+
+// `GPUMirror` keeps a GPU buffer per column of the component, the chunks written since the last upload are copied to it.
+// Relocating an entity in a chunk is regarded as a write of the component, so the mirror never keeps a stale slot.
+template <typename T>
+concept GPUMirroredComponent = Component<T> && std::is_trivially_copyable_v<T> &&
+                               detail::is_gpu_mirrored<T>() &&
+                               detail::get_component_storage<T>() == ComponentStorage::Entity;
+
+// The component provides its own binary format for snapshot
+template <typename T>
+concept SerializableComponent = Component<T> && requires(const T& component, SnapshotWriter& writer, SnapshotReader& reader) {
+    { component.Serialize(writer) } -> std::same_as<void>;
+    { T::Deserialize(reader) } -> std::same_as<T>;
+};
+
+// The component refers to other entities, the references are remapped when it is instantiated from a prefab
+template <typename T>
+concept EntityReferenceComponent = Component<T> && requires(T& component, const EntityRemap& remap) {
+    { component.RemapEntities(remap) } -> std::same_as<void>;
+};
+
+// Every component type gets a dense index in the process, archetypes are identified and matched by the bitset of them.
+constexpr std::size_t max_num_component_types = 512;
+using ComponentSignature                       = std::bitset<max_num_component_types>;
+
 struct ComponentInfo {
     std::pmr::string name;
-    utils::TypeID    type_id;
-    std::size_t      size;
+    // given by the entity manager when a dynamic component is registered
+    utils::TypeID    type_id = {};
+    std::size_t      size    = 0;
+    // the bit of the component in signatures, dynamic components get it when registered
+    std::uint32_t    index = std::numeric_limits<std::uint32_t>::max();
+
+    ComponentStorage storage = ComponentStorage::Entity;
+    // only for the trivially copyable components stored in archetypes, see `DoubleBufferedComponent`
+    bool             double_buffered = false;
+    // only for the trivially copyable components stored in archetypes, see `GPUMirroredComponent`
+    bool             gpu_mirrored    = false;
 
-    std::function<void(std::byte*)>                   default_constructor;
-    std::function<void(std::byte*, const std::byte*)> copy_constructor;
-    std::function<void(std::byte*, std::byte*)>       move_constructor;
-    std::function<void(std::byte*)>                   destructor;
+    // plain function pointers, so copying the component info set does not copy any closure
+    void (*default_constructor)(std::byte*)                = nullptr;
+    void (*copy_constructor)(std::byte*, const std::byte*) = nullptr;
+    void (*move_constructor)(std::byte*, std::byte*)       = nullptr;
+    void (*destructor)(std::byte*)                         = nullptr;
+
+    // Moving the component to another place and destructing the old one is equivalent to `memcpy`.
+    // Components without move constructor are always relocated by `memcpy`.
+    bool trivially_relocatable = false;
+
+    // Optional hooks for snapshot, `deserialize` constructs the component at the given memory.
+    // Without them, trivially copyable components are copied bitwise, and the others are copied in memory.
+    void (*serialize)(const std::byte*, SnapshotWriter&) = nullptr;
+    void (*deserialize)(std::byte*, SnapshotReader&)     = nullptr;
+
+    // optional hook for prefab, see `EntityReferenceComponent`
+    void (*remap_entities)(std::byte*, const EntityRemap&) = nullptr;
+
+    // only for shared components
+    bool (*equal)(const std::byte*, const std::byte*) = nullptr;
+    std::size_t (*hash)(const std::byte*)             = nullptr;
 
     constexpr auto operator<=>(const ComponentInfo& rhs) const noexcept {
         return std::tie(size, type_id) <=> std::tie(rhs.size, rhs.type_id);
@@ -40,28 +163,83 @@ namespace detail {
 
 using ComponentInfoSet = std::pmr::set<ComponentInfo>;
 
+// return the index of the registered component, it is thread safe
+auto register_component_index(utils::TypeID component_id) -> std::uint32_t;
+
+template <Component T>
+auto get_component_index() -> std::uint32_t {
+    static const auto index = register_component_index(utils::TypeID::Create<T>());
+    return index;
+}
+
+inline auto get_component_signature(const ComponentInfoSet& component_infos) noexcept -> ComponentSignature {
+    ComponentSignature signature;
+    for (const auto& component_info : component_infos) {
+        signature.set(component_info.index);
+    }
+    return signature;
+}
+
+// the values of shared components which identify an archetype
+using SharedComponentValues = std::pmr::unordered_map<utils::TypeID, const std::byte*>;
+
+// it throws if there are too many component types to be indexed
 template <Component T>
-constexpr auto create_static_component_info() noexcept {
-    return ComponentInfo{
+auto create_static_component_info() {
+    static_assert(get_component_storage<T>() != ComponentStorage::Chunk || ChunkComponent<T>, "Chunk component must be default initializable");
+    static_assert(get_component_storage<T>() != ComponentStorage::Shared || SharedComponent<T>, "Shared component must be equality comparable and hashable");
+    static_assert(!is_double_buffered<T>() || DoubleBufferedComponent<T>, "Double-buffered component must be trivially copyable and stored in archetypes");
+    static_assert(!is_gpu_mirrored<T>() || GPUMirroredComponent<T>, "GPU mirrored component must be trivially copyable and stored in archetypes");
+
+    auto info = ComponentInfo{
         .name                = typeid(T).name(),
         .type_id             = utils::TypeID::Create<T>(),
         .size                = sizeof(T),
+        .index               = get_component_index<T>(),
+        .storage             = get_component_storage<T>(),
+        .double_buffered     = is_double_buffered<T>(),
+        .gpu_mirrored        = is_gpu_mirrored<T>(),
         .default_constructor = [](std::byte* ptr) { 
             if constexpr(std::is_default_constructible_v<T>) {
                 std::construct_at(reinterpret_cast<T*>(ptr));
             } },
         .copy_constructor    = [](std::byte* ptr, const std::byte* other) { std::construct_at(reinterpret_cast<T*>(ptr), *reinterpret_cast<const T*>(other)); },
         .move_constructor    = [](std::byte* ptr, std::byte* other) { std::construct_at(reinterpret_cast<T*>(ptr), std::move(*reinterpret_cast<T*>(other))); },
-        .destructor          = [](std::byte* ptr) { std::destroy_at(reinterpret_cast<T*>(ptr)); },
+        .destructor          = std::is_trivially_destructible_v<T>
+                                   ? nullptr
+                                   : +[](std::byte* ptr) { std::destroy_at(reinterpret_cast<T*>(ptr)); },
+        .trivially_relocatable = std::is_trivially_copyable_v<T>,
     };
+    if constexpr (SerializableComponent<T>) {
+        info.serialize   = [](const std::byte* ptr, SnapshotWriter& writer) { reinterpret_cast<const T*>(ptr)->Serialize(writer); };
+        info.deserialize = [](std::byte* ptr, SnapshotReader& reader) { std::construct_at(reinterpret_cast<T*>(ptr), T::Deserialize(reader)); };
+    }
+    if constexpr (EntityReferenceComponent<T>) {
+        info.remap_entities = [](std::byte* ptr, const EntityRemap& remap) { reinterpret_cast<T*>(ptr)->RemapEntities(remap); };
+    }
+    if constexpr (SharedComponent<T>) {
+        info.equal = [](const std::byte* lhs, const std::byte* rhs) { return *reinterpret_cast<const T*>(lhs) == *reinterpret_cast<const T*>(rhs); };
+        info.hash  = [](const std::byte* ptr) { return std::hash<T>{}(*reinterpret_cast<const T*>(ptr)); };
+    }
+    return info;
+}
+
+// the hidden component holding the last frame copy of a double-buffered component
+auto create_last_frame_component_info(const ComponentInfo& component_info) -> ComponentInfo;
+
+template <DoubleBufferedComponent T>
+auto get_last_frame_component_id() -> utils::TypeID {
+    static const auto component_id = create_last_frame_component_info(create_static_component_info<T>()).type_id;
+    return component_id;
 }
 
 template <Component... Components>
     requires utils::unique_types<Components...>
-auto create_component_info_set(const ComponentInfoSet& dynamic_components = {}) noexcept {
+auto create_component_info_set(const ComponentInfoSet& dynamic_components = {}) {
     ComponentInfoSet result = {create_static_component_info<Components>()...};
     for (auto dynamic_component : dynamic_components) {
         dynamic_component.type_id = utils::TypeID(dynamic_component.name);
+        dynamic_component.index   = register_component_index(dynamic_component.type_id);
         result.emplace(dynamic_component);
     }
     return result;
@@ -16,18 +16,29 @@ public:
 
     template <Component T>
     auto Get() const -> const T&;
+    // shared components are read only, use `SetShared` to change the value
     template <Component T>
-        requires utils::not_same_as<T, Entity>
+        requires utils::not_same_as<T, Entity> && (!SharedComponent<T>)
     auto Get() -> T&;
     auto Get(std::string_view dynamic_component) -> std::byte*;
     auto Get(std::string_view dynamic_component) const -> const std::byte*;
 
     template <Component T, typename... Args>
-        requires utils::not_same_as<T, Entity>
+        requires utils::not_same_as<T, Entity> && (!SharedComponent<T>)
     auto Emplace(Args&&... args) -> T&;
 
+    // add the shared component or replace its value, it moves the entity to the archetype of the value
+    template <SharedComponent T>
+    auto SetShared(T value) -> const T&;
+
     auto Add(std::string_view dynamic_component) -> std::byte*;
 
+    // Writes through `Get` outside of schedule are not tracked,
+    // mark the component changed so that tasks requesting `Changed<T>` will visit it.
+    template <Component T>
+    void MarkChanged();
+    void MarkChanged(std::string_view dynamic_component);
+
     template <Component T>
         requires utils::not_same_as<T, Entity>
     void Remove();
@@ -46,6 +57,8 @@ public:
 
 private:
     friend EntityManager;
+    friend SnapshotReader;
+    friend EntityRemap;
 
     Entity(EntityManager* manager, entity_id_t id) : m_EntityManager(manager), m_Id(id) {}
 
@@ -62,12 +75,18 @@ bool Entity::Has() const {
 }
 
 template <Component T, typename... Args>
-    requires utils::not_same_as<T, Entity>
+    requires utils::not_same_as<T, Entity> && (!SharedComponent<T>)
 auto Entity::Emplace(Args&&... args) -> T& {
     CheckValidation();
     return m_EntityManager->EmplaceComponent<T>(m_Id, std::forward<Args>(args)...);
 }
 
+template <SharedComponent T>
+auto Entity::SetShared(T value) -> const T& {
+    CheckValidation();
+    return m_EntityManager->SetSharedComponent<T>(m_Id, std::move(value));
+}
+
 template <Component T>
     requires utils::not_same_as<T, Entity>
 void Entity::Remove() {
@@ -76,7 +95,13 @@ void Entity::Remove() {
 }
 
 template <Component T>
-    requires utils::not_same_as<T, Entity>
+void Entity::MarkChanged() {
+    CheckValidation();
+    m_EntityManager->MarkComponentChanged(m_Id, utils::TypeID::Create<T>());
+}
+
+template <Component T>
+    requires utils::not_same_as<T, Entity> && (!SharedComponent<T>)
 auto Entity::Get() -> T& {
     CheckValidation();
     return m_EntityManager->GetComponent<T>(m_Id);
@@ -88,6 +113,117 @@ auto Entity::Get() const -> const T& {
     return m_EntityManager->GetComponent<T>(m_Id);
 }
 
+// The templates of entity manager which need the complete type of `Entity`
+namespace detail {
+template <Component T, typename Value>
+inline void construct_component_from(std::byte* dest, Value&& value) {
+    if constexpr (std::is_trivially_copyable_v<T> && std::same_as<std::remove_cvref_t<Value>, T>) {
+        std::memcpy(dest, std::addressof(value), sizeof(T));
+    } else {
+        std::construct_at(reinterpret_cast<T*>(dest), std::forward<Value>(value));
+    }
+}
+}  // namespace detail
+
+template <typename... Components>
+    requires((Component<std::remove_cvref_t<Components>> && utils::not_same_as<std::remove_cvref_t<Components>, Entity>) && ...) &&
+            utils::unique_types<std::remove_cvref_t<Components>...>
+auto EntityManager::Spawn(Components&&... components) -> Entity {
+    auto generator = [&](std::size_t) { return std::forward_as_tuple(std::forward<Components>(components)...); };
+    return SpawnBatchImpl<std::remove_cvref_t<Components>...>(1, generator).front();
+}
+
+template <typename Generator>
+    requires std::invocable<Generator&, std::size_t>
+auto EntityManager::SpawnBatch(std::size_t num, Generator&& generator) -> std::pmr::vector<Entity> {
+    using Values = std::remove_cvref_t<std::invoke_result_t<Generator&, std::size_t>>;
+
+    return [&]<std::size_t... I>(std::index_sequence<I...>) {
+        return SpawnBatchImpl<std::remove_cvref_t<std::tuple_element_t<I, Values>>...>(num, generator);
+    }(std::make_index_sequence<std::tuple_size_v<Values>>{});
+}
+
+template <Component... Components, typename Generator>
+auto EntityManager::SpawnBatchImpl(std::size_t num, Generator& generator) -> std::pmr::vector<Entity> {
+    static_assert(utils::unique_types<Components...>, "The components of spawned entity must be unique");
+    static_assert((utils::not_same_as<Components, Entity> && ...), "The Entity component is created automatically");
+    static_assert((!ChunkComponent<Components> && ...), "Chunk component is constructed with the chunk");
+
+    (UpdateComponentInfo<Components>(), ...);
+    auto component_infos = detail::create_component_info_set<Entity, Components...>();
+    std::erase_if(component_infos, [](const auto& info) { return info.storage == ComponentStorage::Sparse; });
+
+    std::pmr::vector<Entity> entities;
+    entities.reserve(num);
+
+    // entities with different shared values are spawned into different archetypes one by one,
+    // so are the ones with sparse components which are stored outside of archetypes
+    if constexpr ((SharedComponent<Components> || ...) || (SparseComponent<Components> || ...)) {
+        detail::SharedComponentValues shared_values;
+        for (std::size_t i = 0; i < num; i++) {
+            auto values = generator(i);
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((SharedComponent<Components>
+                      ? void(shared_values[utils::TypeID::Create<Components>()] = reinterpret_cast<const std::byte*>(std::addressof(std::get<I>(values))))
+                      : void()),
+                 ...);
+            }(std::index_sequence_for<Components...>{});
+
+            Archetype&        archetype = GetOrCreateArchetype(component_infos, shared_values);
+            const entity_id_t entity    = m_Counter.fetch_add(1);
+            archetype.AllocateFor(entity);
+            m_EntityMaps.emplace(entity, &archetype);
+
+            entities.emplace_back(archetype.ConstructComponent<Entity>(entity, Entity(this, entity)));
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ([&] {
+                    if constexpr (SparseComponent<Components>) {
+                        detail::construct_component_from<Components>(GetOrCreateSparseSet(GetComponentInfo<Components>()).Allocate(entity), std::get<I>(std::move(values)));
+                    } else if constexpr (!SharedComponent<Components>) {
+                        detail::construct_component_from<Components>(archetype.GetComponentData(utils::TypeID::Create<Components>(), entity), std::get<I>(std::move(values)));
+                    }
+                }(),
+                 ...);
+            }(std::index_sequence_for<Components...>{});
+        }
+        return entities;
+    }
+
+    auto& archetype = GetOrCreateArchetype(component_infos);
+
+    const entity_id_t first_entity = m_Counter.fetch_add(num);
+    // all chunks except the last one are full, so new entities are appended contiguously
+    const std::size_t first_index  = archetype.NumEntities();
+
+    for (entity_id_t entity = first_entity; entity < first_entity + num; entity++) {
+        archetype.AllocateFor(entity);
+        m_EntityMaps.emplace(entity, &archetype);
+    }
+
+    const auto num_entities_per_chunk = archetype.NumEntitiesPerChunk();
+    const auto entity_buffers         = archetype.GetComponentBuffers(utils::TypeID::Create<Entity>());
+    const auto component_buffers      = std::array<std::pmr::vector<std::pair<std::byte*, std::size_t>>, sizeof...(Components)>{
+        archetype.GetComponentBuffers(utils::TypeID::Create<Components>())...};
+
+    for (std::size_t i = 0; i < num; i++) {
+        const auto chunk_index    = (first_index + i) / num_entities_per_chunk;
+        const auto index_in_chunk = (first_index + i) % num_entities_per_chunk;
+
+        auto entity_data = entity_buffers[chunk_index].first + index_in_chunk * sizeof(Entity);
+        entities.emplace_back(*std::construct_at(reinterpret_cast<Entity*>(entity_data), Entity(this, first_entity + i)));
+
+        auto values = generator(i);
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (detail::construct_component_from<Components>(
+                 component_buffers[I][chunk_index].first + index_in_chunk * sizeof(Components),
+                 std::get<I>(std::move(values))),
+             ...);
+        }(std::index_sequence_for<Components...>{});
+    }
+
+    return entities;
+}
+
 }  // namespace hitagi::ecs
 
 namespace std {
@@ -2,10 +2,45 @@
 #include <hitagi/ecs/common_types.hpp>
 #include <hitagi/ecs/archetype.hpp>
 #include <hitagi/ecs/filter.hpp>
+#include <hitagi/ecs/sparse_set.hpp>
 #include <hitagi/utils/concepts.hpp>
 #include <hitagi/utils/types.hpp>
 
+#include <atomic>
+#include <span>
+
 namespace hitagi::ecs {
+class CommandBuffer;
+class Snapshot;
+class Prefab;
+
+// A component in `EntityManager::Query`, it is given per chunk, so sparse components are not supported.
+// `Entity` and shared components are read only.
+template <typename T>
+concept QueryComponent = Component<std::remove_const_t<T>> &&
+                         detail::get_component_storage<std::remove_const_t<T>>() != ComponentStorage::Sparse &&
+                         (std::is_const_v<T> || (!std::same_as<T, Entity> && detail::get_component_storage<T>() != ComponentStorage::Shared));
+
+template <QueryComponent... Components>
+class ChunkQuery;
+
+// The chunks of a component in one archetype, the component of i-th entity in c-th chunk
+// is at `c * num_entities_per_chunk + i` of the column.
+struct ComponentColumn {
+    struct Chunk {
+        const std::byte* data;
+        std::size_t      num_entities;
+        // the version of last write of the component in the chunk
+        std::uint64_t    version;
+    };
+
+    const Archetype*        archetype;
+    // the address of a destroyed archetype may be reused, while the serial is not
+    std::uint64_t           archetype_serial;
+    std::size_t             num_entities_per_chunk;
+    std::size_t             num_entities;
+    std::pmr::vector<Chunk> chunks;
+};
 
 class EntityManager {
 public:
@@ -23,62 +58,183 @@ public:
         requires((std::default_initializable<Components> && utils::not_same_as<Components, Entity>) && ...)
     [[nodiscard]] auto CreateMany(std::size_t num, const std::pmr::set<std::string_view>& dynamic_components = {}) -> std::pmr::vector<Entity>;
 
+    // Create an entity with the given component values, the entity is allocated in its final archetype directly.
+    // Chunk components are constructed with the chunk, so they can not be spawned with a value.
+    template <typename... Components>
+        requires((Component<std::remove_cvref_t<Components>> && utils::not_same_as<std::remove_cvref_t<Components>, Entity>) && ...) &&
+                utils::unique_types<std::remove_cvref_t<Components>...>
+    auto Spawn(Components&&... components) -> Entity;
+
+    // Create `num` entities in one archetype, the components of i-th entity are constructed from the tuple returned by `generator(i)`.
+    // Entities with different shared component values are put into different archetypes.
+    template <typename Generator>
+        requires std::invocable<Generator&, std::size_t>
+    auto SpawnBatch(std::size_t num, Generator&& generator) -> std::pmr::vector<Entity>;
+
     auto NumEntities() const noexcept { return m_EntityMaps.size(); }
 
+    inline auto& GetChunkConfig() const noexcept { return m_ChunkConfig; }
+    inline auto& GetChunkPoolStats() const noexcept { return m_ChunkPool.GetStats(); }
+    inline auto  NumArchetypes() const noexcept { return m_Archetypes.size(); }
+
+    // the memory used by chunks, shared and sparse components, archetypes are listed from the largest
+    auto GetMemoryReport() const -> MemoryReport;
+
+    // Save all entities and their components, columns are written chunk by chunk.
+    [[nodiscard]] auto TakeSnapshot() const -> Snapshot;
+    // Overwrite the snapshot and reuse its memory, faulting in the pages of a new buffer costs more than copying the components.
+    void TakeSnapshot(Snapshot& snapshot) const;
+    // Replace all entities with the ones in the snapshot, the snapshot can be restored many times.
+    // The snapshot is validated before any entity is replaced, a broken one throws and keeps the entities.
+    void Restore(const Snapshot& snapshot);
+
+    // Capture the entities as a template, the references between them are kept by `EntityReferenceComponent`.
+    [[nodiscard]] auto CreatePrefab(std::span<const Entity> entities) const -> Prefab;
+    // Create `num` copies of the prefab, the i-th entity of the k-th copy is at `k * prefab.NumEntities() + i`.
+    auto Instantiate(const Prefab& prefab, std::size_t num = 1) -> std::pmr::vector<Entity>;
+
+    // Get the components of all chunks matching the filter at once, for the code outside of schedule such as renderers and tools.
+    // It must not be called while the world is updating, see `ChunkQuery`.
+    template <typename... Components>
+        requires(QueryComponent<Components> && ...)
+    auto Query(Filter filter = {}) -> ChunkQuery<Components...>;
+    template <typename... Components>
+        requires((QueryComponent<Components> && std::is_const_v<Components>) && ...)
+    auto Query(Filter filter = {}) const -> ChunkQuery<Components...>;
+
+    // The columns of an entity component in all archetypes, for mirroring the component outside of the world such as `GPUMirror`.
+    // The writes after the call are stamped with versions greater than `version`, so a chunk whose version is not greater
+    // than the `version` of a previous call has not been written since that call.
+    auto GetComponentColumns(utils::TypeID component_id, std::uint64_t& version) -> std::pmr::vector<ComponentColumn>;
+    // the components flagged with `gpu_mirrored` which have been used by the entity manager
+    auto GetGPUMirroredComponents() const -> std::pmr::vector<ComponentInfo>;
+
 private:
     friend World;
     friend Schedule;
     friend Entity;
+    friend CommandBuffer;
+
+    EntityManager(World& world, ChunkConfig chunk_config);
+
+    // reserve an entity id without allocating it in any archetype, it is thread safe
+    auto ReserveEntity() noexcept -> Entity;
 
-    EntityManager(World& world);
+    // Play back all recorded commands in a batch, entities are grouped by (source archetype, target archetype).
+    // The commands of all buffers are merged in the order of their sequences.
+    void Playback(std::span<const std::unique_ptr<CommandBuffer>> command_buffers);
+
+    // destroy the archetypes which have been empty for `ChunkConfig::empty_archetype_lifetime` updates
+    void CollectEmptyArchetypes();
+
+    // copy double-buffered components to their last frame columns before tasks run,
+    // the chunks not changed since the last copy are skipped
+    void UpdateLastFrameComponents() noexcept;
 
     auto CreateMany(std::size_t num, const detail::ComponentInfoSet& component_infos) noexcept -> std::pmr::vector<Entity>;
 
+    template <Component... Components, typename Generator>
+    auto SpawnBatchImpl(std::size_t num, Generator& generator) -> std::pmr::vector<Entity>;
+
     template <Component T>
-    bool HasComponent(entity_id_t entity) const noexcept;
+    bool HasComponent(entity_id_t entity) const;
     bool HasDynamicComponent(entity_id_t entity, std::string_view dynamic_component) const;
 
     template <Component T, typename... Args>
-        requires utils::not_same_as<T, Entity>
-    auto EmplaceComponent(entity_id_t entity, Args&&... args) noexcept -> T&;
+        requires utils::not_same_as<T, Entity> && (!SharedComponent<T>)
+    auto EmplaceComponent(entity_id_t entity, Args&&... args) -> T&;
+
+    // add the shared component or replace its value, the entity is moved to the archetype of the value
+    template <SharedComponent T>
+    auto SetSharedComponent(entity_id_t entity, T value) -> const T&;
 
     auto AddDynamicComponent(entity_id_t entity, std::string_view dynamic_component) -> std::byte*;
 
     template <Component T>
         requires utils::not_same_as<T, Entity>
-    void RemoveComponent(entity_id_t entity) noexcept;
+    void RemoveComponent(entity_id_t entity);
     void RemoveDynamicComponent(entity_id_t entity, std::string_view dynamic_component);
 
     template <Component T>
     auto GetComponent(entity_id_t entity) const -> T&;
     auto GetDynamicComponent(entity_id_t entity, std::string_view dynamic_component) const -> std::byte*;
 
+    // mark the component of the entity is changed, so that the tasks with `Changed<T>` parameter can see it
+    void MarkComponentChanged(entity_id_t entity, utils::TypeID component_id) noexcept;
+
+    // return nullptr if no entity has ever had the sparse component
+    auto GetSparseSet(utils::TypeID component_id) const noexcept -> SparseSet*;
+    auto GetOrCreateSparseSet(const ComponentInfo& component_info) -> SparseSet&;
+
+    // evaluate the filter with the sparse components of the entity
+    bool FilterEntity(const Filter& filter, entity_id_t entity) const;
+
+    // each task run gets a new version, which is greater than all versions stamped before
+    inline auto NextVersion() noexcept -> std::uint64_t { return ++m_Version; }
+    inline auto NextCommandSequence() noexcept -> std::uint64_t { return m_CommandSequence.fetch_add(1, std::memory_order_relaxed); }
+
     template <Component T>
-    void UpdateComponentInfo() noexcept;
+    void UpdateComponentInfo();
+    void UpdateComponentInfo(const ComponentInfo& component_info) noexcept;
 
     template <Component T>
     auto GetComponentInfo() const noexcept -> const ComponentInfo&;
     auto GetComponentInfo(utils::TypeID component_id) const noexcept -> const ComponentInfo&;
 
-    auto GetOrCreateArchetype(const detail::ComponentInfoSet& component_infos) noexcept -> Archetype&;
+    // The shared components without given values are default constructed.
+    // The last frame columns of double-buffered components are added or removed with the components.
+    auto GetOrCreateArchetype(const detail::ComponentInfoSet& component_infos, const detail::SharedComponentValues& shared_values = {}) noexcept -> Archetype&;
+
+    // move the entity to the new archetype, the components which are not in the old archetype are left unconstructed
+    void MoveEntity(entity_id_t entity, Archetype& old_archetype, Archetype& new_archetype) noexcept;
 
     struct ComponentData {
-        std::byte*  data;
-        std::size_t size;
-        std::size_t num_entities;
+        std::byte*     data;
+        std::size_t    size;
+        std::size_t    num_entities;
+        std::uint64_t* version;
+        // sparse components have no data in chunks, they are looked up by entity
+        SparseSet*     sparse_set        = nullptr;
+        // the filter depends on sparse components, so it is evaluated for each entity
+        bool           filter_per_entity = false;
+        // the position of the chunk, which is stable while archetypes are created or destroyed
+        std::uint64_t  archetype_serial  = 0;
+        std::size_t    chunk_index       = 0;
 
         auto operator[](std::size_t index) const noexcept -> std::byte* { return data + index * size; }
     };
+    // [num_components + 1, num_buffers], the last row is the `Entity` column
     auto GetComponentsBuffers(const detail::ComponentIdList& components, Filter filter) const noexcept
         -> std::pmr::vector<std::pmr::vector<ComponentData>>;
 
-    World& m_World;
-
-    std::size_t m_Counter = 0;
-
-    std::pmr::unordered_map<archetype_id_t, std::unique_ptr<Archetype>> m_Archetypes;
-    std::pmr::unordered_map<entity_id_t, Archetype*>                    m_EntityMaps;
-    std::pmr::unordered_map<utils::TypeID, ComponentInfo>               m_ComponentMap;
+    // the written components are stamped with the version
+    template <typename... Components>
+    auto QueryImpl(Filter filter, std::uint64_t version) const -> ChunkQuery<Components...>;
+
+    World&      m_World;
+    ChunkConfig m_ChunkConfig;
+    // destroyed after archetypes which release their chunks to it
+    ChunkPool   m_ChunkPool;
+
+    std::atomic<entity_id_t>   m_Counter          = 0;
+    std::atomic<std::uint64_t> m_Version          = 0;
+    std::atomic<std::uint64_t> m_CommandSequence  = 0;
+    // the version when double-buffered components were copied last time
+    std::uint64_t              m_LastFrameVersion = 0;
+
+    // keyed by the hash of signature and shared values, archetypes with the same key are distinguished by comparing them
+    std::pmr::unordered_multimap<archetype_id_t, std::unique_ptr<Archetype>> m_Archetypes;
+    // the serial of the next created archetype
+    std::uint64_t                                                            m_NumCreatedArchetypes = 0;
+    EntityMap<Archetype*>                                                    m_EntityMaps{nullptr};
+    std::pmr::unordered_map<utils::TypeID, ComponentInfo>                    m_ComponentMap;
+    std::pmr::unordered_map<utils::TypeID, std::unique_ptr<SparseSet>>       m_SparseSets;
+    // the components with sparse sets, filters on them are evaluated for each entity
+    ComponentSignature                                                       m_SparseSignature;
+    // double-buffered component -> its last frame component
+    std::pmr::unordered_map<utils::TypeID, ComponentInfo>                    m_LastFrameComponents;
+    // the number of updates that an empty archetype has been empty
+    std::pmr::unordered_map<const Archetype*, std::size_t>                   m_EmptyArchetypes;
 };
 
 template <Component... Components>
@@ -95,68 +251,79 @@ template <Component... Components>
 }
 
 template <Component T>
-bool EntityManager::HasComponent(entity_id_t entity) const noexcept {
-    const auto& component_infos = m_EntityMaps.at(entity)->GetComponentInfoSet();
-    return std::find_if(component_infos.begin(), component_infos.end(), [](const auto& info) { return info.type_id == utils::TypeID::Create<T>(); }) != component_infos.end();
+bool EntityManager::HasComponent(entity_id_t entity) const {
+    if constexpr (SparseComponent<T>) {
+        const auto sparse_set = GetSparseSet(utils::TypeID::Create<T>());
+        return sparse_set && sparse_set->Contains(entity);
+    }
+    return m_EntityMaps.at(entity)->HasComponent<T>();
 }
 
 template <Component T, typename... Args>
-    requires utils::not_same_as<T, Entity>
-auto EntityManager::EmplaceComponent(entity_id_t entity, Args&&... args) noexcept -> T& {
+    requires utils::not_same_as<T, Entity> && (!SharedComponent<T>)
+auto EntityManager::EmplaceComponent(entity_id_t entity, Args&&... args) -> T& {
+    static_assert(!ChunkComponent<T> || sizeof...(Args) == 0, "Chunk component is constructed with the chunk");
+
     if (HasComponent<T>(entity)) return GetComponent<T>(entity);
 
     UpdateComponentInfo<T>();
-    const auto new_component_id = utils::TypeID::Create<T>();
+
+    if constexpr (SparseComponent<T>) {
+        auto& sparse_set = GetOrCreateSparseSet(GetComponentInfo<T>());
+        return *std::construct_at(reinterpret_cast<T*>(sparse_set.Allocate(entity)), std::forward<Args>(args)...);
+    }
 
     auto& old_archetype   = *m_EntityMaps.at(entity);
     auto  component_infos = old_archetype.GetComponentInfoSet();
 
     component_infos.emplace(detail::create_static_component_info<T>());
-    Archetype& new_archetype = GetOrCreateArchetype(component_infos);
-
-    new_archetype.AllocateFor(entity);
-
-    for (const auto& component_info : component_infos) {
-        const auto component_id = component_info.type_id;
-        if (new_component_id == component_id) {
-            new_archetype.ConstructComponent<T>(entity, std::forward<Args>(args)...);
-        } else {
-            new_archetype.MoveConstructComponent(component_id, entity, old_archetype.GetComponentData(component_id, entity));
-            old_archetype.DestructComponent(component_id, entity);
-        }
+    Archetype& new_archetype = GetOrCreateArchetype(component_infos, old_archetype.GetSharedComponentValues());
+
+    MoveEntity(entity, old_archetype, new_archetype);
+    if constexpr (detail::get_component_storage<T>() == ComponentStorage::Entity) {
+        new_archetype.ConstructComponent<T>(entity, std::forward<Args>(args)...);
     }
 
-    old_archetype.DeallocateFor(entity);
+    return new_archetype.GetComponent<T>(entity);
+}
+
+template <SharedComponent T>
+auto EntityManager::SetSharedComponent(entity_id_t entity, T value) -> const T& {
+    if (HasComponent<T>(entity) && GetComponent<T>(entity) == value) return GetComponent<T>(entity);
 
-    m_EntityMaps[entity] = &new_archetype;
+    UpdateComponentInfo<T>();
 
-    return new_archetype.GetComponent<T>(entity);
+    auto& old_archetype   = *m_EntityMaps.at(entity);
+    auto  component_infos = old_archetype.GetComponentInfoSet();
+    auto  shared_values   = old_archetype.GetSharedComponentValues();
+
+    component_infos.emplace(detail::create_static_component_info<T>());
+    shared_values[utils::TypeID::Create<T>()] = reinterpret_cast<const std::byte*>(&value);
+
+    MoveEntity(entity, old_archetype, GetOrCreateArchetype(component_infos, shared_values));
+
+    return GetComponent<T>(entity);
 }
 
 template <Component T>
     requires utils::not_same_as<T, Entity>
-void EntityManager::RemoveComponent(entity_id_t entity) noexcept {
+void EntityManager::RemoveComponent(entity_id_t entity) {
     if (!HasComponent<T>(entity)) return;
 
+    if constexpr (SparseComponent<T>) {
+        GetSparseSet(utils::TypeID::Create<T>())->Remove(entity);
+        return;
+    }
+
     auto& old_archetype   = *m_EntityMaps.at(entity);
     auto  component_infos = old_archetype.GetComponentInfoSet();
 
     const auto removed_component_id = utils::TypeID::Create<T>();
     std::erase_if(component_infos, [=](const auto& info) { return info.type_id == removed_component_id; });
-    Archetype& new_archetype = GetOrCreateArchetype(component_infos);
-
-    new_archetype.AllocateFor(entity);
+    Archetype& new_archetype = GetOrCreateArchetype(component_infos, old_archetype.GetSharedComponentValues());
 
-    for (const auto& component_info : component_infos) {
-        const auto component_id = component_info.type_id;
-        new_archetype.MoveConstructComponent(component_id, entity, old_archetype.GetComponentData(component_id, entity));
-        old_archetype.DestructComponent(component_id, entity);
-    }
     old_archetype.DestructComponent<T>(entity);
-
-    old_archetype.DeallocateFor(entity);
-
-    m_EntityMaps[entity] = &new_archetype;
+    MoveEntity(entity, old_archetype, new_archetype);
 }
 
 template <Component T>
@@ -166,12 +333,19 @@ auto EntityManager::GetComponent(entity_id_t entity) const -> T& {
         throw std::invalid_argument(error_message);
     }
 
+    if constexpr (SparseComponent<T>) {
+        return *reinterpret_cast<T*>(GetSparseSet(utils::TypeID::Create<T>())->Get(entity));
+    }
     return m_EntityMaps.at(entity)->GetComponent<T>(entity);
 }
 
 template <Component T>
-void EntityManager::UpdateComponentInfo() noexcept {
-    m_ComponentMap.emplace(utils::TypeID::Create<T>(), detail::create_static_component_info<T>());
+void EntityManager::UpdateComponentInfo() {
+    if constexpr (DoubleBufferedComponent<T>) {
+        if (!m_ComponentMap.contains(utils::TypeID::Create<T>())) UpdateComponentInfo(detail::create_static_component_info<T>());
+    } else {
+        m_ComponentMap.emplace(utils::TypeID::Create<T>(), detail::create_static_component_info<T>());
+    }
 }
 
 template <Component T>
@@ -0,0 +1,124 @@
+#pragma once
+#include <hitagi/ecs/common_types.hpp>
+
+#include <fmt/format.h>
+
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace hitagi::ecs {
+
+// Map entities to values by paged arrays instead of hash nodes, so that inserting or erasing an entity never allocates
+// except for a new page. Entity ids are given by an increasing counter, the entities alive at the same time are packed
+// in a few pages. A page is allocated when an entity in it is inserted and released when the last one is erased.
+// The slots of absent entities hold `invalid`, which can not be inserted.
+template <typename T, std::size_t PageSize = 4096>
+class EntityMap {
+public:
+    explicit EntityMap(T invalid = T{}) : m_Invalid(invalid) {}
+
+    inline auto size() const noexcept { return m_Size; }
+    inline bool empty() const noexcept { return m_Size == 0; }
+
+    inline bool contains(entity_id_t entity) const noexcept { return Find(entity) != nullptr; }
+
+    inline auto at(entity_id_t entity) -> T& { return const_cast<T&>(std::as_const(*this).at(entity)); }
+    auto        at(entity_id_t entity) const -> const T&;
+
+    // return false and keep the old value if the entity exists
+    bool emplace(entity_id_t entity, T value);
+    void insert_or_assign(entity_id_t entity, T value);
+    // return false if the entity does not exist
+    bool erase(entity_id_t entity) noexcept;
+    void clear() noexcept;
+
+private:
+    struct Page {
+        std::pmr::vector<T> values;
+        std::size_t         num_entities = 0;
+    };
+
+    auto Find(entity_id_t entity) const noexcept -> const T*;
+    auto GetOrCreateSlot(entity_id_t entity) -> T&;
+
+    T                      m_Invalid;
+    std::pmr::vector<Page> m_Pages;
+    std::size_t            m_Size = 0;
+};
+
+template <typename T, std::size_t PageSize>
+auto EntityMap<T, PageSize>::at(entity_id_t entity) const -> const T& {
+    const auto value = Find(entity);
+    if (value == nullptr) {
+        throw std::out_of_range(fmt::format("Entity({}) does not exist", entity));
+    }
+    return *value;
+}
+
+template <typename T, std::size_t PageSize>
+bool EntityMap<T, PageSize>::emplace(entity_id_t entity, T value) {
+    auto& slot = GetOrCreateSlot(entity);
+    if (slot != m_Invalid) return false;
+
+    slot = std::move(value);
+    m_Pages[entity / PageSize].num_entities++;
+    m_Size++;
+    return true;
+}
+
+template <typename T, std::size_t PageSize>
+void EntityMap<T, PageSize>::insert_or_assign(entity_id_t entity, T value) {
+    auto& slot = GetOrCreateSlot(entity);
+    if (slot == m_Invalid) {
+        m_Pages[entity / PageSize].num_entities++;
+        m_Size++;
+    }
+    slot = std::move(value);
+}
+
+template <typename T, std::size_t PageSize>
+bool EntityMap<T, PageSize>::erase(entity_id_t entity) noexcept {
+    const auto value = Find(entity);
+    if (value == nullptr) return false;
+
+    auto& page                      = m_Pages[entity / PageSize];
+    page.values[entity % PageSize] = m_Invalid;
+    if (--page.num_entities == 0) {
+        page.values = {};
+    }
+    m_Size--;
+    return true;
+}
+
+template <typename T, std::size_t PageSize>
+void EntityMap<T, PageSize>::clear() noexcept {
+    m_Pages.clear();
+    m_Size = 0;
+}
+
+template <typename T, std::size_t PageSize>
+auto EntityMap<T, PageSize>::Find(entity_id_t entity) const noexcept -> const T* {
+    const auto page_index = entity / PageSize;
+    if (page_index >= m_Pages.size() || m_Pages[page_index].values.empty()) {
+        return nullptr;
+    }
+    const auto& value = m_Pages[page_index].values[entity % PageSize];
+    return value == m_Invalid ? nullptr : &value;
+}
+
+template <typename T, std::size_t PageSize>
+auto EntityMap<T, PageSize>::GetOrCreateSlot(entity_id_t entity) -> T& {
+    const auto page_index = entity / PageSize;
+    if (page_index >= m_Pages.size()) {
+        m_Pages.resize(page_index + 1);
+    }
+    auto& page = m_Pages[page_index];
+    if (page.values.empty()) {
+        page.values.resize(PageSize, m_Invalid);
+    }
+    return page.values[entity % PageSize];
+}
+
+}  // namespace hitagi::ecs
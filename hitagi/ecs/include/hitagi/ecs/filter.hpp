@@ -5,65 +5,70 @@
 
 namespace hitagi::ecs {
 
-class ComponentChecker {
-public:
-    template <Component T>
-    inline bool Exists() const noexcept;
-    inline bool Exists(std::string_view dynamic_component) const noexcept;
+// Select the entities by their components. The components are given as signatures, so an archetype is matched
+// by a few word-wise operations. Sparse components are not in the signatures of archetypes, a filter on them is
+// evaluated for each entity.
+struct Filter {
+    // the entity has all components of `all`, at least one of `any` if it is not empty, and none of `none`
+    ComponentSignature all;
+    ComponentSignature any;
+    ComponentSignature none;
 
-private:
-    friend class EntityManager;
-    ComponentChecker(Archetype* archetype) : m_Archetype(archetype) {}
+    // (id, index) of the components in the filter, the sparse ones are looked up by entity
+    std::pmr::vector<std::pair<utils::TypeID, std::uint32_t>> components;
 
-    bool Exists(utils::TypeID component) const noexcept;
+    explicit operator bool() const noexcept { return !components.empty(); }
 
-    Archetype* m_Archetype;
+    inline auto GetSignature() const noexcept { return all | any | none; }
+
+    // the components in `unknown` may or may not exist, so they do not reject the signature
+    inline bool MayMatch(const ComponentSignature& signature, const ComponentSignature& unknown) const noexcept {
+        const auto known_all  = all & ~unknown;
+        const auto known_none = none & ~unknown;
+        return (signature & known_all) == known_all &&
+               (signature & known_none).none() &&
+               (any.none() || (any & (signature | unknown)).any());
+    }
+    inline bool Matches(const ComponentSignature& signature) const noexcept { return MayMatch(signature, {}); }
 };
 
-using Filter = std::function<bool(const ComponentChecker&)>;
+namespace detail {
+template <Component... Components>
+void add_filter_components(Filter& filter, ComponentSignature& signature, const DynamicComponentSet& dynamic_components) {
+    const auto add = [&](utils::TypeID component_id, std::uint32_t index) {
+        signature.set(index);
+        filter.components.emplace_back(component_id, index);
+    };
+    (add(utils::TypeID::Create<Components>(), get_component_index<Components>()), ...);
+    for (const auto& dynamic_component : dynamic_components) {
+        const auto component_id = utils::TypeID(dynamic_component);
+        add(component_id, register_component_index(component_id));
+    }
+}
+}  // namespace detail
 
 namespace filter {
 template <Component... Components>
-Filter All(const DynamicComponentSet& dynamic_components = {}) noexcept {
-    return [=](const ComponentChecker& checker) {
-        bool result = (checker.Exists<Components>() && ...);
-        for (const auto& dynamic_component : dynamic_components) {
-            result &= checker.Exists(dynamic_component);
-        }
-        return result;
-    };
+Filter All(const DynamicComponentSet& dynamic_components = {}) {
+    Filter result;
+    detail::add_filter_components<Components...>(result, result.all, dynamic_components);
+    return result;
 }
 
 template <Component... Components>
-Filter Any(const DynamicComponentSet& dynamic_components = {}) noexcept {
-    return [=](const ComponentChecker& checker) {
-        bool result = (checker.Exists<Components>() || ...);
-        for (const auto& dynamic_component : dynamic_components) {
-            result |= checker.Exists(dynamic_component);
-        }
-        return result;
-    };
+Filter Any(const DynamicComponentSet& dynamic_components = {}) {
+    Filter result;
+    detail::add_filter_components<Components...>(result, result.any, dynamic_components);
+    return result;
 }
 
 template <Component... Components>
-Filter None(const DynamicComponentSet& dynamic_components = {}) noexcept {
-    return [=](const ComponentChecker& checker) {
-        bool result = !(checker.Exists<Components>() || ...);
-        for (const auto& dynamic_component : dynamic_components) {
-            result &= !checker.Exists(dynamic_component);
-        }
-        return result;
-    };
+Filter None(const DynamicComponentSet& dynamic_components = {}) {
+    Filter result;
+    detail::add_filter_components<Components...>(result, result.none, dynamic_components);
+    return result;
 }
 
 }  // namespace filter
 
-template <Component T>
-inline bool ComponentChecker::Exists() const noexcept {
-    return Exists(utils::TypeID::Create<T>());
-}
-inline bool ComponentChecker::Exists(std::string_view dynamic_component) const noexcept {
-    return Exists(utils::TypeID(dynamic_component));
-}
-
-}  // namespace hitagi::ecs
\ No newline at end of file
+}  // namespace hitagi::ecs
@@ -0,0 +1,82 @@
+#pragma once
+#include <hitagi/ecs/entity_manager.hpp>
+#include <hitagi/gfx/device.hpp>
+
+namespace hitagi::ecs {
+
+struct GPUMirrorStats {
+    // a byte range of a column buffer written by the last upload
+    struct Range {
+        utils::TypeID    component_id;
+        const Archetype* archetype;
+        std::size_t      offset;
+        std::size_t      size;
+    };
+
+    std::size_t uploaded_bytes = 0;
+    // columns whose buffer was (re)created, they are uploaded entirely
+    std::size_t num_created_buffers = 0;
+    // in the order of the copies, the adjacent dirty chunks of a column are merged into one range
+    std::pmr::vector<Range> ranges;
+};
+
+// Keeps a GPU buffer for each column of the `GPUMirroredComponent`s, the component of i-th entity in c-th chunk
+// is at `c * num_entities_per_chunk + i` of the buffer. Only the chunks written since the last upload are copied,
+// so writes outside of tasks and queries must be marked by `Entity::MarkChanged`.
+class GPUMirror {
+public:
+    struct Column {
+        const Archetype*                archetype;
+        std::shared_ptr<gfx::GPUBuffer> buffer;
+        std::size_t                     num_entities_per_chunk;
+        // the slots beyond it are left from the removed entities
+        std::size_t                     num_entities;
+    };
+
+    GPUMirror(EntityManager& entity_manager, gfx::Device& device);
+    ~GPUMirror();
+
+    // Copy the dirty chunks to the column buffers on the copy queue, it must not be called while the world is updating.
+    // The queues reading the buffers wait for `GetFence()` to reach `GetFenceValue()`.
+    void Upload();
+
+    auto GetColumns(utils::TypeID component_id) const -> std::pmr::vector<Column>;
+    template <GPUMirroredComponent T>
+    inline auto GetColumns() const { return GetColumns(utils::TypeID::Create<T>()); }
+
+    inline auto& GetFence() const noexcept { return *m_Fence; }
+    inline auto  GetFenceValue() const noexcept { return m_FenceValue; }
+
+    inline auto& GetLastUploadStats() const noexcept { return m_LastUploadStats; }
+
+private:
+    struct Mirror {
+        const Archetype*                archetype = nullptr;
+        std::shared_ptr<gfx::GPUBuffer> buffer;
+        std::size_t                     num_entities_per_chunk = 0;
+        std::size_t                     num_entities           = 0;
+        // the version of entity manager when the column was uploaded last time
+        std::uint64_t                   version = 0;
+    };
+
+    // the resources which may still be used by the copy queue, they are released after the fence reaches `fence_value`
+    struct Retired {
+        std::shared_ptr<gfx::GPUBuffer>      buffer;
+        std::shared_ptr<gfx::CommandContext> context;
+        std::uint64_t                        fence_value;
+    };
+
+    EntityManager& m_EntityManager;
+    gfx::Device&   m_Device;
+
+    // keyed by the serials of archetypes, since the address of a destroyed archetype may be reused by a new one
+    std::pmr::unordered_map<utils::TypeID, std::pmr::unordered_map<std::uint64_t, Mirror>> m_Mirrors;
+
+    std::shared_ptr<gfx::Fence> m_Fence;
+    std::uint64_t               m_FenceValue = 0;
+    std::pmr::vector<Retired>   m_RetiredResources;
+
+    GPUMirrorStats m_LastUploadStats;
+};
+
+}  // namespace hitagi::ecs
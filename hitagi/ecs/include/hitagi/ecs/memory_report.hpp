@@ -0,0 +1,42 @@
+#pragma once
+#include <hitagi/ecs/component.hpp>
+#include <hitagi/ecs/chunk_pool.hpp>
+
+namespace hitagi::ecs {
+
+struct ComponentMemoryReport {
+    std::pmr::string name;
+    ComponentStorage storage        = ComponentStorage::Entity;
+    std::size_t      component_size = 0;
+    // the memory kept for the component, including the alignment padding of its columns or the spare capacity of sparse set
+    std::size_t      reserved_bytes = 0;
+    // the memory of existing components
+    std::size_t      used_bytes     = 0;
+};
+
+struct ArchetypeMemoryReport {
+    std::size_t num_chunks             = 0;
+    std::size_t num_entities           = 0;
+    std::size_t num_entities_per_chunk = 0;
+    std::size_t chunk_size             = 0;
+    // the entities divided by the entities that the chunks can hold
+    double      utilization            = 0.0;
+    // the chunk memory which can not hold any component, that is the alignment padding of columns and the tail of chunks
+    std::size_t padding_bytes          = 0;
+
+    std::pmr::vector<ComponentMemoryReport> components;
+};
+
+struct MemoryReport {
+    std::pmr::vector<ArchetypeMemoryReport> archetypes;
+    std::pmr::vector<ComponentMemoryReport> sparse_components;
+    ChunkPoolStats                          chunk_pool;
+
+    // the memory of chunks in use and in pool, shared components and sparse sets
+    std::size_t total_bytes = 0;
+
+    // for offline analysis, components are identified by their names
+    auto ToJson() const -> std::pmr::string;
+};
+
+}  // namespace hitagi::ecs
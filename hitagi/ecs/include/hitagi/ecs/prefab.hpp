@@ -0,0 +1,74 @@
+#pragma once
+#include <hitagi/ecs/entity.hpp>
+#include <hitagi/core/buffer.hpp>
+
+namespace hitagi::ecs {
+
+// Maps the entities captured in a prefab to the ones of an instance,
+// the references to entities outside of the prefab are cleared.
+class EntityRemap {
+public:
+    auto operator()(const Entity& entity) const noexcept -> Entity;
+
+private:
+    friend EntityManager;
+
+    EntityRemap(const EntityManager* source, EntityManager& entity_manager, const std::pmr::unordered_map<entity_id_t, std::size_t>& entity_indices, entity_id_t first_entity)
+        : m_Source(source), m_EntityManager(entity_manager), m_EntityIndices(entity_indices), m_FirstEntity(first_entity) {}
+
+    const EntityManager*                                     m_Source;
+    EntityManager&                                           m_EntityManager;
+    const std::pmr::unordered_map<entity_id_t, std::size_t>& m_EntityIndices;
+    entity_id_t                                              m_FirstEntity;
+};
+
+// A template of entities captured from an entity manager, it can be instantiated many times in any entity manager.
+// The components are copied when captured, so later changes of the captured entities do not affect the prefab.
+// Chunk components are not captured since they belong to chunks.
+class Prefab {
+public:
+    Prefab() = default;
+    Prefab(const Prefab&)            = delete;
+    Prefab& operator=(const Prefab&) = delete;
+    Prefab(Prefab&&) noexcept;
+    Prefab& operator=(Prefab&&) noexcept;
+    ~Prefab();
+
+    inline auto NumEntities() const noexcept { return m_EntityIndices.size(); }
+
+private:
+    friend EntityManager;
+
+    struct Column {
+        ComponentInfo component_info;
+        // the components of the entities in the group, or the only value of a shared component
+        core::Buffer  data;
+        std::size_t   num_components;
+    };
+
+    // the captured entities in one archetype, they are instantiated into one archetype
+    struct Group {
+        detail::ComponentInfoSet      component_infos;
+        // the index in prefab of each entity in the group
+        std::pmr::vector<std::size_t> entity_indices;
+        // the `Entity` column is not stored
+        std::pmr::vector<Column>      columns;
+        detail::SharedComponentValues shared_values;
+    };
+
+    struct SparseComponent {
+        ComponentInfo component_info;
+        std::size_t   entity_index;
+        core::Buffer  data;
+    };
+
+    void Destroy() noexcept;
+
+    // the entity manager where the entities are captured
+    const EntityManager*                              m_Source = nullptr;
+    std::pmr::vector<Group>                           m_Groups;
+    std::pmr::vector<SparseComponent>                 m_SparseComponents;
+    std::pmr::unordered_map<entity_id_t, std::size_t> m_EntityIndices;
+};
+
+}  // namespace hitagi::ecs
@@ -0,0 +1,115 @@
+#pragma once
+#include <hitagi/ecs/world.hpp>
+
+#include <span>
+#include <tuple>
+
+namespace hitagi::ecs {
+
+// The components of the chunks matched by `EntityManager::Query`, each chunk is a tuple of spans in the order of `Components`.
+// Entity components have a value per entity, while chunk and shared components have one value per chunk.
+// A filter on sparse components is evaluated for each entity, and a partly matched chunk is split into the runs of matched entities.
+// The spans are invalidated when entities are created, destroyed or moved, so do not keep it across updates.
+template <QueryComponent... Components>
+class ChunkQuery {
+public:
+    using Chunk = std::tuple<std::span<Components>...>;
+
+    inline auto begin() const noexcept { return m_Chunks.begin(); }
+    inline auto end() const noexcept { return m_Chunks.end(); }
+    inline auto NumChunks() const noexcept { return m_Chunks.size(); }
+    inline auto NumEntities() const noexcept { return m_NumEntities; }
+    inline auto operator[](std::size_t index) const noexcept -> const Chunk& { return m_Chunks[index]; }
+
+    // call `func(chunk)` for each chunk on the workers of the world and wait for them
+    template <typename Func>
+        requires std::invocable<Func&, const Chunk&>
+    void ParallelForEach(Func&& func) const {
+        m_World.ParallelFor(m_Chunks.size(), [&](std::size_t index) { func(m_Chunks[index]); });
+    }
+
+private:
+    friend EntityManager;
+
+    ChunkQuery(World& world) : m_World(world) {}
+
+    World&                  m_World;
+    std::pmr::vector<Chunk> m_Chunks;
+    std::size_t             m_NumEntities = 0;
+};
+
+template <typename... Components>
+    requires(QueryComponent<Components> && ...)
+auto EntityManager::Query(Filter filter) -> ChunkQuery<Components...> {
+    // writes through the spans are seen by `Changed<T>` as if they were made by a task
+    constexpr bool has_write = !(std::is_const_v<Components> && ...);
+    return QueryImpl<Components...>(std::move(filter), has_write ? NextVersion() : 0);
+}
+
+template <typename... Components>
+    requires((QueryComponent<Components> && std::is_const_v<Components>) && ...)
+auto EntityManager::Query(Filter filter) const -> ChunkQuery<Components...> {
+    return QueryImpl<Components...>(std::move(filter), 0);
+}
+
+template <typename... Components>
+auto EntityManager::QueryImpl(Filter filter, std::uint64_t version) const -> ChunkQuery<Components...> {
+    ChunkQuery<Components...> result(m_World);
+
+    const auto components_buffers = GetComponentsBuffers(detail::create_component_id_list<std::remove_const_t<Components>...>(), filter);
+    if (components_buffers.empty()) return result;
+
+    const auto& entity_buffers = components_buffers.back();
+    const auto  num_buffers    = entity_buffers.size();
+    result.m_Chunks.reserve(num_buffers);
+    for (std::size_t buffer_index = 0; buffer_index < num_buffers; buffer_index++) {
+        const auto& entity_data  = entity_buffers[buffer_index];
+        const auto  num_entities = entity_data.num_entities;
+        if (num_entities == 0) continue;
+
+        // the entities in [first, last) of the chunk
+        const auto emplace_chunk = [&]<std::size_t... I>(std::index_sequence<I...>, std::size_t first, std::size_t last) {
+            result.m_Chunks.emplace_back(
+                detail::get_component_storage<std::remove_const_t<Components>>() == ComponentStorage::Entity
+                    ? std::span<Components>(reinterpret_cast<Components*>(components_buffers[I][buffer_index][first]), last - first)
+                    : std::span<Components>(reinterpret_cast<Components*>(components_buffers[I][buffer_index].data), 1)...);
+            result.m_NumEntities += last - first;
+        };
+
+        std::size_t num_matched = num_entities;
+        if (!entity_data.filter_per_entity) {
+            emplace_chunk(std::index_sequence_for<Components...>{}, 0, num_entities);
+        } else {
+            num_matched = 0;
+            for (std::size_t first = 0; first < num_entities;) {
+                const auto matched = [&](std::size_t entity_index) {
+                    return FilterEntity(filter, reinterpret_cast<const Entity*>(entity_data[entity_index])->GetId());
+                };
+                if (!matched(first)) {
+                    first++;
+                    continue;
+                }
+                auto last = first + 1;
+                while (last < num_entities && matched(last)) last++;
+                emplace_chunk(std::index_sequence_for<Components...>{}, first, last);
+                num_matched += last - first;
+                first = last;
+            }
+        }
+        if (num_matched == 0) continue;
+
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            ([&] {
+                if constexpr (!std::is_const_v<Components>) {
+                    if (const auto component_version = components_buffers[I][buffer_index].version) {
+                        std::atomic_ref(*component_version).store(version, std::memory_order_relaxed);
+                    }
+                }
+            }(),
+             ...);
+        }(std::index_sequence_for<Components...>{});
+    }
+    return result;
+}
+
+}  // namespace hitagi::ecs
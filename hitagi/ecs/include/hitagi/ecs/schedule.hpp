@@ -4,13 +4,35 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <span>
 #include <type_traits>
 #include <vector>
 
 namespace hitagi::ecs {
 
+// Limit the chunks that a task visits in one frame, the others are left to the next frames in round-robin.
+// The task visits at least one chunk each frame, so it always makes progress.
+struct TaskBudget {
+    std::size_t              max_chunks = std::numeric_limits<std::size_t>::max();
+    std::chrono::nanoseconds max_time   = std::chrono::nanoseconds::max();
+};
+
 class Schedule {
+    // the chunk where a task with budget continues, archetypes are ordered by their serials
+    struct ChunkCursor {
+        std::uint64_t archetype_serial = 0;
+        std::size_t   chunk_index      = 0;
+
+        auto operator<=>(const ChunkCursor&) const = default;
+    };
+
     struct TaskBase {
         TaskBase(std::string_view name, detail::ComponentIdList component_list, Filter filter)
             : name(name), component_list(std::move(component_list)), filter(std::move(filter)) {}
@@ -20,6 +42,25 @@ class Schedule {
         std::pmr::string        name;
         detail::ComponentIdList component_list;
         Filter                  filter;
+        // the version of the last run, chunks written before it are skipped by `Changed<T>` parameters
+        std::uint64_t           last_run_version = 0;
+        // filled by the task and the schedule when it runs
+        TaskStats               stats;
+        // the system requesting the task, its tasks are kept in the graph but do nothing when it is skipped
+        std::optional<utils::TypeID> system;
+        bool                         enabled = true;
+
+        // A task with budget continues from the chunk where it stopped last frame. When it has visited all chunks,
+        // the version it started from the first chunk becomes the last run version.
+        std::optional<TaskBudget>  budget;
+        std::optional<ChunkCursor> cursor;
+        std::uint64_t              cycle_version = 0;
+
+        inline bool OverBudget(std::chrono::steady_clock::time_point start_time) const noexcept {
+            if (!budget || stats.num_chunks == 0) return false;
+            return stats.num_chunks >= budget->max_chunks ||
+                   (budget->max_time != std::chrono::nanoseconds::max() && std::chrono::steady_clock::now() - start_time >= budget->max_time);
+        }
     };
 
     template <typename Func>
@@ -33,8 +74,15 @@ class Schedule {
 
 public:
     Schedule(World& world) : world(world) {}
+    Schedule(const Schedule&)            = delete;
+    Schedule& operator=(const Schedule&) = delete;
 
     // Do task on the entities that contains components indicated at parameters.
+    // If all parameters are `std::span<T>` or `std::span<const T>`, the task is called once per chunk
+    // with the components of all entities in it, so that the loop over entities can be vectorized.
+    // The span of a chunk or shared component has only one element.
+    // Sparse components are looked up for each entity, so they can not be requested by chunk tasks, and
+    // a filter on them is evaluated for each entity, except in chunk tasks where they are regarded as absent.
     template <typename Func>
     Schedule& Request(
         std::string_view     name,
@@ -44,10 +92,14 @@ public:
 
     void SetOrder(std::string_view first_task, std::string_view second_task);
 
+    // the budget is given with the requests like the order, a task without budget visits all remaining chunks
+    void SetBudget(std::string_view task, TaskBudget budget);
+
     World& world;
 
 private:
     friend World;
+    friend SystemManager;
 
     using ReadBeforeWriteParameters = std::pmr::set<utils::TypeID>;
     using WriteParameters           = std::pmr::set<utils::TypeID>;
@@ -59,25 +111,65 @@ private:
 
     void Request(std::shared_ptr<TaskBase> task, const ParameterSets& parameter_sets);
 
-    void Run(tf::Executor& executor);
+    // the tasks of a disabled system are skipped without changing the task graph
+    void SetSystemEnabled(utils::TypeID system, bool enabled) noexcept;
 
-    bool CheckValid(const std::pmr::unordered_map<std::size_t, std::pmr::unordered_set<std::size_t>>& graph);
+    // clear the requests when the enabled systems change, the compiled task graph is kept
+    void Reset();
+    void Run(tf::Executor& executor, FrameStats& frame_stats);
+
+    // The task graph only depends on the names, parameters and custom orders of the tasks,
+    // so it is compiled again only when they are different from the ones compiled last time.
+    bool NeedCompile() const noexcept;
+    void Compile(tf::Executor& executor);
+
+    void RunTask(std::size_t index, tf::Executor& executor);
+    // fill the wait time of tasks and the critical path after all tasks finished
+    void AnalyzeDependencies(FrameStats& frame_stats) const;
 
-    std::pmr::vector<std::shared_ptr<TaskBase>>                           m_Tasks;
-    std::pmr::unordered_map<std::pmr::string, std::size_t>                m_TaskNameToIndex;
-    std::pmr::unordered_map<utils::TypeID, std::pmr::vector<std::size_t>> m_ReadBeforeWriteSet;
-    std::pmr::unordered_map<utils::TypeID, std::pmr::vector<std::size_t>> m_WriteSet;
-    std::pmr::unordered_map<utils::TypeID, std::pmr::vector<std::size_t>> m_ReadAfterWriteSet;
+    bool CheckValid(const std::pmr::unordered_map<std::size_t, std::pmr::unordered_set<std::size_t>>& graph);
 
+    std::pmr::vector<std::shared_ptr<TaskBase>>                  m_Tasks;
+    std::pmr::vector<ParameterSets>                              m_TaskParameterSets;
+    std::pmr::unordered_map<std::pmr::string, std::size_t>       m_TaskNameToIndex;
     std::pmr::unordered_map<std::pmr::string, std::pmr::string> m_CustomOrder;
+    std::pmr::unordered_map<std::pmr::string, TaskBudget>       m_TaskBudgets;
+    // set by the system manager while a system is requesting tasks
+    std::optional<utils::TypeID>                                 m_RequestingSystem;
+
+    struct CompiledGraph {
+        std::pmr::vector<std::pmr::string>                          task_names;
+        std::pmr::vector<ParameterSets>                             task_parameter_sets;
+        std::pmr::unordered_map<std::pmr::string, std::pmr::string> custom_order;
+
+        // the dependencies of each task and a topological order of them
+        std::pmr::vector<std::pmr::vector<std::size_t>> predecessors;
+        std::pmr::vector<std::size_t>                   topological_order;
+
+        tf::Taskflow taskflow;
+        bool         valid = false;
+    } m_CompiledGraph;
+
+    std::chrono::steady_clock::time_point m_StartTime;
+
+    // the states of a task kept across frames
+    struct TaskState {
+        std::uint64_t              last_run_version = 0;
+        std::optional<ChunkCursor> cursor;
+        std::uint64_t              cycle_version = 0;
+    };
+    std::pmr::unordered_map<std::pmr::string, TaskState> m_TaskStates;
 };
 
 namespace detail {
 template <typename T>
-concept ComponentValueType = Component<T>;
+concept SpanType = std::same_as<T, std::span<typename T::element_type>>;
 
 template <typename T>
-concept ComponentConstValueType = Component<std::remove_cv_t<T>> && std::is_const_v<T>;
+concept ComponentValueType = Component<T> && !SpanType<T>;
+
+template <typename T>
+concept ComponentConstValueType = Component<std::remove_cv_t<T>> && !SpanType<std::remove_cv_t<T>> && std::is_const_v<T>;
 
 template <typename T>
 concept ComponentReferenceType = Component<std::decay_t<T>> && utils::is_no_const_reference_v<T>;
@@ -90,8 +182,21 @@ concept DynamicComponentPointerType = std::same_as<T, std::byte*>;
 
 template <typename T>
 concept DynamicComponentConstPointerType = std::same_as<T, const std::byte*>;
+
+// the components of all entities in a chunk
+template <typename T>
+concept ComponentSpanType = SpanType<T> && ComponentValueType<typename T::element_type>;
+
+template <typename T>
+concept ComponentConstSpanType = SpanType<T> && ComponentConstValueType<typename T::element_type>;
+
+template <typename T>
+concept ChunkParameter = ComponentSpanType<T> || ComponentConstSpanType<T>;
 }  // namespace detail
 
+// The value of the component before the writers of this frame, the task runs before them.
+// For `DoubleBufferedComponent`, the value is read from the copy made at the start of this update,
+// so the task is not ordered with the writers.
 template <typename T>
     requires detail::ComponentValueType<T> ||
              detail::ComponentConstValueType<T> ||
@@ -105,37 +210,72 @@ struct LastFrame {
     T value;
 };
 
+// Only visit the chunks whose component `T` has been written since the task last ran.
+// If a task requests more than one `Changed<T>`, a chunk is visited when any of them has been changed.
+template <typename T>
+    requires detail::ComponentValueType<T> ||
+             detail::ComponentReferenceType<T> ||
+             detail::ComponentConstReferenceType<T>
+struct Changed {
+    using type = T;
+
+    inline operator T() const noexcept { return value; }
+    inline auto operator->() const noexcept { return &value; }
+
+    T value;
+};
+
 namespace detail {
 template <typename T>
 concept HasLastFrameTag = std::same_as<T, LastFrame<typename T::type>>;
 
+template <typename T>
+concept HasChangedTag = std::same_as<T, Changed<typename T::type>>;
+
 template <typename T>
 concept ReadBeforWriteParameter = HasLastFrameTag<T> &&
                                   (ComponentValueType<typename T::type> ||
                                    ComponentConstReferenceType<typename T::type> ||
                                    DynamicComponentConstPointerType<typename T::type>);
 
+// reads the last frame column of a double-buffered component, which is not written by any task
+template <typename T>
+concept DoubleBufferedParameter = ReadBeforWriteParameter<T> && DoubleBufferedComponent<std::remove_cvref_t<typename T::type>>;
+
 template <typename T>
 concept WriteParameter =
-    !HasLastFrameTag<std::decay_t<T>> &&
-    !std::same_as<T, Entity&> &&
-    (ComponentReferenceType<T> || DynamicComponentPointerType<T>);
+    (HasChangedTag<T> && ComponentReferenceType<typename T::type>) ||
+    (!HasLastFrameTag<std::decay_t<T>> &&
+     !HasChangedTag<std::decay_t<T>> &&
+     !std::same_as<T, Entity&> &&
+     (ComponentReferenceType<T> || DynamicComponentPointerType<T> || ComponentSpanType<T>));
 
 template <typename T>
 concept ReadAfterWriteParameter =
-    !HasLastFrameTag<std::decay_t<T>> && (ComponentValueType<T> ||
-                                          ComponentConstValueType<T> ||
-                                          ComponentConstReferenceType<T> ||
-                                          DynamicComponentConstPointerType<T>);
+    (HasChangedTag<T> && (ComponentValueType<typename T::type> || ComponentConstReferenceType<typename T::type>)) ||
+    (!HasLastFrameTag<std::decay_t<T>> &&
+     !HasChangedTag<std::decay_t<T>> && (ComponentValueType<T> ||
+                                         ComponentConstValueType<T> ||
+                                         ComponentConstReferenceType<T> ||
+                                         DynamicComponentConstPointerType<T> ||
+                                         ComponentConstSpanType<T>));
 
 template <typename T>
 concept ValidParameter = ReadBeforWriteParameter<T> || WriteParameter<T> || ReadAfterWriteParameter<T>;
 
 template <typename T>
-using remove_last_frame_tag_t = std::conditional_t<HasLastFrameTag<T>, T, utils::delay_type<T>>::type;
+struct span_element {
+    using type = typename T::element_type;
+};
+
+template <typename T>
+using remove_parameter_tag_t = std::conditional_t<
+    HasLastFrameTag<T> || HasChangedTag<T>,
+    T,
+    std::conditional_t<SpanType<T>, span_element<T>, utils::delay_type<T>>>::type;
 
 template <typename T>
-using decay_parameter_t = std::remove_cvref_t<remove_last_frame_tag_t<T>>;
+using decay_parameter_t = std::remove_cvref_t<remove_parameter_tag_t<T>>;
 
 struct Parameter {
     Parameter(std::byte* data) : data(data) {}
@@ -147,10 +287,15 @@ struct Parameter {
         if constexpr (DynamicComponentPointerType<T> || DynamicComponentConstPointerType<T>) {
             return {data};
         } else {
-            return {*reinterpret_cast<T*>(data)};
+            return {*reinterpret_cast<std::remove_reference_t<T>*>(data)};
         }
     };
 
+    template <typename T>
+    inline operator Changed<T>() const noexcept {
+        return {*reinterpret_cast<std::remove_reference_t<T>*>(data)};
+    };
+
     template <typename T>
         requires(!DynamicComponentPointerType<T> && !DynamicComponentConstPointerType<T>)
     inline operator T&() const noexcept {
@@ -175,6 +320,21 @@ Schedule& Schedule::Request(std::string_view name, Func&& task, DynamicComponent
     // make sure all parameters are valid
     []<std::size_t... I>(std::index_sequence<I...>) {
         static_assert((detail::ValidParameter<typename traits::template arg_t<I>> && ...), "Invalid parameter type");
+        static_assert((detail::ChunkParameter<typename traits::template arg_t<I>> && ...) ||
+                          (!detail::ChunkParameter<typename traits::template arg_t<I>> && ...),
+                      "Chunk task must take all parameters as std::span");
+        static_assert((!(detail::WriteParameter<typename traits::template arg_t<I>> &&
+                         SharedComponent<detail::decay_parameter_t<typename traits::template arg_t<I>>>) &&
+                       ...),
+                      "Shared component is read only in tasks");
+        static_assert((!(detail::ChunkParameter<typename traits::template arg_t<I>> &&
+                         SparseComponent<detail::decay_parameter_t<typename traits::template arg_t<I>>>) &&
+                       ...),
+                      "Sparse component can not be requested by chunk task");
+        static_assert((!(detail::HasChangedTag<typename traits::template arg_t<I>> &&
+                         SparseComponent<detail::decay_parameter_t<typename traits::template arg_t<I>>>) &&
+                       ...),
+                      "The changes of sparse component are not tracked");
     }(std::make_index_sequence<traits::args_size>{});
 
     // make sure all dynamic component after component
@@ -199,7 +359,14 @@ Schedule& Schedule::Request(std::string_view name, Func&& task, DynamicComponent
     }(std::make_index_sequence<traits::args_size>{});
 
     auto component_id_list = [&]<std::size_t... I>(std::index_sequence<I...>) {
-        return detail::create_component_id_list<detail::decay_parameter_t<typename traits::template arg_t<I>>...>(dynamic_components);
+        auto result = detail::create_component_id_list<detail::decay_parameter_t<typename traits::template arg_t<I>>...>(dynamic_components);
+        ([&] {
+            if constexpr (detail::DoubleBufferedParameter<typename traits::template arg_t<I>>) {
+                result[I] = detail::get_last_frame_component_id<detail::decay_parameter_t<typename traits::template arg_t<I>>>();
+            }
+        }(),
+         ...);
+        return result;
     }(std::make_index_sequence<first_dynamic_component_index>{});
 
     Request(std::make_shared<Task<Func>>(name, std::move(component_id_list), std::move(filter), std::forward<Func>(task)), std::move(parameter_sets));
@@ -211,7 +378,9 @@ template <typename T>
 void Schedule::FillParameterSets(ParameterSets& parameter_sets, std::string_view dynamic_component) {
     using ComponentType = detail::decay_parameter_t<T>;
 
-    if constexpr (detail::ReadBeforWriteParameter<T>) {
+    if constexpr (detail::DoubleBufferedParameter<T>) {
+        // no ordering with the writers
+    } else if constexpr (detail::ReadBeforWriteParameter<T>) {
         if constexpr (utils::remove_const_pointer_same<ComponentType, std::byte*>) {
             std::get<0>(parameter_sets).emplace(utils::TypeID{dynamic_component});
         } else {
@@ -237,17 +406,94 @@ void Schedule::Task<Func>::Run(World& world) {
     using traits = utils::function_traits<Func>;
 
     [&]<std::size_t... I>(std::index_sequence<I...>) {
-        const auto components_buffers = world.GetEntityManager().GetComponentsBuffers(component_list, filter);
-        if (components_buffers.empty()) return;
+        const auto version = world.GetEntityManager().NextVersion();
 
-        const auto num_buffers = components_buffers.front().size();
+        const auto components_buffers = world.GetEntityManager().GetComponentsBuffers(component_list, filter);
+        if (components_buffers.empty()) {
+            last_run_version = version;
+            cursor.reset();
+            return;
+        }
 
-        for (std::size_t buffer_index = 0; buffer_index < num_buffers; buffer_index++) {
-            const auto num_entities = components_buffers.front()[buffer_index].num_entities;
-            for (std::size_t entity_index = 0; entity_index < num_entities; entity_index++) {
-                task(detail::Parameter(components_buffers[I][buffer_index][entity_index])...);
+        const auto& entity_buffers = components_buffers.back();
+        const auto  num_buffers    = entity_buffers.size();
+        const auto  start_time     = std::chrono::steady_clock::now();
+
+        std::size_t buffer_index = 0;
+        if (cursor) {
+            // the chunks before the cursor have been visited in this cycle, even if archetypes are created or destroyed since then
+            buffer_index = std::lower_bound(entity_buffers.begin(), entity_buffers.end(), *cursor, [](const auto& data, const ChunkCursor& cursor) {
+                               return ChunkCursor{data.archetype_serial, data.chunk_index} < cursor;
+                           }) -
+                           entity_buffers.begin();
+            // the remaining chunks are gone, so the cycle is finished
+            if (buffer_index == num_buffers) {
+                last_run_version = cycle_version;
+                cursor.reset();
+                buffer_index = 0;
             }
         }
+        if (!cursor) cycle_version = version;
+
+        for (; buffer_index < num_buffers && !OverBudget(start_time); buffer_index++) {
+            if constexpr ((detail::HasChangedTag<typename traits::template arg_t<I>> || ...)) {
+                // the versions are stamped by other tasks writing the chunk concurrently
+                const bool changed = ((detail::HasChangedTag<typename traits::template arg_t<I>> &&
+                                       std::atomic_ref(*components_buffers[I][buffer_index].version).load(std::memory_order_relaxed) > last_run_version) ||
+                                      ...);
+                if (!changed) continue;
+            }
+            // stamp the written components of this chunk
+            ([&] {
+                if constexpr (detail::WriteParameter<typename traits::template arg_t<I>>) {
+                    if (const auto component_version = components_buffers[I][buffer_index].version) {
+                        std::atomic_ref(*component_version).store(version, std::memory_order_relaxed);
+                    }
+                }
+            }(),
+             ...);
+
+            const auto num_entities = entity_buffers[buffer_index].num_entities;
+            stats.num_chunks++;
+            if constexpr ((detail::ChunkParameter<typename traits::template arg_t<I>> && ...)) {
+                stats.num_entities += num_entities;
+                task(typename traits::template arg_t<I>(
+                    reinterpret_cast<typename traits::template arg_t<I>::pointer>(components_buffers[I][buffer_index].data),
+                    detail::get_component_storage<detail::decay_parameter_t<typename traits::template arg_t<I>>>() == ComponentStorage::Entity ? num_entities : 1)...);
+            } else {
+                const auto& entity_data = entity_buffers[buffer_index];
+                if (!entity_data.filter_per_entity && ((components_buffers[I][buffer_index].sparse_set == nullptr) && ...)) {
+                    stats.num_entities += num_entities;
+                    for (std::size_t entity_index = 0; entity_index < num_entities; entity_index++) {
+                        task(detail::Parameter(components_buffers[I][buffer_index][entity_index])...);
+                    }
+                    continue;
+                }
+
+                // look up the sparse components and skip the entities without them
+                for (std::size_t entity_index = 0; entity_index < num_entities; entity_index++) {
+                    const auto entity = reinterpret_cast<const Entity*>(entity_data[entity_index])->GetId();
+                    if (entity_data.filter_per_entity && !world.GetEntityManager().FilterEntity(filter, entity)) continue;
+
+                    const auto data = std::array{
+                        (components_buffers[I][buffer_index].sparse_set
+                             ? components_buffers[I][buffer_index].sparse_set->Get(entity)
+                             : components_buffers[I][buffer_index][entity_index])...};
+                    if (std::find(data.begin(), data.end(), nullptr) != data.end()) continue;
+
+                    stats.num_entities++;
+                    task(detail::Parameter(data[I])...);
+                }
+            }
+        }
+
+        stats.num_deferred_chunks = num_buffers - buffer_index;
+        if (buffer_index == num_buffers) {
+            last_run_version = cycle_version;
+            cursor.reset();
+        } else {
+            cursor = ChunkCursor{entity_buffers[buffer_index].archetype_serial, entity_buffers[buffer_index].chunk_index};
+        }
     }(std::make_index_sequence<traits::args_size>{});
 }
 
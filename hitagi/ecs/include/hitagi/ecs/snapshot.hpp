@@ -0,0 +1,101 @@
+#pragma once
+#include <hitagi/ecs/entity.hpp>
+#include <hitagi/core/buffer.hpp>
+
+#include <cstring>
+#include <span>
+
+namespace hitagi::ecs {
+
+class SnapshotWriter {
+public:
+    SnapshotWriter(std::pmr::vector<std::byte>& data) : m_Data(data) {}
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T> && utils::not_same_as<T, Entity> &&
+                 (!std::is_convertible_v<T, std::span<const std::byte>>) && (!std::is_convertible_v<T, std::string_view>)
+    void Write(const T& value) {
+        Write(std::span{reinterpret_cast<const std::byte*>(&value), sizeof(T)});
+    }
+    void Write(std::span<const std::byte> data);
+    void Write(std::string_view str);
+    // only the id of entity is written
+    void Write(const Entity& entity);
+
+private:
+    std::pmr::vector<std::byte>& m_Data;
+};
+
+class SnapshotReader {
+public:
+    SnapshotReader(std::span<const std::byte> data, EntityManager& entity_manager)
+        : m_Data(data), m_EntityManager(entity_manager) {}
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T> && utils::not_same_as<T, Entity>
+    auto Read() -> T {
+        T value;
+        std::memcpy(&value, Read(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+    auto Read(std::size_t size) -> std::span<const std::byte>;
+    auto ReadString() -> std::pmr::string;
+    // the entity is bound to the entity manager which is restored
+    auto ReadEntity() -> Entity;
+
+    inline bool Empty() const noexcept { return m_Data.empty(); }
+
+private:
+    std::span<const std::byte> m_Data;
+    EntityManager&             m_EntityManager;
+};
+
+// The entities and their components of an entity manager at some moment.
+// Snapshots are only compatible with the same build, since components are identified by `utils::TypeID`.
+class Snapshot {
+public:
+    Snapshot() = default;
+    // load from the data of a persistable snapshot
+    explicit Snapshot(std::span<const std::byte> data);
+    Snapshot(const Snapshot&)            = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+    Snapshot(Snapshot&&) noexcept;
+    Snapshot& operator=(Snapshot&&) noexcept;
+    ~Snapshot();
+
+    inline auto GetData() const noexcept -> std::span<const std::byte> { return m_Data; }
+    inline auto NumEntities() const noexcept { return m_NumEntities; }
+
+    // Components that are neither trivially copyable nor serializable are copied by their copy constructor,
+    // a snapshot contains them can only be restored in current process.
+    inline bool IsPersistable() const noexcept { return m_ComponentCopies.empty(); }
+
+private:
+    friend EntityManager;
+
+    constexpr static std::uint32_t sm_Magic   = 0x504e5348;  // "HSNP"
+    constexpr static std::uint32_t sm_Version = 3;
+
+    enum struct ColumnType : std::uint8_t {
+        Bitwise,
+        Serialized,
+        Copied,
+    };
+
+    struct ComponentCopy {
+        void (*destructor)(std::byte*);
+        std::size_t  size;
+        std::size_t  num_components;
+        core::Buffer data;
+    };
+
+    static auto GetColumnType(const ComponentInfo& component_info) noexcept -> ColumnType;
+
+    void DestroyComponentCopies() noexcept;
+
+    std::pmr::vector<std::byte>     m_Data;
+    std::pmr::vector<ComponentCopy> m_ComponentCopies;
+    std::size_t                     m_NumEntities = 0;
+};
+
+}  // namespace hitagi::ecs
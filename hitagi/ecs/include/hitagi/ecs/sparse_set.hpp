@@ -0,0 +1,64 @@
+#pragma once
+#include <hitagi/ecs/common_types.hpp>
+#include <hitagi/ecs/component.hpp>
+#include <hitagi/ecs/memory_report.hpp>
+#include <hitagi/core/buffer.hpp>
+
+#include <limits>
+#include <span>
+
+namespace hitagi::ecs {
+
+// The components of one type stored outside of archetypes. Entities are mapped to the dense array
+// through paged sparse indices, and the dense array is kept packed by swapping the last component into holes.
+class SparseSet {
+public:
+    SparseSet(ComponentInfo component_info);
+    SparseSet(const SparseSet&)            = delete;
+    SparseSet& operator=(const SparseSet&) = delete;
+    ~SparseSet();
+
+    inline auto& GetComponentInfo() const noexcept { return m_ComponentInfo; }
+    inline auto  NumComponents() const noexcept { return m_Entities.size(); }
+    inline auto  GetEntities() const noexcept -> std::span<const entity_id_t> { return m_Entities; }
+    // the components are packed in the order of `GetEntities`
+    inline auto  GetComponentBuffer() const noexcept -> std::pair<std::byte*, std::size_t> { return {GetData(0), m_Entities.size()}; }
+
+    bool Contains(entity_id_t entity) const noexcept;
+    // return nullptr if the entity does not have the component
+    auto Get(entity_id_t entity) const noexcept -> std::byte*;
+
+    // allocate the component for the entity without any initialization
+    auto Allocate(entity_id_t entity) -> std::byte*;
+    // destruct the component of the entity, nothing happens if the entity does not have it
+    void Remove(entity_id_t entity) noexcept;
+    void Clear() noexcept;
+
+    // the reserved bytes include the sparse pages and the dense entity array
+    auto GetMemoryReport() const noexcept -> ComponentMemoryReport;
+
+private:
+    constexpr static std::size_t   sm_PageSize     = 4096;
+    constexpr static std::size_t   sm_AlignSize    = 64;
+    constexpr static std::uint32_t sm_InvalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+    auto GetIndex(entity_id_t entity) const noexcept -> std::uint32_t;
+    auto GetData(std::size_t index) const noexcept -> std::byte*;
+    void Grow();
+
+    ComponentInfo m_ComponentInfo;
+
+    // entity -> index in dense array, a page is allocated when an entity in it gets the component
+    // and released when the last one loses it
+    struct Page {
+        std::pmr::vector<std::uint32_t> indices;
+        std::size_t                     num_entities = 0;
+    };
+    std::pmr::vector<Page> m_Pages;
+
+    std::pmr::vector<entity_id_t> m_Entities;
+    core::Buffer                  m_Data;
+    std::size_t                   m_Capacity = 0;
+};
+
+}  // namespace hitagi::ecs
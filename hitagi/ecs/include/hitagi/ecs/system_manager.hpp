@@ -1,17 +1,22 @@
 #pragma once
 #include <hitagi/utils/types.hpp>
 
+#include <string_view>
+#include <typeinfo>
 #include <unordered_set>
 
 namespace hitagi::ecs {
 class World;
 class Schedule;
+struct FrameStats;
 
 class SystemManager {
 public:
     SystemManager(World& world) : m_World(world) {}
     ~SystemManager();
 
+    // `OnUpdate` of the enabled systems is called to request their tasks only when the enabled systems change,
+    // then the same tasks are run every update.
     template <typename... Systems>
     void Register();
 
@@ -24,10 +29,16 @@ public:
     template <typename... Systems>
     void Unregister();
 
+    // Run the tasks of the systems once every `num_frames` updates, starting from the next update.
+    // It counts updates instead of time, so the same sequence of updates always runs the same systems.
+    template <typename... Systems>
+    void SetUpdateInterval(std::size_t num_frames);
+
 private:
     friend World;
 
-    void Update(Schedule& schedule);
+    // the skipped systems are recorded in the frame stats
+    void Update(Schedule& schedule, FrameStats& frame_stats);
 
     template <typename System>
     void RegisterOne();
@@ -36,11 +47,23 @@ private:
     void UpdateOne(utils::TypeID id, Schedule& schedule);
     void DisableOne(utils::TypeID id);
     void UnRegisterOne(utils::TypeID id);
+    void SetUpdateIntervalOne(utils::TypeID id, std::size_t num_frames);
 
     World& m_World;
 
+    struct UpdateInterval {
+        std::size_t num_frames;
+        // the system is updated when it counts down to zero
+        std::size_t frames_to_update = 0;
+    };
+
     std::pmr::unordered_set<utils::TypeID> m_EnabledSystems;
     std::pmr::unordered_set<utils::TypeID> m_DisabledSystems;
+    // the enabled systems are changed, so their tasks are requested again
+    bool                                   m_Dirty = false;
+
+    std::pmr::unordered_map<utils::TypeID, std::pmr::string> m_SystemNames;
+    std::pmr::unordered_map<utils::TypeID, UpdateInterval>   m_UpdateIntervals;
 
     std::unordered_map<utils::TypeID, std::function<void(World&)>>    m_OnCreateFns;
     std::unordered_map<utils::TypeID, std::function<void(World&)>>    m_OnEnableFns;
@@ -50,6 +73,23 @@ private:
 };
 
 namespace detail {
+// a system can be given a readable name in frame stats by `static constexpr std::string_view name`
+template <typename System>
+concept HasSystemName = requires {
+    { System::name } -> std::convertible_to<std::string_view>;
+};
+
+auto demangle(const char* name) -> std::pmr::string;
+
+template <typename System>
+auto get_system_name() -> std::pmr::string {
+    if constexpr (HasSystemName<System>) {
+        return std::pmr::string(std::string_view(System::name));
+    } else {
+        return demangle(typeid(System).name());
+    }
+}
+
 template <typename System>
 concept HasOnCreateFn = requires(World& world) {
     { System::OnCreate(world) } -> std::same_as<void>;
@@ -80,6 +120,7 @@ concept HasOnDestroyFn = requires(World& world) {
 template <typename System>
 void SystemManager::RegisterOne() {
     const auto id = utils::TypeID::Create<System>();
+    m_SystemNames.emplace(id, detail::get_system_name<System>());
     if constexpr (detail::HasOnCreateFn<System>) {
         const bool success = m_OnCreateFns.emplace(id, &System::OnCreate).second;
         if (success) m_OnCreateFns.at(id)(m_World);
@@ -105,9 +146,24 @@ void SystemManager::Register() {
     (RegisterOne<Systems>(), ...);
 }
 
+template <typename... Systems>
+void SystemManager::Enable() {
+    (EnableOne(utils::TypeID::Create<Systems>()), ...);
+}
+
+template <typename... Systems>
+void SystemManager::Disable() {
+    (DisableOne(utils::TypeID::Create<Systems>()), ...);
+}
+
 template <typename... Systems>
 void SystemManager::Unregister() {
     (UnRegisterOne(utils::TypeID::Create<Systems>()), ...);
 }
 
+template <typename... Systems>
+void SystemManager::SetUpdateInterval(std::size_t num_frames) {
+    (SetUpdateIntervalOne(utils::TypeID::Create<Systems>(), num_frames), ...);
+}
+
 }  // namespace hitagi::ecs
@@ -2,10 +2,14 @@
 #include <hitagi/ecs/entity_manager.hpp>
 #include <hitagi/ecs/system_manager.hpp>
 #include <hitagi/ecs/entity.hpp>
+#include <hitagi/ecs/command_buffer.hpp>
 
 #include <fmt/format.h>
 #include <taskflow/taskflow.hpp>
 
+#include <chrono>
+#include <thread>
+
 namespace spdlog {
 class logger;
 }
@@ -13,9 +17,49 @@ class logger;
 namespace hitagi::ecs {
 class Schedule;
 
+struct TaskStats {
+    std::pmr::string name;
+    // -1 if the task is run outside of the workers
+    int worker_id = -1;
+    // relative to the start of the task graph
+    std::chrono::nanoseconds start_time{0};
+    std::chrono::nanoseconds duration{0};
+    // the time from all its dependencies finished to the task started, zero if the task is skipped
+    std::chrono::nanoseconds wait_time{0};
+    // chunks skipped by `Changed<T>` are not counted
+    std::size_t num_chunks          = 0;
+    std::size_t num_entities        = 0;
+    // the chunks left to the next frames by the budget of the task
+    std::size_t num_deferred_chunks = 0;
+};
+
+struct FrameStats {
+    std::chrono::nanoseconds update_time{0};
+    std::chrono::nanoseconds schedule_time{0};
+    std::chrono::nanoseconds playback_time{0};
+
+    // in the order of requests
+    std::pmr::vector<TaskStats> tasks;
+
+    // The chain of dependent tasks with the longest total duration, the task graph can not finish earlier than it
+    // no matter how many workers there are. It is given as the indices of `tasks`.
+    std::pmr::vector<std::size_t> critical_path;
+    std::chrono::nanoseconds      critical_path_time{0};
+
+    // whether the task graph was compiled again in this frame
+    bool graph_compiled = false;
+
+    // The systems whose tasks do nothing in this frame because of their update intervals.
+    // They are named by `System::name` if it is given, otherwise by the demangled type name.
+    std::pmr::vector<std::pmr::string> skipped_systems;
+};
+
 class World {
 public:
-    World(std::string_view name);
+    World(std::string_view name, ChunkConfig chunk_config = {}, std::size_t num_workers = std::thread::hardware_concurrency());
+    // the world is updated on the workers of the executor, which can be shared by other worlds
+    World(std::string_view name, tf::Executor& executor, ChunkConfig chunk_config = {});
+    ~World();
 
     void Update();
 
@@ -25,13 +69,62 @@ public:
     inline auto& GetSystemManager() const noexcept { return m_SystemManager; }
     inline auto  GetLogger() noexcept { return m_Logger; }
 
+    // the timings of the tasks in last `Update`, which are also sent to the profiler
+    inline auto& GetLastFrameStats() const noexcept { return m_LastFrameStats; }
+
+    // Get the command buffer of current thread, recorded commands are played back after all tasks finished.
+    // The threads outside the executor share one buffer which is locked when recording.
+    auto GetCommandBuffer() noexcept -> CommandBuffer&;
+
+    // Call `func(index)` for each index in [0, num) on the workers and wait for them,
+    // it can be called in tasks to split their work.
+    template <typename Func>
+        requires std::invocable<Func&, std::size_t>
+    void ParallelFor(std::size_t num, Func&& func);
+
+    inline auto GetName() const noexcept -> std::string_view { return m_Name; }
+
 private:
+    World(std::string_view name, ChunkConfig chunk_config, std::unique_ptr<tf::Executor> owned_executor, tf::Executor* executor);
+
     std::pmr::string                m_Name;
     std::shared_ptr<spdlog::logger> m_Logger;
 
     EntityManager m_EntityManager;
     SystemManager m_SystemManager;
-    tf::Executor  m_Executor;
+
+    // null if the executor is shared
+    std::unique_ptr<tf::Executor> m_OwnedExecutor;
+    tf::Executor*                 m_Executor;
+
+    // one command buffer per worker, and the last one is for the threads outside the executor
+    std::pmr::vector<std::unique_ptr<CommandBuffer>> m_CommandBuffers;
+
+    // kept across frames to reuse the compiled task graph
+    std::unique_ptr<Schedule> m_Schedule;
+
+    FrameStats m_LastFrameStats;
 };
 
+template <typename Func>
+    requires std::invocable<Func&, std::size_t>
+void World::ParallelFor(std::size_t num, Func&& func) {
+    if (num == 0) return;
+    if (num == 1 || m_Executor->num_workers() == 1) {
+        for (std::size_t index = 0; index < num; index++) {
+            func(index);
+        }
+        return;
+    }
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(std::size_t{0}, num, std::size_t{1}, [&](std::size_t index) { func(index); });
+    // a worker can not block on the executor, it must run other tasks while waiting
+    if (m_Executor->this_worker_id() >= 0) {
+        m_Executor->corun(taskflow);
+    } else {
+        m_Executor->run(taskflow).wait();
+    }
+}
+
 }  // namespace hitagi::ecs
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include <hitagi/ecs/world.hpp>
+
+#include <functional>
+#include <optional>
+
+namespace hitagi::ecs {
+
+struct WorldConfig {
+    // worlds with higher priority are started first
+    int priority = 0;
+    // The update time a world may take per frame on average. A world which overruns it is skipped in the next frames
+    // until the overrun is paid back, so that it can not slow down the other worlds. No budget means it is updated every frame.
+    std::optional<std::chrono::nanoseconds> frame_budget = std::nullopt;
+};
+
+struct WorldGroupStats {
+    struct WorldStats {
+        std::pmr::string         name;
+        int                      priority = 0;
+        bool                     updated  = false;
+        std::chrono::nanoseconds update_time{0};
+        // the budget left for the next frame, it is negative when the world overran its budget
+        std::chrono::nanoseconds budget_credit{0};
+    };
+
+    std::chrono::nanoseconds update_time{0};
+    std::chrono::nanoseconds sync_time{0};
+
+    // in the order of priority
+    std::pmr::vector<WorldStats> worlds;
+};
+
+// Worlds updated concurrently on one executor, so that several worlds (editor preview, game, server simulation)
+// share the workers instead of each owning its own executor.
+class WorldGroup {
+public:
+    WorldGroup(std::size_t num_workers = std::thread::hardware_concurrency());
+    ~WorldGroup();
+
+    auto CreateWorld(std::string_view name, WorldConfig config = {}, ChunkConfig chunk_config = {}) -> World&;
+    void DestroyWorld(std::string_view name);
+
+    auto GetWorld(std::string_view name) -> World&;
+    auto GetWorld(std::string_view name) const -> const World&;
+    inline auto NumWorlds() const noexcept { return m_Worlds.size(); }
+
+    // the world is reordered by the new priority and its budget credit is reset
+    void SetWorldConfig(std::string_view name, WorldConfig config);
+
+    // Update all worlds which are in budget concurrently and wait for them, then run the sync callbacks.
+    void Update();
+
+    // Called in the order of adding at the sync point of each `Update`, no world is being updated then,
+    // so the callback can read any world.
+    void AddSyncCallback(std::function<void(const WorldGroup&)> callback);
+
+    inline auto& GetLastFrameStats() const noexcept { return m_LastFrameStats; }
+
+private:
+    struct Member {
+        std::unique_ptr<World>   world;
+        WorldConfig              config;
+        std::chrono::nanoseconds budget_credit{0};
+    };
+
+    void Insert(std::unique_ptr<Member> member);
+    auto GetMember(std::string_view name) const -> Member&;
+
+    // destroyed after the worlds
+    tf::Executor m_Executor;
+
+    // sorted by priority
+    std::pmr::vector<std::unique_ptr<Member>> m_Worlds;
+
+    std::pmr::vector<std::function<void(const WorldGroup&)>> m_SyncCallbacks;
+
+    WorldGroupStats m_LastFrameStats;
+};
+
+}  // namespace hitagi::ecs
@@ -7,60 +7,166 @@
 #include <range/v3/view/map.hpp>
 
 #include <algorithm>
+#include <cstring>
 
 namespace hitagi::ecs {
 
-Archetype::Archetype(detail::ComponentInfoSet component_infos)
-    : m_ComponentInfoSet(std::move(component_infos)) {
+Archetype::Archetype(std::uint64_t serial, detail::ComponentInfoSet component_infos, const ChunkConfig& config, const std::atomic<std::uint64_t>& version,
+                     ChunkPool& chunk_pool, const detail::SharedComponentValues& shared_values)
+    : m_Serial(serial),
+      m_Version(version),
+      m_ChunkPool(chunk_pool),
+      m_ComponentInfoSet(std::move(component_infos)),
+      m_Signature(detail::get_component_signature(m_ComponentInfoSet)) {
     // calculate chunk info
     {
-        // a `sm_chunk_size` bytes buffer contain
+        // a `chunk_size` bytes buffer contain
         // header(sm_align_size),
         // c_1_1, c_1_2, ..., c_1_n, padding_1,
         // c_2_1, c_2_2, ..., c_2_n, padding_2,
         // ...
         // c_m_1, c_m_2, ..., c_m_n, padding_m,
-        // where c_i_j is the i-th component of j-th entity, and all element are contiguous, also each line align to `sm_align_size`
+        // where c_i_j is the i-th component of j-th entity, and all element are contiguous, also each line align to `sm_align_size`.
+        // A chunk component has only one element in its line, and shared components are not stored in chunks.
 
-        // calculate num_entities without alignment
-        std::size_t num_entities = sm_chunk_size /
-                                   ranges::accumulate(m_ComponentInfoSet, std::size_t{0}, [](std::size_t acc, const auto& info) { return acc + info.size; });
+        const std::size_t entity_size = ranges::accumulate(m_ComponentInfoSet, std::size_t{0}, [](std::size_t acc, const auto& info) {
+            return acc + (info.storage == ComponentStorage::Entity ? info.size : 0);
+        });
 
         const auto calculate_offset = [this](std::size_t num_entities) {
             std::size_t current_offset = 0;
+            m_ChunkInfo.column_offsets.clear();
             for (const auto& component_info : m_ComponentInfoSet) {
                 m_ChunkInfo.component_offsets[component_info.type_id] = current_offset;
-                current_offset += utils::align(num_entities * component_info.size, sm_align_size);
+                m_ChunkInfo.column_offsets.emplace_back(current_offset);
+                switch (component_info.storage) {
+                    case ComponentStorage::Entity:
+                        current_offset += utils::align(num_entities * component_info.size, sm_align_size);
+                        break;
+                    case ComponentStorage::Chunk:
+                        current_offset += utils::align(component_info.size, sm_align_size);
+                        break;
+                    case ComponentStorage::Shared:
+                    case ComponentStorage::Sparse:
+                        break;
+                }
             }
             return current_offset;
         };
 
-        while (calculate_offset(num_entities) > sm_chunk_size) {
-            num_entities--;
+        const auto calculate_num_entities = [&](std::size_t chunk_size) {
+            // calculate num_entities without alignment
+            std::size_t num_entities = chunk_size / entity_size;
+            while (num_entities > 0 && calculate_offset(num_entities) > chunk_size) {
+                num_entities--;
+            }
+            return num_entities;
+        };
+
+        // a chunk must hold one entity at least
+        const std::size_t min_entities = std::max<std::size_t>(config.min_entities_per_chunk, 1);
+
+        std::size_t chunk_size   = config.chunk_size;
+        std::size_t num_entities = calculate_num_entities(chunk_size);
+        while (num_entities == 0 || (num_entities < min_entities && chunk_size < config.max_chunk_size)) {
+            chunk_size *= 2;
+            num_entities = calculate_num_entities(chunk_size);
         }
+        calculate_offset(num_entities);
+
+        m_ChunkInfo.chunk_size             = chunk_size;
         m_ChunkInfo.num_entities_per_chunk = num_entities;
+
+        for (std::size_t index = 0; const auto& component_info : m_ComponentInfoSet) {
+            m_ChunkInfo.component_indices[component_info.type_id] = index++;
+        }
+    }
+
+    for (const auto& component_info : m_ComponentInfoSet) {
+        if (component_info.storage != ComponentStorage::Shared) continue;
+
+        auto& value = m_SharedComponents.emplace(component_info.type_id, core::Buffer(component_info.size, nullptr, sm_align_size)).first->second;
+        component_info.copy_constructor(value.GetData(), shared_values.at(component_info.type_id));
+        m_SharedComponentValues.emplace(component_info.type_id, value.GetData());
     }
 }
 
 Archetype::~Archetype() {
-    for (const auto entity : m_EntityMap | ranges::views::keys) {
-        DestructAllComponents(entity);
+    // destruct the components column by column, instead of looking up each entity
+    for (auto& chunk : m_Chunks) {
+        for (std::size_t column = 0; const auto& component_info : m_ComponentInfoSet) {
+            if (component_info.storage == ComponentStorage::Entity && component_info.destructor) {
+                const auto data = chunk.data.GetData() + m_ChunkInfo.column_offsets[column];
+                for (std::size_t index = 0; index < chunk.num_entity_in_chunk; index++) {
+                    component_info.destructor(data + index * component_info.size);
+                }
+            }
+            column++;
+        }
+        DestructChunkComponents(chunk);
+        m_ChunkPool.Release(std::move(chunk.data));
+    }
+    for (auto& [component_id, value] : m_SharedComponents) {
+        if (const auto& component_info = GetComponentInfo(component_id);
+            component_info.destructor) {
+            component_info.destructor(value.GetData());
+        }
     }
 }
 
+bool Archetype::MatchSharedComponentValues(const detail::SharedComponentValues& shared_values) const noexcept {
+    for (const auto& [component_id, value] : m_SharedComponents) {
+        const auto iter = shared_values.find(component_id);
+        if (iter == shared_values.end() || !GetComponentInfo(component_id).equal(value.GetData(), iter->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void Archetype::AllocateFor(entity_id_t entity) noexcept {
     auto& chunk = GetOrCreateChunk();
-    m_EntityMap.emplace(entity, std::pair{m_Chunks.size() - 1, chunk.num_entity_in_chunk++});
+    m_EntityMap.emplace(entity, EntityLocation(m_Chunks.size() - 1, chunk.num_entity_in_chunk++));
+
+    // a new entity in chunk is regarded as a change of all its components
+    std::fill(chunk.versions.begin(), chunk.versions.end(), GetChangeVersion());
+}
+
+void Archetype::AllocateFor(std::span<const entity_id_t> entities) noexcept {
+    const auto num_free_entities = m_Chunks.empty() ? 0 : m_ChunkInfo.num_entities_per_chunk - m_Chunks.back().num_entity_in_chunk;
+    if (entities.size() > num_free_entities) {
+        const auto num_new_chunks = (entities.size() - num_free_entities + m_ChunkInfo.num_entities_per_chunk - 1) / m_ChunkInfo.num_entities_per_chunk;
+        m_Chunks.reserve(m_Chunks.size() + num_new_chunks);
+    }
+    for (const auto entity : entities) {
+        AllocateFor(entity);
+    }
 }
 
 void Archetype::DeallocateFor(entity_id_t entity) noexcept {
     const auto last_entity = GetLastEntity();
 
     if (last_entity != entity) {
-        const auto last_entity_components = GetAllComponentData(last_entity);
-        for (const auto& [component_id, data] : last_entity_components) {
-            MoveConstructComponent(component_id, entity, data);
-            DestructComponent(component_id, last_entity);
+        const auto [chunk_index, index_in_chunk] = m_EntityMap.at(entity);
+
+        auto&      chunk      = m_Chunks[chunk_index];
+        auto&      last_chunk = m_Chunks.back();
+        const auto last_index = last_chunk.num_entity_in_chunk - 1;
+
+        // move the last entity to the hole
+        for (std::size_t column = 0; const auto& component_info : m_ComponentInfoSet) {
+            const auto offset = m_ChunkInfo.column_offsets[column];
+            if (component_info.storage == ComponentStorage::Entity) {
+                Relocate(component_info,
+                         chunk.data.GetData() + offset + index_in_chunk * component_info.size,
+                         last_chunk.data.GetData() + offset + last_index * component_info.size);
+            }
+
+            // keep the changes of the moved entity visible, a mirror of the column sees the moved entity as a new value in the hole
+            chunk.versions[column] = component_info.gpu_mirrored
+                                         ? GetChangeVersion()
+                                         : std::max(chunk.versions[column], last_chunk.versions[column]);
+            column++;
         }
 
         std::swap(m_EntityMap.at(entity), m_EntityMap.at(last_entity));
@@ -70,38 +176,47 @@ void Archetype::DeallocateFor(entity_id_t entity) noexcept {
     m_Chunks.back().num_entity_in_chunk--;
 
     if (m_Chunks.back().num_entity_in_chunk == 0) {
+        DestructChunkComponents(m_Chunks.back());
+        m_ChunkPool.Release(std::move(m_Chunks.back().data));
         m_Chunks.pop_back();
     }
 }
 
 bool Archetype::HasComponent(utils::TypeID component) const noexcept {
-    return ranges::find_if(m_ComponentInfoSet, [component](const auto& info) { return info.type_id == component; }) != m_ComponentInfoSet.end();
+    return m_ChunkInfo.component_indices.contains(component);
 }
 
 void Archetype::DefaultConstructComponent(utils::TypeID component_id, entity_id_t entity) {
     if (const auto& component_info = GetComponentInfo(component_id);
-        component_info.default_constructor) {
+        component_info.storage == ComponentStorage::Entity && component_info.default_constructor) {
         component_info.default_constructor(GetComponentData(component_id, entity));
     }
 }
 
 void Archetype::CopyConstructComponent(utils::TypeID component_id, entity_id_t entity, const std::byte* src) {
     if (const auto& component_info = GetComponentInfo(component_id);
-        component_info.copy_constructor) {
+        component_info.storage == ComponentStorage::Entity && component_info.copy_constructor) {
         component_info.copy_constructor(GetComponentData(component_id, entity), src);
     }
 }
 
 void Archetype::MoveConstructComponent(utils::TypeID component_id, entity_id_t entity, std::byte* src) {
     if (const auto& component_info = GetComponentInfo(component_id);
-        component_info.move_constructor) {
+        component_info.storage == ComponentStorage::Entity && component_info.move_constructor) {
         component_info.move_constructor(GetComponentData(component_id, entity), src);
     }
 }
 
+void Archetype::RelocateComponent(utils::TypeID component_id, entity_id_t entity, std::byte* src) {
+    if (const auto& component_info = GetComponentInfo(component_id);
+        component_info.storage == ComponentStorage::Entity) {
+        Relocate(component_info, GetComponentData(component_id, entity), src);
+    }
+}
+
 void Archetype::DestructComponent(utils::TypeID component_id, entity_id_t entity) noexcept {
     if (const auto& component_info = GetComponentInfo(component_id);
-        component_info.destructor) {
+        component_info.storage == ComponentStorage::Entity && component_info.destructor) {
         component_info.destructor(GetComponentData(component_id, entity));
     }
 }
@@ -116,29 +231,52 @@ auto Archetype::GetComponentData(utils::TypeID component_id, entity_id_t entity)
     if (!m_EntityMap.contains(entity))
         return nullptr;
 
-    const auto component_info   = GetComponentInfo(component_id);
+    const auto& component_info = GetComponentInfo(component_id);
+    if (component_info.storage == ComponentStorage::Shared) {
+        return const_cast<std::byte*>(m_SharedComponents.at(component_id).GetData());
+    }
+
     const auto component_offset = GetComponentOffset(component_id);
+    const auto stride           = component_info.storage == ComponentStorage::Entity ? component_info.size : 0;
 
     const auto [chunk_index, index_in_chunk] = m_EntityMap.at(entity);
-    return const_cast<std::byte*>(m_Chunks[chunk_index].data.GetData()) + component_offset + index_in_chunk * component_info.size;
+    return const_cast<std::byte*>(m_Chunks[chunk_index].data.GetData()) + component_offset + index_in_chunk * stride;
 }
 
-auto Archetype::GetAllComponentData(entity_id_t entity) noexcept -> std::unordered_map<utils::TypeID, std::byte*> {
-    std::unordered_map<utils::TypeID, std::byte*> result;
-    result.reserve(m_ComponentInfoSet.size());
-    for (const auto& component_info : m_ComponentInfoSet) {
-        result.emplace(component_info.type_id, GetComponentData(component_info.type_id, entity));
+auto Archetype::GetComponentBuffers(utils::TypeID component_id) const noexcept -> std::pmr::vector<std::pair<std::byte*, std::size_t>> {
+    std::pmr::vector<std::pair<std::byte*, std::size_t>> result;
+    result.reserve(m_Chunks.size());
+
+    if (const auto iter = m_SharedComponents.find(component_id); iter != m_SharedComponents.end()) {
+        for (auto& chunk : m_Chunks) {
+            result.emplace_back(const_cast<std::byte*>(iter->second.GetData()), chunk.num_entity_in_chunk);
+        }
+        return result;
+    }
+
+    const auto component_offset = GetComponentOffset(component_id);
+    for (auto& chunk : m_Chunks) {
+        result.emplace_back(const_cast<std::byte*>(chunk.data.GetData()) + component_offset, chunk.num_entity_in_chunk);
     }
     return result;
 }
 
-auto Archetype::GetComponentBuffers(utils::TypeID component_id) const noexcept -> std::pmr::vector<std::pair<std::byte*, std::size_t>> {
-    const auto component_offset = GetComponentOffset(component_id);
+void Archetype::MarkChanged(utils::TypeID component_id, entity_id_t entity) noexcept {
+    if (!m_EntityMap.contains(entity)) return;
 
-    std::pmr::vector<std::pair<std::byte*, std::size_t>> result;
+    const auto chunk_index     = m_EntityMap.at(entity).first;
+    const auto component_index = m_ChunkInfo.component_indices.at(component_id);
+    // tasks may mark the chunk concurrently
+    std::atomic_ref(m_Chunks[chunk_index].versions[component_index]).store(GetChangeVersion(), std::memory_order_relaxed);
+}
+
+auto Archetype::GetComponentVersions(utils::TypeID component_id) const noexcept -> std::pmr::vector<std::uint64_t*> {
+    const auto component_index = m_ChunkInfo.component_indices.at(component_id);
+
+    std::pmr::vector<std::uint64_t*> result;
     result.reserve(m_Chunks.size());
     for (auto& chunk : m_Chunks) {
-        result.emplace_back(const_cast<std::byte*>(chunk.data.GetData()) + component_offset, chunk.num_entity_in_chunk);
+        result.emplace_back(const_cast<std::uint64_t*>(&chunk.versions[component_index]));
     }
     return result;
 }
@@ -151,26 +289,101 @@ auto Archetype::GetComponentOffset(utils::TypeID component_id) const noexcept ->
     return m_ChunkInfo.component_offsets.at(component_id);
 }
 
+auto Archetype::GetMemoryReport() const -> ArchetypeMemoryReport {
+    ArchetypeMemoryReport report{
+        .num_chunks             = m_Chunks.size(),
+        .num_entities           = NumEntities(),
+        .num_entities_per_chunk = m_ChunkInfo.num_entities_per_chunk,
+        .chunk_size             = m_ChunkInfo.chunk_size,
+        .utilization            = m_Chunks.empty() ? 0.0 : static_cast<double>(NumEntities()) / static_cast<double>(m_Chunks.size() * m_ChunkInfo.num_entities_per_chunk),
+        .components             = {},
+    };
+
+    std::size_t used_bytes_per_chunk = 0;
+    for (const auto& component_info : m_ComponentInfoSet) {
+        auto& component_report = report.components.emplace_back(ComponentMemoryReport{
+            .name           = component_info.name,
+            .storage        = component_info.storage,
+            .component_size = component_info.size,
+        });
+        switch (component_info.storage) {
+            case ComponentStorage::Entity:
+                component_report.reserved_bytes = utils::align(m_ChunkInfo.num_entities_per_chunk * component_info.size, sm_align_size) * m_Chunks.size();
+                component_report.used_bytes     = component_info.size * NumEntities();
+                used_bytes_per_chunk += m_ChunkInfo.num_entities_per_chunk * component_info.size;
+                break;
+            case ComponentStorage::Chunk:
+                component_report.reserved_bytes = utils::align(component_info.size, sm_align_size) * m_Chunks.size();
+                component_report.used_bytes     = component_info.size * m_Chunks.size();
+                used_bytes_per_chunk += component_info.size;
+                break;
+            case ComponentStorage::Shared:
+                // one value for the whole archetype
+                component_report.reserved_bytes = m_SharedComponents.at(component_info.type_id).GetDataSize();
+                component_report.used_bytes     = component_info.size;
+                break;
+            case ComponentStorage::Sparse:
+                break;
+        }
+    }
+    report.padding_bytes = (m_ChunkInfo.chunk_size - used_bytes_per_chunk) * m_Chunks.size();
+
+    return report;
+}
+
 auto Archetype::GetOrCreateChunk() noexcept -> Chunk& {
     if (m_Chunks.empty() || m_ChunkInfo.num_entities_per_chunk == m_Chunks.back().num_entity_in_chunk) {
-        m_Chunks.emplace_back();
+        ConstructChunkComponents(m_Chunks.emplace_back(m_ChunkPool.Acquire(m_ChunkInfo.chunk_size), m_ComponentInfoSet.size()));
     }
     return m_Chunks.back();
 }
 
+void Archetype::ConstructChunkComponents(Chunk& chunk) noexcept {
+    for (std::size_t column = 0; const auto& component_info : m_ComponentInfoSet) {
+        if (component_info.storage == ComponentStorage::Chunk && component_info.default_constructor) {
+            component_info.default_constructor(chunk.data.GetData() + m_ChunkInfo.column_offsets[column]);
+        }
+        column++;
+    }
+}
+
+void Archetype::DestructChunkComponents(Chunk& chunk) noexcept {
+    for (std::size_t column = 0; const auto& component_info : m_ComponentInfoSet) {
+        if (component_info.storage == ComponentStorage::Chunk && component_info.destructor) {
+            component_info.destructor(chunk.data.GetData() + m_ChunkInfo.column_offsets[column]);
+        }
+        column++;
+    }
+}
+
 auto Archetype::GetLastEntity() const -> entity_id_t {
     if (m_Chunks.empty()) {
         throw std::out_of_range("No entity in this archetype");
     }
 
-    const auto  entity_component_info = detail::create_static_component_info<Entity>();
-    const auto& chunk                 = m_Chunks.back();
+    const auto& chunk = m_Chunks.back();
 
-    auto entity_ptr = chunk.data.GetData() + m_ChunkInfo.component_offsets.at(entity_component_info.type_id) + (chunk.num_entity_in_chunk - 1) * entity_component_info.size;
+    auto entity_ptr = chunk.data.GetData() + m_ChunkInfo.component_offsets.at(utils::TypeID::Create<Entity>()) + (chunk.num_entity_in_chunk - 1) * sizeof(Entity);
 
     return reinterpret_cast<const Entity*>(entity_ptr)->GetId();
 }
 
-Archetype::Chunk::Chunk() : data(sm_chunk_size, nullptr, sm_align_size) {}
+auto Archetype::GetChangeVersion() const noexcept -> std::uint64_t {
+    // the changes made outside of tasks must be visible to all tasks that have run
+    return m_Version.load(std::memory_order_relaxed) + 1;
+}
+
+void Archetype::Relocate(const ComponentInfo& component_info, std::byte* dest, std::byte* src) noexcept {
+    if (component_info.trivially_relocatable || !component_info.move_constructor) {
+        std::memcpy(dest, src, component_info.size);
+    } else {
+        component_info.move_constructor(dest, src);
+        if (component_info.destructor) component_info.destructor(src);
+    }
+}
+
+Archetype::Chunk::Chunk(core::Buffer data, std::size_t num_components)
+    : data(std::move(data)),
+      versions(num_components, 0) {}
 
 }  // namespace hitagi::ecs
\ No newline at end of file
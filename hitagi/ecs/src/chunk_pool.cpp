@@ -0,0 +1,36 @@
+#include <hitagi/ecs/chunk_pool.hpp>
+
+namespace hitagi::ecs {
+
+auto ChunkPool::Acquire(std::size_t chunk_size) -> core::Buffer {
+    m_Stats.num_used_chunks++;
+    m_Stats.used_memory += chunk_size;
+
+    if (auto iter = m_FreeChunks.find(chunk_size); iter != m_FreeChunks.end() && !iter->second.empty()) {
+        auto chunk = std::move(iter->second.back());
+        iter->second.pop_back();
+        m_Stats.num_free_chunks--;
+        m_Stats.free_memory -= chunk_size;
+        return chunk;
+    }
+
+    m_Stats.num_allocations++;
+    return core::Buffer(chunk_size, nullptr, sm_AlignSize);
+}
+
+void ChunkPool::Release(core::Buffer chunk) {
+    const auto chunk_size = chunk.GetDataSize();
+    m_Stats.num_used_chunks--;
+    m_Stats.used_memory -= chunk_size;
+
+    if (m_Stats.free_memory + chunk_size > m_Budget) {
+        m_Stats.num_deallocations++;
+        return;
+    }
+
+    m_FreeChunks[chunk_size].emplace_back(std::move(chunk));
+    m_Stats.num_free_chunks++;
+    m_Stats.free_memory += chunk_size;
+}
+
+}  // namespace hitagi::ecs
@@ -0,0 +1,74 @@
+#include <hitagi/ecs/command_buffer.hpp>
+#include <hitagi/ecs/entity_manager.hpp>
+
+namespace hitagi::ecs {
+
+CommandBuffer::CommandBuffer(EntityManager& entity_manager, bool thread_safe)
+    : m_EntityManager(entity_manager),
+      m_Mutex(thread_safe ? std::make_unique<std::mutex>() : nullptr),
+      m_Arena(std::make_unique<std::pmr::monotonic_buffer_resource>()) {}
+
+CommandBuffer::~CommandBuffer() {
+    Clear();
+}
+
+auto CommandBuffer::Create() -> Entity {
+    auto entity = m_EntityManager.ReserveEntity();
+    Record({
+        .type   = CommandType::Create,
+        .entity = entity.GetId(),
+    });
+    return entity;
+}
+
+void CommandBuffer::Destroy(Entity entity) {
+    Record({
+        .type   = CommandType::Destroy,
+        .entity = entity.GetId(),
+    });
+}
+
+void CommandBuffer::Add(Entity entity, std::string_view dynamic_component) {
+    Record({
+        .type         = CommandType::Emplace,
+        .entity       = entity.GetId(),
+        .component_id = m_EntityManager.GetDynamicComponentInfo(dynamic_component).type_id,
+    });
+}
+
+void CommandBuffer::Remove(Entity entity, std::string_view dynamic_component) {
+    Record({
+        .type         = CommandType::Remove,
+        .entity       = entity.GetId(),
+        .component_id = m_EntityManager.GetDynamicComponentInfo(dynamic_component).type_id,
+    });
+}
+
+auto CommandBuffer::Allocate(std::size_t size, std::size_t alignment) -> std::byte* {
+    const auto lock = Lock();
+    return static_cast<std::byte*>(m_Arena->allocate(size, alignment));
+}
+
+void CommandBuffer::Record(Command command) {
+    const auto lock = Lock();
+    // the sequence is taken in the lock, so the commands of a buffer are always in order
+    command.sequence = m_EntityManager.NextCommandSequence();
+    m_Commands.emplace_back(command);
+}
+
+auto CommandBuffer::Lock() -> std::unique_lock<std::mutex> {
+    return m_Mutex ? std::unique_lock(*m_Mutex) : std::unique_lock<std::mutex>();
+}
+
+void CommandBuffer::Clear() noexcept {
+    // the component values have been moved to archetypes or discarded, destroy the left objects
+    for (const auto& command : m_Commands) {
+        if (command.data && command.component_info && command.component_info->destructor) {
+            command.component_info->destructor(command.data);
+        }
+    }
+    m_Commands.clear();
+    m_Arena->release();
+}
+
+}  // namespace hitagi::ecs
@@ -0,0 +1,38 @@
+#include <hitagi/ecs/component.hpp>
+
+#include <fmt/format.h>
+
+#include <mutex>
+#include <stdexcept>
+
+namespace hitagi::ecs::detail {
+
+auto register_component_index(utils::TypeID component_id) -> std::uint32_t {
+    // shared by all worlds in the process, so it does not allocate from the default memory resource which may be replaced
+    static std::mutex                                       mutex;
+    static std::unordered_map<utils::TypeID, std::uint32_t> indices;
+
+    std::lock_guard lock{mutex};
+    if (const auto iter = indices.find(component_id); iter != indices.end()) {
+        return iter->second;
+    }
+    if (indices.size() == max_num_component_types) {
+        throw std::length_error(fmt::format("The number of component types exceeds {}", max_num_component_types));
+    }
+    return indices.emplace(component_id, static_cast<std::uint32_t>(indices.size())).first->second;
+}
+
+auto create_last_frame_component_info(const ComponentInfo& component_info) -> ComponentInfo {
+    // the copy is made by memcpy, so it needs none of the hooks except relocation
+    auto last_frame_info = ComponentInfo{
+        .name                  = std::pmr::string{fmt::format("LastFrame<{}>", component_info.name)},
+        .size                  = component_info.size,
+        .storage               = ComponentStorage::Entity,
+        .trivially_relocatable = true,
+    };
+    last_frame_info.type_id = utils::TypeID(last_frame_info.name);
+    last_frame_info.index   = register_component_index(last_frame_info.type_id);
+    return last_frame_info;
+}
+
+}  // namespace hitagi::ecs::detail
@@ -26,6 +26,11 @@ auto Entity::Add(std::string_view dynamic_component) -> std::byte* {
     return m_EntityManager->AddDynamicComponent(m_Id, dynamic_component);
 }
 
+void Entity::MarkChanged(std::string_view dynamic_component) {
+    CheckValidation();
+    m_EntityManager->MarkComponentChanged(m_Id, m_EntityManager->GetDynamicComponentInfo(dynamic_component).type_id);
+}
+
 void Entity::Remove(std::string_view dynamic_component) {
     CheckValidation();
     m_EntityManager->RemoveDynamicComponent(m_Id, dynamic_component);
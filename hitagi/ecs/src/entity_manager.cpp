@@ -1,4 +1,5 @@
 #include <hitagi/ecs/entity_manager.hpp>
+#include <hitagi/ecs/command_buffer.hpp>
 #include <hitagi/ecs/entity.hpp>
 #include <hitagi/ecs/component.hpp>
 #include <hitagi/ecs/world.hpp>
@@ -16,31 +17,50 @@
 #include <range/v3/view/iota.hpp>
 #include <range/v3/view/map.hpp>
 #include <range/v3/view/transform.hpp>
+#include <range/v3/view/zip.hpp>
 #include <spdlog/logger.h>
 
-namespace hitagi::ecs {
-
-inline auto calculate_archetype_id(const detail::ComponentIdSet& component_ids) noexcept -> archetype_id_t {
-    auto type_ids = component_ids                                                                       //
-                    | ranges::views::transform([](const auto& type_id) { return type_id.GetValue(); })  //
-                    | ranges::to<std::pmr::vector<std::size_t>>();
-    std::sort(type_ids.begin(), type_ids.end());
-    return utils::combine_hash(type_ids);
-}
+#include <cstring>
+#include <map>
+#include <set>
 
-inline auto get_component_ids(const detail::ComponentInfoSet& component_infos) noexcept -> detail::ComponentIdSet {
-    return component_infos                                                                                //
-           | ranges::views::transform([](const auto& component_info) { return component_info.type_id; })  //
-           | ranges::to<detail::ComponentIdSet>();
-}
+namespace hitagi::ecs {
 
-EntityManager::EntityManager(World& world) : m_World(world) {
+EntityManager::EntityManager(World& world, ChunkConfig chunk_config)
+    : m_World(world),
+      m_ChunkConfig(chunk_config),
+      m_ChunkPool(chunk_config.max_pooled_memory) {
+    // archetypes double the chunk size until it holds an entity, which never ends with zero
+    if (m_ChunkConfig.chunk_size == 0 || m_ChunkConfig.max_chunk_size < m_ChunkConfig.chunk_size) {
+        const auto error_message = fmt::format("Invalid chunk config of world {}: chunk_size({}) must be positive and not greater than max_chunk_size({})",
+                                               world.GetName(), m_ChunkConfig.chunk_size, m_ChunkConfig.max_chunk_size);
+        world.GetLogger()->error(error_message);
+        throw std::invalid_argument(error_message);
+    }
     UpdateComponentInfo<Entity>();
 }
 EntityManager::~EntityManager() = default;  // forward declaration of unique_ptr<Archetype>
 
 void EntityManager::RegisterDynamicComponent(ComponentInfo component) {
+    // the value of shared component is given when the entity is spawned, which is impossible for dynamic components
+    if (component.storage == ComponentStorage::Shared) {
+        const auto error_message = fmt::format("Dynamic component {} can not be shared", component.name);
+        m_World.GetLogger()->error(error_message);
+        throw std::invalid_argument(error_message);
+    }
+    // tasks find the last frame column of static components by type
+    if (component.double_buffered) {
+        const auto error_message = fmt::format("Dynamic component {} can not be double-buffered", component.name);
+        m_World.GetLogger()->error(error_message);
+        throw std::invalid_argument(error_message);
+    }
+    if (component.gpu_mirrored && component.storage != ComponentStorage::Entity) {
+        const auto error_message = fmt::format("Dynamic component {} must be stored in archetypes to be GPU mirrored", component.name);
+        m_World.GetLogger()->error(error_message);
+        throw std::invalid_argument(error_message);
+    }
     component.type_id = utils::TypeID(component.name);
+    component.index   = detail::register_component_index(component.type_id);
     m_ComponentMap.emplace(component.type_id, std::move(component));
 }
 
@@ -67,26 +87,36 @@ auto EntityManager::CreateMany(std::size_t num, const detail::ComponentInfoSet&
     std::pmr::vector<Entity> entities;
     entities.reserve(num);
 
-    auto& archetype = GetOrCreateArchetype(component_infos);
-    for (entity_id_t entity = m_Counter; entity < m_Counter + num; entity++) {
+    const entity_id_t first_entity = m_Counter.fetch_add(num);
+    const entity_id_t last_entity  = first_entity + num;
+
+    auto archetype_component_infos = component_infos;
+    std::erase_if(archetype_component_infos, [](const auto& info) { return info.storage == ComponentStorage::Sparse; });
+
+    auto& archetype = GetOrCreateArchetype(archetype_component_infos);
+    for (entity_id_t entity = first_entity; entity < last_entity; entity++) {
         archetype.AllocateFor(entity);
         m_EntityMaps.emplace(entity, &archetype);
     }
 
     for (const auto& component_info : component_infos) {
-        if (component_info.type_id == utils::TypeID::Create<Entity>()) {
-            for (entity_id_t entity = m_Counter; entity < m_Counter + num; entity++) {
+        if (component_info.storage == ComponentStorage::Sparse) {
+            auto& sparse_set = GetOrCreateSparseSet(component_info);
+            for (entity_id_t entity = first_entity; entity < last_entity; entity++) {
+                auto data = sparse_set.Allocate(entity);
+                if (component_info.default_constructor) component_info.default_constructor(data);
+            }
+        } else if (component_info.type_id == utils::TypeID::Create<Entity>()) {
+            for (entity_id_t entity = first_entity; entity < last_entity; entity++) {
                 entities.emplace_back(archetype.ConstructComponent<Entity>(entity, Entity(this, entity)));
             }
         } else {
-            for (entity_id_t entity = m_Counter; entity < m_Counter + num; entity++) {
+            for (entity_id_t entity = first_entity; entity < last_entity; entity++) {
                 archetype.DefaultConstructComponent(component_info.type_id, entity);
             }
         }
     }
 
-    m_Counter += num;
-
     return entities;
 }
 
@@ -95,11 +125,19 @@ void EntityManager::Destroy(Entity& entity) {
     archetype.DestructAllComponents(entity.GetId());
     archetype.DeallocateFor(entity.GetId());
     m_EntityMaps.erase(entity.GetId());
+    for (auto& sparse_set : m_SparseSets | ranges::views::values) {
+        sparse_set->Remove(entity.GetId());
+    }
     entity = {};
 }
 
 bool EntityManager::HasDynamicComponent(entity_id_t entity, std::string_view dynamic_component) const {
-    return m_EntityMaps.at(entity)->HasComponent(GetDynamicComponentInfo(dynamic_component).type_id);
+    const auto& dynamic_component_info = GetDynamicComponentInfo(dynamic_component);
+    if (dynamic_component_info.storage == ComponentStorage::Sparse) {
+        const auto sparse_set = GetSparseSet(dynamic_component_info.type_id);
+        return sparse_set && sparse_set->Contains(entity);
+    }
+    return m_EntityMaps.at(entity)->HasComponent(dynamic_component_info.type_id);
 }
 
 auto EntityManager::AddDynamicComponent(entity_id_t entity, std::string_view dynamic_component) -> std::byte* {
@@ -108,25 +146,20 @@ auto EntityManager::AddDynamicComponent(entity_id_t entity, std::string_view dyn
     }
 
     const auto& dynamic_component_info = GetDynamicComponentInfo(dynamic_component);
+    if (dynamic_component_info.storage == ComponentStorage::Sparse) {
+        auto data = GetOrCreateSparseSet(dynamic_component_info).Allocate(entity);
+        if (dynamic_component_info.default_constructor) dynamic_component_info.default_constructor(data);
+        return data;
+    }
 
     auto& old_archetype   = *m_EntityMaps.at(entity);
     auto  component_infos = old_archetype.GetComponentInfoSet();
 
     component_infos.emplace(dynamic_component_info);
-    Archetype& new_archetype = GetOrCreateArchetype(component_infos);
-
-    new_archetype.AllocateFor(entity);
-    for (const auto& component_info : component_infos) {
-        const auto component_id = component_info.type_id;
-        if (component_id == dynamic_component_info.type_id) {
-            new_archetype.DefaultConstructComponent(component_id, entity);
-        } else {
-            new_archetype.MoveConstructComponent(component_id, entity, old_archetype.GetComponentData(component_id, entity));
-            old_archetype.DestructComponent(component_id, entity);
-        }
-    }
+    Archetype& new_archetype = GetOrCreateArchetype(component_infos, old_archetype.GetSharedComponentValues());
 
-    m_EntityMaps[entity] = &new_archetype;
+    MoveEntity(entity, old_archetype, new_archetype);
+    new_archetype.DefaultConstructComponent(dynamic_component_info.type_id, entity);
 
     return GetDynamicComponent(entity, dynamic_component);
 }
@@ -134,88 +167,518 @@ auto EntityManager::AddDynamicComponent(entity_id_t entity, std::string_view dyn
 void EntityManager::RemoveDynamicComponent(entity_id_t entity, std::string_view dynamic_component) {
     if (!HasDynamicComponent(entity, dynamic_component)) return;
 
+    const auto& dynamic_component_info = GetDynamicComponentInfo(dynamic_component);
+    if (dynamic_component_info.storage == ComponentStorage::Sparse) {
+        GetSparseSet(dynamic_component_info.type_id)->Remove(entity);
+        return;
+    }
+
     auto& old_archetype   = *m_EntityMaps.at(entity);
     auto  component_infos = old_archetype.GetComponentInfoSet();
 
-    const auto removed_component_id = GetDynamicComponentInfo(dynamic_component).type_id;
+    const auto removed_component_id = dynamic_component_info.type_id;
     std::erase_if(component_infos, [=](const auto& info) { return info.type_id == removed_component_id; });
-    Archetype& new_archetype = GetOrCreateArchetype(component_infos);
+    Archetype& new_archetype = GetOrCreateArchetype(component_infos, old_archetype.GetSharedComponentValues());
 
-    new_archetype.AllocateFor(entity);
+    old_archetype.DestructComponent(removed_component_id, entity);
+    MoveEntity(entity, old_archetype, new_archetype);
+}
 
-    for (const auto& component_info : component_infos) {
-        const auto component_id = component_info.type_id;
-        new_archetype.MoveConstructComponent(component_id, entity, old_archetype.GetComponentData(component_id, entity));
-        old_archetype.DestructComponent(component_id, entity);
+auto EntityManager::GetDynamicComponent(entity_id_t entity, std::string_view dynamic_component) const -> std::byte* {
+    const auto& dynamic_component_info = GetDynamicComponentInfo(dynamic_component);
+    if (dynamic_component_info.storage == ComponentStorage::Sparse) {
+        const auto sparse_set = GetSparseSet(dynamic_component_info.type_id);
+        return sparse_set ? sparse_set->Get(entity) : nullptr;
     }
-    old_archetype.DestructComponent(removed_component_id, entity);
+    return m_EntityMaps.at(entity)->GetComponentData(dynamic_component_info.type_id, entity);
+}
 
-    old_archetype.DeallocateFor(entity);
+auto EntityManager::ReserveEntity() noexcept -> Entity {
+    return Entity(this, m_Counter.fetch_add(1));
+}
+
+void EntityManager::Playback(std::span<const std::unique_ptr<CommandBuffer>> command_buffers) {
+    using CommandType = CommandBuffer::CommandType;
+    using Command     = CommandBuffer::Command;
+
+    struct PendingEntity {
+        Archetype*                                   source    = nullptr;
+        bool                                         destroyed = false;
+        std::pmr::map<utils::TypeID, const Command*> added     = {};
+        std::pmr::set<utils::TypeID>                 removed   = {};
+    };
+
+    // entities are processed in the order of their first command
+    std::pmr::unordered_map<entity_id_t, PendingEntity> pending_entities;
+    std::pmr::vector<entity_id_t>                       entity_order;
+
+    const auto get_pending_entity = [&](const Command& command) -> PendingEntity* {
+        if (auto iter = pending_entities.find(command.entity); iter != pending_entities.end()) {
+            return iter->second.destroyed ? nullptr : &iter->second;
+        }
+
+        Archetype* source = nullptr;
+        if (command.type != CommandType::Create) {
+            if (!m_EntityMaps.contains(command.entity)) {
+                m_World.GetLogger()->warn("Skip command on a non-existent entity({})", command.entity);
+                return nullptr;
+            }
+            source = m_EntityMaps.at(command.entity);
+        }
+        entity_order.emplace_back(command.entity);
+        return &pending_entities.emplace(command.entity, PendingEntity{.source = source}).first->second;
+    };
+
+    // an entity may be created in one buffer and used in another, so the commands are merged in the recording order
+    std::pmr::vector<const Command*> commands;
+    for (const auto& command_buffer : command_buffers) {
+        for (const auto& command : command_buffer->m_Commands) {
+            commands.emplace_back(&command);
+        }
+    }
+    std::sort(commands.begin(), commands.end(), [](const Command* lhs, const Command* rhs) { return lhs->sequence < rhs->sequence; });
+
+    for (const auto p_command : commands) {
+        const auto& command        = *p_command;
+        auto        pending_entity = get_pending_entity(command);
+        if (pending_entity == nullptr) continue;
+
+        const auto component_id = command.component_id;
+        const auto sparse_set   = GetSparseSet(component_id);
+        const bool in_source    = sparse_set ? sparse_set->Contains(command.entity)
+                                             : pending_entity->source && pending_entity->source->HasComponent(component_id);
+        const bool removed      = pending_entity->removed.contains(component_id);
+        const bool added        = pending_entity->added.contains(component_id);
+
+        switch (command.type) {
+            case CommandType::Create:
+                break;
+            case CommandType::Destroy:
+                pending_entity->destroyed = true;
+                break;
+            case CommandType::Emplace:
+                // the existed component will not be replaced
+                if ((in_source && !removed) || added) break;
+                if (command.component_info) {
+                    UpdateComponentInfo(*command.component_info);
+                }
+                pending_entity->added.emplace(component_id, &command);
+                break;
+            case CommandType::Remove:
+                if (component_id == utils::TypeID::Create<Entity>()) break;
+                if (added) {
+                    pending_entity->added.erase(component_id);
+                } else if (in_source) {
+                    pending_entity->removed.emplace(component_id);
+                }
+                break;
+        }
+    }
+
+    // sparse components are added or removed after the entities are moved, they do not affect the target archetype
+    const auto is_sparse = [&](utils::TypeID component_id) {
+        return GetComponentInfo(component_id).storage == ComponentStorage::Sparse;
+    };
+
+    // [(source, target), entities]
+    std::pmr::map<std::pair<Archetype*, Archetype*>, std::pmr::vector<entity_id_t>> moves;
+    std::pmr::map<Archetype*, std::pmr::vector<entity_id_t>>                        destructions;
+
+    for (const auto entity : entity_order) {
+        const auto& pending_entity = pending_entities.at(entity);
+        if (pending_entity.destroyed) {
+            // the entity created and destroyed in the same playback is never allocated
+            if (pending_entity.source) destructions[pending_entity.source].emplace_back(entity);
+            continue;
+        }
+        if (pending_entity.source &&
+            ranges::all_of(pending_entity.added | ranges::views::keys, is_sparse) &&
+            ranges::all_of(pending_entity.removed, is_sparse)) continue;
+
+        auto component_infos = pending_entity.source
+                                   ? pending_entity.source->GetComponentInfoSet()
+                                   : detail::create_component_info_set<Entity>();
+        auto shared_values   = pending_entity.source
+                                   ? pending_entity.source->GetSharedComponentValues()
+                                   : detail::SharedComponentValues{};
+        std::erase_if(component_infos, [&](const auto& info) { return pending_entity.removed.contains(info.type_id); });
+        for (const auto& [component_id, command] : pending_entity.added) {
+            if (is_sparse(component_id)) continue;
+            const auto& component_info = component_infos.emplace(GetComponentInfo(component_id)).first;
+            if (component_info->storage == ComponentStorage::Shared) {
+                shared_values[component_id] = command->data;
+            }
+        }
+
+        moves[{pending_entity.source, &GetOrCreateArchetype(component_infos, shared_values)}].emplace_back(entity);
+    }
+
+    for (const auto& [archetype, entities] : destructions) {
+        for (const auto entity : entities) {
+            archetype->DestructAllComponents(entity);
+            archetype->DeallocateFor(entity);
+            m_EntityMaps.erase(entity);
+            for (auto& sparse_set : m_SparseSets | ranges::views::values) {
+                sparse_set->Remove(entity);
+            }
+        }
+    }
+
+    for (const auto& [archetypes, entities] : moves) {
+        const auto [source, target] = archetypes;
+
+        for (const auto entity : entities) {
+            const auto& pending_entity = pending_entities.at(entity);
+
+            if (source == target) {
+                // components are removed and added again, so just replace them in place
+                for (const auto component_id : pending_entity.removed) {
+                    if (is_sparse(component_id)) continue;
+                    target->DestructComponent(component_id, entity);
+                    target->MarkChanged(component_id, entity);
+                }
+            } else {
+                target->AllocateFor(entity);
+
+                if (source) {
+                    for (const auto& component_info : target->GetComponentInfoSet()) {
+                        const auto component_id = component_info.type_id;
+                        if (!source->HasComponent(component_id) || pending_entity.removed.contains(component_id)) continue;
+
+                        target->RelocateComponent(component_id, entity, source->GetComponentData(component_id, entity));
+                    }
+                    for (const auto component_id : pending_entity.removed) {
+                        if (is_sparse(component_id)) continue;
+                        source->DestructComponent(component_id, entity);
+                    }
+                    source->DeallocateFor(entity);
+                } else {
+                    target->ConstructComponent<Entity>(entity, Entity(this, entity));
+                }
+                m_EntityMaps.insert_or_assign(entity, target);
+            }
+
+            for (const auto& [component_id, command] : pending_entity.added) {
+                if (is_sparse(component_id)) continue;
+                if (command->data) {
+                    target->MoveConstructComponent(component_id, entity, command->data);
+                } else {
+                    target->DefaultConstructComponent(component_id, entity);
+                }
+            }
+        }
+    }
 
-    m_EntityMaps[entity] = &new_archetype;
+    for (const auto entity : entity_order) {
+        const auto& pending_entity = pending_entities.at(entity);
+        if (pending_entity.destroyed) continue;
+
+        for (const auto component_id : pending_entity.removed | ranges::views::filter(is_sparse)) {
+            GetSparseSet(component_id)->Remove(entity);
+        }
+        for (const auto& [component_id, command] : pending_entity.added) {
+            if (!is_sparse(component_id)) continue;
+
+            const auto& component_info = GetComponentInfo(component_id);
+            auto        data           = GetOrCreateSparseSet(component_info).Allocate(entity);
+            if (command->data && component_info.move_constructor) {
+                component_info.move_constructor(data, command->data);
+            } else if (command->data) {
+                std::memcpy(data, command->data, component_info.size);
+            } else if (component_info.default_constructor) {
+                component_info.default_constructor(data);
+            }
+        }
+    }
+
+    for (const auto& command_buffer : command_buffers) {
+        command_buffer->Clear();
+    }
 }
 
-auto EntityManager::GetDynamicComponent(entity_id_t entity, std::string_view dynamic_component) const -> std::byte* {
-    const auto component_id = GetDynamicComponentInfo(dynamic_component).type_id;
-    return m_EntityMaps.at(entity)->GetComponentData(component_id, entity);
+void EntityManager::CollectEmptyArchetypes() {
+    for (auto iter = m_Archetypes.begin(); iter != m_Archetypes.end();) {
+        const auto archetype = iter->second.get();
+        if (archetype->NumEntities() != 0) {
+            if (!m_EmptyArchetypes.empty()) m_EmptyArchetypes.erase(archetype);
+            ++iter;
+        } else if (++m_EmptyArchetypes[archetype] <= m_ChunkConfig.empty_archetype_lifetime) {
+            ++iter;
+        } else {
+            m_EmptyArchetypes.erase(archetype);
+            iter = m_Archetypes.erase(iter);
+        }
+    }
+}
+
+void EntityManager::UpdateLastFrameComponents() noexcept {
+    if (m_LastFrameComponents.empty()) return;
+
+    for (const auto& [archetype_id, archetype] : m_Archetypes) {
+        for (const auto& [component_id, last_frame_info] : m_LastFrameComponents) {
+            if (!archetype->HasComponent(component_id)) continue;
+
+            const auto buffers            = archetype->GetComponentBuffers(component_id);
+            const auto last_frame_buffers = archetype->GetComponentBuffers(last_frame_info.type_id);
+            const auto versions           = archetype->GetComponentVersions(component_id);
+            for (std::size_t chunk_index = 0; chunk_index < buffers.size(); chunk_index++) {
+                if (*versions[chunk_index] <= m_LastFrameVersion) continue;
+                std::memcpy(last_frame_buffers[chunk_index].first, buffers[chunk_index].first, buffers[chunk_index].second * last_frame_info.size);
+            }
+        }
+    }
+    m_LastFrameVersion = m_Version.load();
+}
+
+auto EntityManager::GetComponentColumns(utils::TypeID component_id, std::uint64_t& version) -> std::pmr::vector<ComponentColumn> {
+    version = NextVersion();
+
+    std::pmr::vector<ComponentColumn> columns;
+    for (const auto& [archetype_id, archetype] : m_Archetypes) {
+        if (!archetype->HasComponent(component_id)) continue;
+
+        auto& column = columns.emplace_back(ComponentColumn{
+            .archetype              = archetype.get(),
+            .archetype_serial       = archetype->GetSerial(),
+            .num_entities_per_chunk = archetype->NumEntitiesPerChunk(),
+            .num_entities           = archetype->NumEntities(),
+            .chunks                 = {},
+        });
+        const auto buffers  = archetype->GetComponentBuffers(component_id);
+        const auto versions = archetype->GetComponentVersions(component_id);
+        column.chunks.reserve(buffers.size());
+        for (std::size_t chunk_index = 0; chunk_index < buffers.size(); chunk_index++) {
+            column.chunks.emplace_back(ComponentColumn::Chunk{
+                .data         = buffers[chunk_index].first,
+                .num_entities = buffers[chunk_index].second,
+                .version      = *versions[chunk_index],
+            });
+        }
+    }
+    return columns;
+}
+
+auto EntityManager::GetGPUMirroredComponents() const -> std::pmr::vector<ComponentInfo> {
+    std::pmr::vector<ComponentInfo> result;
+    for (const auto& [component_id, component_info] : m_ComponentMap) {
+        if (component_info.gpu_mirrored) result.emplace_back(component_info);
+    }
+    return result;
+}
+
+auto EntityManager::GetMemoryReport() const -> MemoryReport {
+    MemoryReport report;
+    report.chunk_pool  = m_ChunkPool.GetStats();
+    report.total_bytes = report.chunk_pool.used_memory + report.chunk_pool.free_memory;
+
+    for (const auto& archetype : m_Archetypes | ranges::views::values) {
+        auto& archetype_report = report.archetypes.emplace_back(archetype->GetMemoryReport());
+        for (const auto& component_report : archetype_report.components) {
+            if (component_report.storage == ComponentStorage::Shared) report.total_bytes += component_report.reserved_bytes;
+        }
+    }
+    std::sort(report.archetypes.begin(), report.archetypes.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.num_chunks * lhs.chunk_size > rhs.num_chunks * rhs.chunk_size;
+    });
+
+    for (const auto& sparse_set : m_SparseSets | ranges::views::values) {
+        report.total_bytes += report.sparse_components.emplace_back(sparse_set->GetMemoryReport()).reserved_bytes;
+    }
+    return report;
+}
+
+auto EntityManager::GetSparseSet(utils::TypeID component_id) const noexcept -> SparseSet* {
+    const auto iter = m_SparseSets.find(component_id);
+    return iter == m_SparseSets.end() ? nullptr : iter->second.get();
+}
+
+auto EntityManager::GetOrCreateSparseSet(const ComponentInfo& component_info) -> SparseSet& {
+    auto& sparse_set = m_SparseSets[component_info.type_id];
+    if (sparse_set == nullptr) {
+        sparse_set = std::make_unique<SparseSet>(component_info);
+        m_SparseSignature.set(component_info.index);
+    }
+    return *sparse_set;
+}
+
+bool EntityManager::FilterEntity(const Filter& filter, entity_id_t entity) const {
+    auto signature = m_EntityMaps.at(entity)->GetSignature();
+    for (const auto& [component_id, index] : filter.components) {
+        if (!m_SparseSignature.test(index)) continue;
+        if (const auto sparse_set = GetSparseSet(component_id); sparse_set && sparse_set->Contains(entity)) {
+            signature.set(index);
+        }
+    }
+    return filter.Matches(signature);
+}
+
+void EntityManager::MarkComponentChanged(entity_id_t entity, utils::TypeID component_id) noexcept {
+    if (m_EntityMaps.contains(entity) && m_EntityMaps.at(entity)->HasComponent(component_id)) {
+        m_EntityMaps.at(entity)->MarkChanged(component_id, entity);
+    }
+}
+
+void EntityManager::UpdateComponentInfo(const ComponentInfo& component_info) noexcept {
+    const auto [iter, inserted] = m_ComponentMap.emplace(component_info.type_id, component_info);
+    if (!inserted || !component_info.double_buffered) return;
+
+    auto last_frame_info = detail::create_last_frame_component_info(component_info);
+    m_ComponentMap.emplace(last_frame_info.type_id, last_frame_info);
+    m_LastFrameComponents.emplace(component_info.type_id, std::move(last_frame_info));
 }
 
 auto EntityManager::GetComponentInfo(utils::TypeID component_id) const noexcept -> const ComponentInfo& {
     return m_ComponentMap.at(component_id);
 }
 
-auto EntityManager::GetOrCreateArchetype(const detail::ComponentInfoSet& component_infos) noexcept -> Archetype& {
-    const auto archetype_id = calculate_archetype_id(get_component_ids(component_infos));
-    if (!m_Archetypes.contains(archetype_id)) {
-        m_Archetypes.emplace(archetype_id, std::make_unique<Archetype>(component_infos));
+auto EntityManager::GetOrCreateArchetype(const detail::ComponentInfoSet& component_infos, const detail::SharedComponentValues& shared_values) noexcept -> Archetype& {
+    const bool last_frame_mismatched = std::any_of(m_LastFrameComponents.begin(), m_LastFrameComponents.end(), [&](const auto& item) {
+        return component_infos.contains(GetComponentInfo(item.first)) != component_infos.contains(item.second);
+    });
+    if (last_frame_mismatched) {
+        auto infos = component_infos;
+        for (const auto& [component_id, last_frame_info] : m_LastFrameComponents) {
+            if (infos.contains(GetComponentInfo(component_id))) {
+                infos.emplace(last_frame_info);
+            } else {
+                infos.erase(last_frame_info);
+            }
+        }
+        return GetOrCreateArchetype(infos, shared_values);
+    }
+
+    const auto signature    = detail::get_component_signature(component_infos);
+    auto       archetype_id = std::hash<ComponentSignature>{}(signature);
+
+    detail::SharedComponentValues                                   values_with_default;
+    std::pmr::vector<std::pair<const ComponentInfo*, core::Buffer>> default_values;
+    for (const auto& component_info : component_infos) {
+        if (component_info.storage != ComponentStorage::Shared || shared_values.contains(component_info.type_id)) continue;
+
+        if (default_values.empty()) values_with_default = shared_values;
+        auto& default_value = default_values.emplace_back(&component_info, core::Buffer(component_info.size, nullptr, alignof(std::max_align_t))).second;
+        component_info.default_constructor(default_value.GetData());
+        values_with_default.emplace(component_info.type_id, default_value.GetData());
+    }
+    // the given values are used directly in most cases
+    const auto& values = default_values.empty() ? shared_values : values_with_default;
+
+    for (const auto& component_info : component_infos) {
+        if (component_info.storage != ComponentStorage::Shared) continue;
+        archetype_id = utils::combine_hash(std::array{archetype_id, component_info.hash(values.at(component_info.type_id))});
+    }
+
+    auto [first, last] = m_Archetypes.equal_range(archetype_id);
+    auto iter          = std::find_if(first, last, [&](const auto& item) {
+        return item.second->GetSignature() == signature && item.second->MatchSharedComponentValues(values);
+    });
+    if (iter == last) {
+        iter = m_Archetypes.emplace(archetype_id, std::make_unique<Archetype>(m_NumCreatedArchetypes++, component_infos, m_ChunkConfig, m_Version, m_ChunkPool, values));
+    }
+
+    for (auto& [component_info, default_value] : default_values) {
+        if (component_info->destructor) component_info->destructor(default_value.GetData());
+    }
+
+    return *iter->second;
+}
+
+void EntityManager::MoveEntity(entity_id_t entity, Archetype& old_archetype, Archetype& new_archetype) noexcept {
+    new_archetype.AllocateFor(entity);
+    for (const auto& component_info : new_archetype.GetComponentInfoSet()) {
+        const auto component_id = component_info.type_id;
+        if (!old_archetype.HasComponent(component_id)) continue;
+
+        new_archetype.RelocateComponent(component_id, entity, old_archetype.GetComponentData(component_id, entity));
     }
-    return *m_Archetypes[archetype_id];
+    old_archetype.DeallocateFor(entity);
+
+    m_EntityMaps.insert_or_assign(entity, &new_archetype);
 }
 
 auto EntityManager::GetComponentsBuffers(const detail::ComponentIdList& components, Filter filter) const noexcept
     -> std::pmr::vector<std::pmr::vector<ComponentData>>
 
 {
-    auto new_filter = [&](Archetype* p_archetype) {
-        for (const auto component_id : components) {
-            if (!p_archetype->HasComponent(component_id)) return false;
-        }
-
-        if (filter && !filter(ComponentChecker(p_archetype)))
-            return false;
+    // sparse components are looked up by entity, so archetypes only need the others
+    ComponentSignature signature;
+    for (const auto component_id : components) {
+        if (GetSparseSet(component_id)) continue;
+
+        const auto iter = m_ComponentMap.find(component_id);
+        if (iter == m_ComponentMap.end()) return {};
+        signature.set(iter->second.index);
+    }
 
-        return true;
-    };
+    // the sparse components of the filter are unknown until the entity is checked
+    const auto sparse_signature  = filter.GetSignature() & m_SparseSignature;
+    const bool filter_per_entity = sparse_signature.any();
 
-    auto archetypes = m_Archetypes                                                                     //
-                      | ranges::views::values                                                          //
-                      | ranges::views::transform([](auto& p_archetype) { return p_archetype.get(); })  //
-                      | ranges::views::filter(new_filter)                                              //
-                      | ranges::to<std::pmr::vector<Archetype*>>();
+    // [(archetype, whether the filter is evaluated for each entity)]
+    std::pmr::vector<std::pair<Archetype*, bool>> archetypes;
+    for (const auto& p_archetype : m_Archetypes | ranges::views::values) {
+        if (!p_archetype->HasComponents(signature)) continue;
+        if (filter && !filter.MayMatch(p_archetype->GetSignature(), sparse_signature)) continue;
+        archetypes.emplace_back(p_archetype.get(), filter_per_entity);
+    }
 
     if (archetypes.empty()) return {};
 
-    // [num_components, num_buffers]
-    std::pmr::vector<std::pmr::vector<ComponentData>> result;
-
-    for (const auto& component_id : components) {
-        const auto& component_info = GetComponentInfo(component_id);
-
-        auto component_data = archetypes  //
-                              | ranges::views::transform([&component_info](auto p_archetype) {
-                                    return p_archetype->GetComponentBuffers(component_info.type_id);
-                                })                   //
-                              | ranges::views::join  //
-                              | ranges::views::transform([&component_info](auto& component_buffer) {
-                                    return ComponentData{
-                                        .data         = component_buffer.first,
-                                        .size         = component_info.size,
-                                        .num_entities = component_buffer.second,
-                                    };
-                                })  //
-                              | ranges::to<std::pmr::vector<ComponentData>>();
-
-        result.emplace_back(std::move(component_data));
+    // the iteration order of the hash map changes when it grows, tasks resuming from a chunk need a stable order
+    std::sort(archetypes.begin(), archetypes.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first->GetSerial() < rhs.first->GetSerial();
+    });
+
+    std::pmr::vector<std::pmr::vector<ComponentData>> result(components.size() + 1);
+
+    for (const auto& [p_archetype, filter_per_entity] : archetypes) {
+        const auto entity_buffers  = p_archetype->GetComponentBuffers(utils::TypeID::Create<Entity>());
+        const auto entity_versions = p_archetype->GetComponentVersions(utils::TypeID::Create<Entity>());
+
+        for (const auto [component_id, component_data] : ranges::views::zip(components, result)) {
+            if (const auto sparse_set = GetSparseSet(component_id); sparse_set && !p_archetype->HasComponent(component_id)) {
+                for (const auto& buffer : entity_buffers) {
+                    component_data.emplace_back(ComponentData{
+                        .data              = nullptr,
+                        .size              = 0,
+                        .num_entities      = buffer.second,
+                        .version           = nullptr,
+                        .sparse_set        = sparse_set,
+                        .filter_per_entity = filter_per_entity,
+                    });
+                }
+                continue;
+            }
+
+            const auto& component_info = GetComponentInfo(component_id);
+
+            // all entities in a chunk refer to the same chunk or shared component
+            const auto stride = component_info.storage == ComponentStorage::Entity ? component_info.size : 0;
+
+            const auto buffers  = p_archetype->GetComponentBuffers(component_info.type_id);
+            const auto versions = p_archetype->GetComponentVersions(component_info.type_id);
+            for (const auto [buffer, version] : ranges::views::zip(buffers, versions)) {
+                component_data.emplace_back(ComponentData{
+                    .data              = buffer.first,
+                    .size              = stride,
+                    .num_entities      = buffer.second,
+                    .version           = version,
+                    .filter_per_entity = filter_per_entity,
+                });
+            }
+        }
+
+        for (const auto [chunk_index, buffer, version] : ranges::views::zip(ranges::views::indices(entity_buffers.size()), entity_buffers, entity_versions)) {
+            result.back().emplace_back(ComponentData{
+                .data              = buffer.first,
+                .size              = sizeof(Entity),
+                .num_entities      = buffer.second,
+                .version           = version,
+                .filter_per_entity = filter_per_entity,
+                .archetype_serial  = p_archetype->GetSerial(),
+                .chunk_index       = chunk_index,
+            });
+        }
     }
 
     const auto num_buffers = result.front().size();
@@ -0,0 +1,162 @@
+#include <hitagi/ecs/gpu_mirror.hpp>
+
+#include <fmt/format.h>
+#include <range/v3/view/map.hpp>
+#include <tracy/Tracy.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace hitagi::ecs {
+
+GPUMirror::GPUMirror(EntityManager& entity_manager, gfx::Device& device)
+    : m_EntityManager(entity_manager),
+      m_Device(device),
+      m_Fence(device.CreateFence(0, "GPUMirror")) {}
+
+GPUMirror::~GPUMirror() {
+    m_Fence->Wait(m_FenceValue);
+}
+
+void GPUMirror::Upload() {
+    ZoneScopedN("GPUMirror::Upload");
+    m_LastUploadStats = {};
+
+    const auto completed_value = m_Fence->GetCurrentValue();
+    std::erase_if(m_RetiredResources, [&](const auto& retired) { return retired.fence_value <= completed_value; });
+
+    // a dirty chunk is copied to the staging buffer, and the adjacent ones in a column are copied to the column buffer at once
+    struct StagingCopy {
+        const std::byte* src;
+        std::size_t      size;
+    };
+    struct Copy {
+        gfx::GPUBuffer* dst;
+        std::size_t     staging_offset;
+        std::size_t     dst_offset;
+        std::size_t     size;
+    };
+    std::pmr::vector<StagingCopy> staging_copies;
+    std::pmr::vector<Copy>        copies;
+    std::size_t                   staging_size = 0;
+
+    for (const auto& component_info : m_EntityManager.GetGPUMirroredComponents()) {
+        std::uint64_t version = 0;
+        const auto    columns = m_EntityManager.GetComponentColumns(component_info.type_id, version);
+
+        auto& mirrors = m_Mirrors[component_info.type_id];
+        std::erase_if(mirrors, [&](const auto& item) {
+            const bool destroyed = std::none_of(columns.begin(), columns.end(), [&](const auto& column) { return column.archetype_serial == item.first; });
+            if (destroyed) m_RetiredResources.emplace_back(Retired{.buffer = item.second.buffer, .context = nullptr, .fence_value = m_FenceValue});
+            return destroyed;
+        });
+
+        for (const auto& column : columns) {
+            auto&      mirror      = mirrors[column.archetype_serial];
+            const auto column_size = column.num_entities_per_chunk * component_info.size;
+            const auto num_chunks  = column.chunks.size();
+            const bool recreated   = !mirror.buffer || mirror.num_entities_per_chunk != column.num_entities_per_chunk || mirror.buffer->Size() < num_chunks * column_size;
+            if (recreated) {
+                if (mirror.buffer) {
+                    m_RetiredResources.emplace_back(Retired{.buffer = std::move(mirror.buffer), .context = nullptr, .fence_value = m_FenceValue});
+                }
+                // grow by power of two chunks, so that spawning entities does not recreate the buffer every frame
+                mirror = Mirror{
+                    .buffer = m_Device.CreateGPUBuffer({
+                        .name         = std::pmr::string(fmt::format("GPUMirror-{}", component_info.name)),
+                        .element_size = std::bit_ceil(std::max<std::size_t>(num_chunks, 1)) * column_size,
+                        .usages       = gfx::GPUBufferUsageFlags::Storage | gfx::GPUBufferUsageFlags::CopyDst,
+                    }),
+                    .num_entities_per_chunk = column.num_entities_per_chunk,
+                };
+                m_LastUploadStats.num_created_buffers++;
+            }
+
+            const auto first_copy = copies.size();
+            bool       merging    = false;
+            for (std::size_t chunk_index = 0; chunk_index < num_chunks; chunk_index++) {
+                const auto& chunk = column.chunks[chunk_index];
+                if (chunk.version <= mirror.version || chunk.num_entities == 0) {
+                    merging = false;
+                    continue;
+                }
+
+                const auto size = chunk.num_entities * component_info.size;
+                staging_copies.emplace_back(StagingCopy{.src = chunk.data, .size = size});
+                if (merging) {
+                    // only the last chunk of a column is not full, so the merged chunks are contiguous in the buffer
+                    copies.back().size += size;
+                } else {
+                    copies.emplace_back(Copy{
+                        .dst            = mirror.buffer.get(),
+                        .staging_offset = staging_size,
+                        .dst_offset     = chunk_index * column_size,
+                        .size           = size,
+                    });
+                    merging = true;
+                }
+                staging_size += size;
+            }
+            mirror.archetype    = column.archetype;
+            mirror.version      = version;
+            mirror.num_entities = column.num_entities;
+
+            for (std::size_t index = first_copy; index < copies.size(); index++) {
+                m_LastUploadStats.ranges.emplace_back(GPUMirrorStats::Range{
+                    .component_id = component_info.type_id,
+                    .archetype    = column.archetype,
+                    .offset       = copies[index].dst_offset,
+                    .size         = copies[index].size,
+                });
+            }
+        }
+    }
+    if (staging_size == 0) return;
+
+    m_LastUploadStats.uploaded_bytes = staging_size;
+
+    auto staging_buffer = m_Device.CreateGPUBuffer({
+        .name         = "GPUMirror-Staging",
+        .element_size = staging_size,
+        .usages       = gfx::GPUBufferUsageFlags::MapWrite | gfx::GPUBufferUsageFlags::CopySrc,
+    });
+    {
+        auto mapped = staging_buffer->Map();
+        for (const auto& staging_copy : staging_copies) {
+            std::memcpy(mapped, staging_copy.src, staging_copy.size);
+            mapped += staging_copy.size;
+        }
+        staging_buffer->UnMap();
+    }
+
+    auto context = m_Device.CreateCopyContext("GPUMirror");
+    context->Begin();
+    for (const auto& copy : copies) {
+        context->CopyBuffer(*staging_buffer, copy.staging_offset, *copy.dst, copy.dst_offset, copy.size);
+    }
+    context->End();
+
+    m_FenceValue++;
+    const gfx::FenceSignalInfo signal_info{.fence = *m_Fence, .value = m_FenceValue};
+    m_Device.GetCommandQueue(gfx::CommandType::Copy).Submit({{*context}}, {}, {{signal_info}});
+
+    m_RetiredResources.emplace_back(Retired{.buffer = std::move(staging_buffer), .context = std::move(context), .fence_value = m_FenceValue});
+}
+
+auto GPUMirror::GetColumns(utils::TypeID component_id) const -> std::pmr::vector<Column> {
+    std::pmr::vector<Column> result;
+    if (const auto iter = m_Mirrors.find(component_id); iter != m_Mirrors.end()) {
+        for (const auto& mirror : iter->second | ranges::views::values) {
+            result.emplace_back(Column{
+                .archetype              = mirror.archetype,
+                .buffer                 = mirror.buffer,
+                .num_entities_per_chunk = mirror.num_entities_per_chunk,
+                .num_entities           = mirror.num_entities,
+            });
+        }
+    }
+    return result;
+}
+
+}  // namespace hitagi::ecs
@@ -0,0 +1,69 @@
+#include <hitagi/ecs/memory_report.hpp>
+
+#include <fmt/format.h>
+
+#include <iterator>
+
+namespace hitagi::ecs {
+
+inline auto storage_name(ComponentStorage storage) noexcept -> std::string_view {
+    switch (storage) {
+        case ComponentStorage::Entity:
+            return "Entity";
+        case ComponentStorage::Chunk:
+            return "Chunk";
+        case ComponentStorage::Shared:
+            return "Shared";
+        case ComponentStorage::Sparse:
+            return "Sparse";
+    }
+    return "Unknown";
+}
+
+inline void write_json_string(std::pmr::string& out, std::string_view str) {
+    out += '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) {
+            fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned>(c));
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+inline void write_json_components(std::pmr::string& out, const std::pmr::vector<ComponentMemoryReport>& components) {
+    out += '[';
+    for (std::size_t index = 0; const auto& component : components) {
+        if (index++ != 0) out += ',';
+        out += R"({"name":)";
+        write_json_string(out, component.name);
+        fmt::format_to(std::back_inserter(out), R"(,"storage":"{}","component_size":{},"reserved_bytes":{},"used_bytes":{}}})",
+                       storage_name(component.storage), component.component_size, component.reserved_bytes, component.used_bytes);
+    }
+    out += ']';
+}
+
+auto MemoryReport::ToJson() const -> std::pmr::string {
+    std::pmr::string out;
+
+    fmt::format_to(std::back_inserter(out), R"({{"total_bytes":{},"chunk_pool":{{"num_used_chunks":{},"used_memory":{},"num_free_chunks":{},"free_memory":{},"num_allocations":{},"num_deallocations":{}}},"archetypes":[)",
+                   total_bytes, chunk_pool.num_used_chunks, chunk_pool.used_memory, chunk_pool.num_free_chunks, chunk_pool.free_memory,
+                   chunk_pool.num_allocations, chunk_pool.num_deallocations);
+    for (std::size_t index = 0; const auto& archetype : archetypes) {
+        if (index++ != 0) out += ',';
+        fmt::format_to(std::back_inserter(out), R"({{"num_chunks":{},"num_entities":{},"num_entities_per_chunk":{},"chunk_size":{},"utilization":{},"padding_bytes":{},"components":)",
+                       archetype.num_chunks, archetype.num_entities, archetype.num_entities_per_chunk, archetype.chunk_size,
+                       archetype.utilization, archetype.padding_bytes);
+        write_json_components(out, archetype.components);
+        out += '}';
+    }
+    out += R"(],"sparse_components":)";
+    write_json_components(out, sparse_components);
+    out += '}';
+
+    return out;
+}
+
+}  // namespace hitagi::ecs
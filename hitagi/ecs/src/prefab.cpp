@@ -0,0 +1,256 @@
+#include <hitagi/ecs/prefab.hpp>
+#include <hitagi/ecs/entity_manager.hpp>
+#include <hitagi/ecs/world.hpp>
+
+#include <fmt/format.h>
+#include <range/v3/view/map.hpp>
+#include <spdlog/logger.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace hitagi::ecs {
+
+// the same as snapshot, components without copy constructor are copied bitwise
+inline bool copied_bitwise(const ComponentInfo& component_info) noexcept {
+    return !component_info.copy_constructor || (component_info.trivially_relocatable && !component_info.destructor);
+}
+
+inline void copy_component(const ComponentInfo& component_info, std::byte* dest, const std::byte* src) noexcept {
+    if (copied_bitwise(component_info)) {
+        std::memcpy(dest, src, component_info.size);
+    } else {
+        component_info.copy_constructor(dest, src);
+    }
+}
+
+// fill `size` bytes of `dest` with the repeated `pattern`, starting from `offset` of the pattern
+inline void fill_pattern(std::byte* dest, std::span<const std::byte> pattern, std::size_t offset, std::size_t size) noexcept {
+    const auto head = std::min(pattern.size() - offset, size);
+    std::memcpy(dest, pattern.data() + offset, head);
+    std::memcpy(dest + head, pattern.data(), std::min(offset, size - head));
+
+    // the filled bytes are a whole period of the pattern, so doubling them keeps the pattern
+    for (std::size_t filled = std::min(pattern.size(), size); filled < size; filled *= 2) {
+        std::memcpy(dest + filled, dest, std::min(filled, size - filled));
+    }
+}
+
+auto EntityRemap::operator()(const Entity& entity) const noexcept -> Entity {
+    if (entity.m_EntityManager != m_Source) return {};
+    const auto iter = m_EntityIndices.find(entity.GetId());
+    if (iter == m_EntityIndices.end()) return {};
+    return Entity(&m_EntityManager, m_FirstEntity + iter->second);
+}
+
+Prefab::Prefab(Prefab&& other) noexcept
+    : m_Source(other.m_Source),
+      m_Groups(std::move(other.m_Groups)),
+      m_SparseComponents(std::move(other.m_SparseComponents)),
+      m_EntityIndices(std::move(other.m_EntityIndices)) {
+    other.m_Groups.clear();
+    other.m_SparseComponents.clear();
+    other.m_EntityIndices.clear();
+}
+
+Prefab& Prefab::operator=(Prefab&& rhs) noexcept {
+    if (this != &rhs) {
+        Destroy();
+        m_Source           = rhs.m_Source;
+        m_Groups           = std::move(rhs.m_Groups);
+        m_SparseComponents = std::move(rhs.m_SparseComponents);
+        m_EntityIndices    = std::move(rhs.m_EntityIndices);
+        rhs.m_Groups.clear();
+        rhs.m_SparseComponents.clear();
+        rhs.m_EntityIndices.clear();
+    }
+    return *this;
+}
+
+Prefab::~Prefab() {
+    Destroy();
+}
+
+void Prefab::Destroy() noexcept {
+    for (auto& group : m_Groups) {
+        for (auto& column : group.columns) {
+            if (column.component_info.destructor == nullptr) continue;
+            for (std::size_t index = 0; index < column.num_components; index++) {
+                column.component_info.destructor(column.data.GetData() + index * column.component_info.size);
+            }
+        }
+    }
+    for (auto& sparse_component : m_SparseComponents) {
+        if (sparse_component.component_info.destructor) {
+            sparse_component.component_info.destructor(sparse_component.data.GetData());
+        }
+    }
+    m_Groups.clear();
+    m_SparseComponents.clear();
+    m_EntityIndices.clear();
+}
+
+auto EntityManager::CreatePrefab(std::span<const Entity> entities) const -> Prefab {
+    Prefab prefab;
+    prefab.m_Source = this;
+
+    // group the entities by archetype, the entities in a group keep their order
+    std::pmr::unordered_map<Archetype*, std::size_t> group_indices;
+    std::pmr::vector<Archetype*>                     archetypes;
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        const auto entity = entities[index].GetId();
+        if (!m_EntityMaps.contains(entity) || !prefab.m_EntityIndices.emplace(entity, index).second) {
+            const auto error_message = fmt::format("Entity({}) is invalid or captured more than once", entity);
+            m_World.GetLogger()->error(error_message);
+            throw std::invalid_argument(error_message);
+        }
+
+        const auto archetype       = m_EntityMaps.at(entity);
+        const auto [iter, created] = group_indices.emplace(archetype, prefab.m_Groups.size());
+        if (created) {
+            prefab.m_Groups.emplace_back().component_infos = archetype->GetComponentInfoSet();
+            archetypes.emplace_back(archetype);
+        }
+        prefab.m_Groups[iter->second].entity_indices.emplace_back(index);
+    }
+
+    for (std::size_t group_index = 0; group_index < prefab.m_Groups.size(); group_index++) {
+        auto&      group     = prefab.m_Groups[group_index];
+        const auto archetype = archetypes[group_index];
+
+        for (const auto& component_info : group.component_infos) {
+            const auto size = component_info.size;
+
+            if (component_info.storage == ComponentStorage::Entity && component_info.type_id != utils::TypeID::Create<Entity>()) {
+                auto& column = group.columns.emplace_back(Prefab::Column{
+                    .component_info = component_info,
+                    .data           = core::Buffer(group.entity_indices.size() * size, nullptr, 64),
+                    .num_components = group.entity_indices.size(),
+                });
+                for (std::size_t index = 0; const auto entity_index : group.entity_indices) {
+                    const auto src  = archetype->GetComponentData(component_info.type_id, entities[entity_index].GetId());
+                    copy_component(component_info, column.data.GetData() + size * index++, src);
+                }
+            } else if (component_info.storage == ComponentStorage::Shared) {
+                auto& column = group.columns.emplace_back(Prefab::Column{
+                    .component_info = component_info,
+                    .data           = core::Buffer(size, nullptr, 64),
+                    .num_components = 1,
+                });
+                copy_component(component_info, column.data.GetData(), archetype->GetSharedComponentValues().at(component_info.type_id));
+                group.shared_values.emplace(component_info.type_id, column.data.GetData());
+            }
+        }
+    }
+
+    for (const auto& sparse_set : m_SparseSets | ranges::views::values) {
+        const auto& component_info = sparse_set->GetComponentInfo();
+        for (std::size_t index = 0; index < entities.size(); index++) {
+            const auto src = sparse_set->Get(entities[index].GetId());
+            if (src == nullptr) continue;
+
+            auto& sparse_component = prefab.m_SparseComponents.emplace_back(Prefab::SparseComponent{
+                .component_info = component_info,
+                .entity_index   = index,
+                .data           = core::Buffer(component_info.size, nullptr, 64),
+            });
+            copy_component(component_info, sparse_component.data.GetData(), src);
+        }
+    }
+
+    return prefab;
+}
+
+auto EntityManager::Instantiate(const Prefab& prefab, std::size_t num) -> std::pmr::vector<Entity> {
+    const auto num_prefab_entities = prefab.NumEntities();
+    if (num == 0 || num_prefab_entities == 0) return {};
+
+    const entity_id_t first_entity = m_Counter.fetch_add(num * num_prefab_entities);
+
+    const auto get_remap = [&](std::size_t instance) {
+        return EntityRemap(prefab.m_Source, *this, prefab.m_EntityIndices, first_entity + instance * num_prefab_entities);
+    };
+
+    for (const auto& group : prefab.m_Groups) {
+        for (const auto& component_info : group.component_infos) {
+            UpdateComponentInfo(component_info);
+        }
+        auto& archetype = GetOrCreateArchetype(group.component_infos, group.shared_values);
+
+        // the entities of all instances are appended to the archetype contiguously
+        const auto                    group_size = group.entity_indices.size();
+        std::pmr::vector<entity_id_t> group_entities;
+        group_entities.reserve(num * group_size);
+        for (std::size_t instance = 0; instance < num; instance++) {
+            for (const auto entity_index : group.entity_indices) {
+                group_entities.emplace_back(first_entity + instance * num_prefab_entities + entity_index);
+            }
+        }
+        const auto first_index = archetype.NumEntities();
+        archetype.AllocateFor(group_entities);
+        for (const auto entity : group_entities) {
+            m_EntityMaps.emplace(entity, &archetype);
+        }
+
+        const auto num_entities_per_chunk = archetype.NumEntitiesPerChunk();
+        const auto get_component_data     = [&](const std::pmr::vector<std::pair<std::byte*, std::size_t>>& buffers, std::size_t size, std::size_t index) {
+            const auto slot = first_index + index;
+            return buffers[slot / num_entities_per_chunk].first + (slot % num_entities_per_chunk) * size;
+        };
+
+        const auto entity_buffers = archetype.GetComponentBuffers(utils::TypeID::Create<Entity>());
+        for (std::size_t index = 0; index < group_entities.size(); index++) {
+            std::construct_at(reinterpret_cast<Entity*>(get_component_data(entity_buffers, sizeof(Entity), index)), Entity(this, group_entities[index]));
+        }
+
+        for (const auto& column : group.columns) {
+            const auto& component_info = column.component_info;
+            if (component_info.storage != ComponentStorage::Entity) continue;
+
+            const auto size    = component_info.size;
+            const auto buffers = archetype.GetComponentBuffers(component_info.type_id);
+
+            // copy the runs of entities in each chunk, the components repeat every `group_size` entities
+            for (std::size_t index = 0; index < group_entities.size();) {
+                const auto slot = first_index + index;
+                const auto run  = std::min(num_entities_per_chunk - slot % num_entities_per_chunk, group_entities.size() - index);
+                const auto dest = get_component_data(buffers, size, index);
+                if (copied_bitwise(component_info)) {
+                    fill_pattern(dest, std::span{column.data.GetData(), group_size * size}, (index % group_size) * size, run * size);
+                } else {
+                    for (std::size_t offset = 0; offset < run; offset++) {
+                        copy_component(component_info, dest + offset * size, column.data.GetData() + ((index + offset) % group_size) * size);
+                    }
+                }
+                index += run;
+            }
+
+            if (component_info.remap_entities) {
+                for (std::size_t index = 0; index < group_entities.size(); index++) {
+                    component_info.remap_entities(get_component_data(buffers, size, index), get_remap(index / group_size));
+                }
+            }
+        }
+    }
+
+    for (const auto& sparse_component : prefab.m_SparseComponents) {
+        const auto& component_info = sparse_component.component_info;
+        UpdateComponentInfo(component_info);
+        auto& sparse_set = GetOrCreateSparseSet(component_info);
+
+        for (std::size_t instance = 0; instance < num; instance++) {
+            const auto data = sparse_set.Allocate(first_entity + instance * num_prefab_entities + sparse_component.entity_index);
+            copy_component(component_info, data, sparse_component.data.GetData());
+            if (component_info.remap_entities) component_info.remap_entities(data, get_remap(instance));
+        }
+    }
+
+    std::pmr::vector<Entity> result;
+    result.reserve(num * num_prefab_entities);
+    for (std::size_t index = 0; index < num * num_prefab_entities; index++) {
+        result.emplace_back(Entity(this, first_entity + index));
+    }
+    return result;
+}
+
+}  // namespace hitagi::ecs
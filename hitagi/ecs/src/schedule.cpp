@@ -5,6 +5,7 @@
 #include <range/v3/view/drop.hpp>
 #include <taskflow/taskflow.hpp>
 #include <spdlog/logger.h>
+#include <tracy/Tracy.hpp>
 
 namespace hitagi::ecs {
 void Schedule::Request(std::shared_ptr<TaskBase> task, const ParameterSets& parameter_sets) {
@@ -13,61 +14,201 @@ void Schedule::Request(std::shared_ptr<TaskBase> task, const ParameterSets& para
         return;
     }
 
+    task->system                  = m_RequestingSystem;
     m_TaskNameToIndex[task->name] = m_Tasks.size();
     m_Tasks.emplace_back(std::move(task));
+    m_TaskParameterSets.emplace_back(parameter_sets);
+}
+
+void Schedule::SetOrder(std::string_view first_task, std::string_view second_task) {
+    m_CustomOrder.emplace(first_task, second_task);
+}
+
+void Schedule::SetBudget(std::string_view task, TaskBudget budget) {
+    m_TaskBudgets.insert_or_assign(std::pmr::string(task), budget);
+}
+
+void Schedule::SetSystemEnabled(utils::TypeID system, bool enabled) noexcept {
+    for (const auto& task : m_Tasks) {
+        if (task->system == system) task->enabled = enabled;
+    }
+}
+
+void Schedule::Reset() {
+    m_Tasks.clear();
+    m_TaskParameterSets.clear();
+    m_TaskNameToIndex.clear();
+    m_CustomOrder.clear();
+    m_TaskBudgets.clear();
+}
+
+void Schedule::Run(tf::Executor& executor, FrameStats& frame_stats) {
+    ZoneScopedN("Schedule::Run");
+
+    frame_stats.tasks.clear();
+    frame_stats.critical_path.clear();
+    frame_stats.schedule_time      = {};
+    frame_stats.critical_path_time = {};
 
-    const auto& [read_before_write, write, read_after_write] = parameter_sets;
-    for (auto parameter : read_before_write) {
-        m_ReadBeforeWriteSet[parameter].emplace_back(m_Tasks.size() - 1);
+    frame_stats.graph_compiled = NeedCompile();
+    if (frame_stats.graph_compiled) {
+        Compile(executor);
     }
-    for (auto parameter : write) {
-        m_WriteSet[parameter].emplace_back(m_Tasks.size() - 1);
+    if (!m_CompiledGraph.valid) {
+        return;
+    }
+
+    for (const auto& task : m_Tasks) {
+        const auto& state      = m_TaskStates[task->name];
+        task->last_run_version = state.last_run_version;
+        task->cursor           = state.cursor;
+        task->cycle_version    = state.cycle_version;
+        task->stats            = {.name = task->name};
+        if (const auto iter = m_TaskBudgets.find(task->name); iter != m_TaskBudgets.end()) {
+            task->budget = iter->second;
+        }
     }
-    for (auto parameter : read_after_write) {
-        m_ReadAfterWriteSet[parameter].emplace_back(m_Tasks.size() - 1);
+
+    m_StartTime = std::chrono::steady_clock::now();
+    // the world is updated on a worker when the executor is shared by a world group
+    if (executor.this_worker_id() >= 0) {
+        executor.corun(m_CompiledGraph.taskflow);
+    } else {
+        executor.run(m_CompiledGraph.taskflow).wait();
     }
+    frame_stats.schedule_time = std::chrono::steady_clock::now() - m_StartTime;
+
+    for (const auto& task : m_Tasks) {
+        m_TaskStates[task->name] = {
+            .last_run_version = task->last_run_version,
+            .cursor           = task->cursor,
+            .cycle_version    = task->cycle_version,
+        };
+        frame_stats.tasks.emplace_back(std::move(task->stats));
+    }
+    AnalyzeDependencies(frame_stats);
 }
 
-void Schedule::SetOrder(std::string_view first_task, std::string_view second_task) {
-    m_CustomOrder.emplace(first_task, second_task);
+void Schedule::RunTask(std::size_t index, tf::Executor& executor) {
+    auto& task = *m_Tasks[index];
+
+    // the system is skipped in this frame, its states are kept for the next run
+    if (!task.enabled) return;
+
+    ZoneScoped;
+    ZoneName(task.name.data(), task.name.size());
+
+    const auto start_time = std::chrono::steady_clock::now();
+    task.Run(world);
+    const auto end_time = std::chrono::steady_clock::now();
+
+    task.stats.worker_id  = executor.this_worker_id();
+    task.stats.start_time = start_time - m_StartTime;
+    task.stats.duration   = end_time - start_time;
+    ZoneValue(task.stats.num_entities);
+    if (task.stats.num_deferred_chunks != 0) {
+        ZoneValue(task.stats.num_deferred_chunks);
+    }
 }
 
-void Schedule::Run(tf::Executor& executor) {
-    tf::Taskflow               taskflow;
+void Schedule::AnalyzeDependencies(FrameStats& frame_stats) const {
+    const auto num_tasks = frame_stats.tasks.size();
+
+    // the total duration of the longest chain ending with each task, and the previous task in the chain
+    std::pmr::vector<std::chrono::nanoseconds> chain_times(num_tasks, std::chrono::nanoseconds{0});
+    std::pmr::vector<std::size_t>              chain_predecessors(num_tasks, num_tasks);
+
+    for (const auto index : m_CompiledGraph.topological_order) {
+        auto& task_stats = frame_stats.tasks[index];
+
+        auto ready_time = std::chrono::nanoseconds{0};
+        for (const auto predecessor : m_CompiledGraph.predecessors[index]) {
+            const auto& predecessor_stats = frame_stats.tasks[predecessor];
+            ready_time                    = std::max(ready_time, predecessor_stats.start_time + predecessor_stats.duration);
+
+            if (chain_predecessors[index] == num_tasks || chain_times[predecessor] > chain_times[chain_predecessors[index]]) {
+                chain_predecessors[index] = predecessor;
+            }
+        }
+        task_stats.wait_time = std::max(task_stats.start_time - ready_time, std::chrono::nanoseconds{0});
+        chain_times[index]   = task_stats.duration + (chain_predecessors[index] == num_tasks ? std::chrono::nanoseconds{0} : chain_times[chain_predecessors[index]]);
+    }
+
+    if (num_tasks == 0) return;
+
+    auto last = static_cast<std::size_t>(std::max_element(chain_times.begin(), chain_times.end()) - chain_times.begin());
+    frame_stats.critical_path_time = chain_times[last];
+    for (; last != num_tasks; last = chain_predecessors[last]) {
+        frame_stats.critical_path.emplace_back(last);
+    }
+    std::reverse(frame_stats.critical_path.begin(), frame_stats.critical_path.end());
+}
+
+bool Schedule::NeedCompile() const noexcept {
+    if (m_Tasks.size() != m_CompiledGraph.task_names.size()) return true;
+
+    for (const auto& [task, task_name] : ranges::views::zip(m_Tasks, m_CompiledGraph.task_names)) {
+        if (task->name != task_name) return true;
+    }
+    return m_TaskParameterSets != m_CompiledGraph.task_parameter_sets ||
+           m_CustomOrder != m_CompiledGraph.custom_order;
+}
+
+void Schedule::Compile(tf::Executor& executor) {
+    auto& taskflow = m_CompiledGraph.taskflow;
+    taskflow.clear();
+
     std::pmr::vector<tf::Task> tasks;
 
     // adjacency list
     std::pmr::unordered_map<std::size_t, std::pmr::unordered_set<std::size_t>> direct_graph;
-    for (auto i = 0; i < m_Tasks.size(); ++i)
+    for (std::size_t i = 0; i < m_Tasks.size(); ++i)
         direct_graph[i] = {};
 
-    for (const auto& task : m_Tasks) {
-        tasks.emplace_back(taskflow.emplace([&]() { task->Run(world); }).name(task->name.data()));
+    // the task objects are requested again when the systems change, so look them up by index when running
+    for (std::size_t index = 0; index < m_Tasks.size(); index++) {
+        tasks.emplace_back(taskflow.emplace([this, index, &executor]() { RunTask(index, executor); }).name(m_Tasks[index]->name.data()));
+    }
+
+    std::pmr::unordered_map<utils::TypeID, std::pmr::vector<std::size_t>> read_before_write_set;
+    std::pmr::unordered_map<utils::TypeID, std::pmr::vector<std::size_t>> write_set;
+    std::pmr::unordered_map<utils::TypeID, std::pmr::vector<std::size_t>> read_after_write_set;
+    for (std::size_t index = 0; index < m_TaskParameterSets.size(); index++) {
+        const auto& [read_before_write, write, read_after_write] = m_TaskParameterSets[index];
+        for (auto parameter : read_before_write) {
+            read_before_write_set[parameter].emplace_back(index);
+        }
+        for (auto parameter : write) {
+            write_set[parameter].emplace_back(index);
+        }
+        for (auto parameter : read_after_write) {
+            read_after_write_set[parameter].emplace_back(index);
+        }
     }
 
-    for (const auto& [component, task_indices] : m_ReadBeforeWriteSet) {
+    for (const auto& [component, task_indices] : read_before_write_set) {
         for (const auto task_index : task_indices) {
-            for (const auto write_task_index : m_WriteSet[component]) {
+            for (const auto write_task_index : write_set[component]) {
                 tasks[task_index].precede(tasks[write_task_index]);
                 direct_graph[task_index].emplace(write_task_index);
             }
         }
         for (const auto& task_index : task_indices) {
-            for (const auto read_after_write_task_index : m_ReadAfterWriteSet[component]) {
+            for (const auto read_after_write_task_index : read_after_write_set[component]) {
                 tasks[task_index].precede(tasks[read_after_write_task_index]);
                 direct_graph[task_index].emplace(read_after_write_task_index);
             }
         }
     }
 
-    for (const auto& [component, task_indices] : m_WriteSet) {
+    for (const auto& [component, task_indices] : write_set) {
         for (const auto [task_index, next_task_index] : ranges::views::zip(task_indices, task_indices | ranges::views::drop(1))) {
             tasks[task_index].precede(tasks[next_task_index]);
             direct_graph[task_index].emplace(next_task_index);
         }
 
         for (const auto task_index : task_indices) {
-            for (const auto read_after_write_task_index : m_ReadAfterWriteSet[component]) {
+            for (const auto read_after_write_task_index : read_after_write_set[component]) {
                 tasks[task_index].precede(tasks[read_after_write_task_index]);
                 direct_graph[task_index].emplace(read_after_write_task_index);
             }
@@ -93,11 +234,20 @@ void Schedule::Run(tf::Executor& executor) {
         direct_graph[first_task_index].emplace(second_task_index);
     }
 
-    if (!CheckValid(direct_graph)) {
-        return;
+    m_CompiledGraph.task_names.clear();
+    for (const auto& task : m_Tasks) {
+        m_CompiledGraph.task_names.emplace_back(task->name);
     }
+    m_CompiledGraph.task_parameter_sets = m_TaskParameterSets;
+    m_CompiledGraph.custom_order        = m_CustomOrder;
 
-    executor.run(taskflow).wait();
+    m_CompiledGraph.predecessors.assign(m_Tasks.size(), {});
+    for (const auto& [task_index, successor_task_indices] : direct_graph) {
+        for (const auto successor_task_index : successor_task_indices) {
+            m_CompiledGraph.predecessors[successor_task_index].emplace_back(task_index);
+        }
+    }
+    m_CompiledGraph.valid = CheckValid(direct_graph);
 }
 
 bool Schedule::CheckValid(const std::pmr::unordered_map<std::size_t, std::pmr::unordered_set<std::size_t>>& graph) {
@@ -129,6 +279,8 @@ bool Schedule::CheckValid(const std::pmr::unordered_map<std::size_t, std::pmr::u
         }
     }
 
+    m_CompiledGraph.topological_order = sorted_nodes;
+
     if (sorted_nodes.size() != graph.size()) {
         std::pmr::string dot;
 
@@ -0,0 +1,508 @@
+#include <hitagi/ecs/snapshot.hpp>
+#include <hitagi/ecs/entity_manager.hpp>
+#include <hitagi/ecs/world.hpp>
+#include <hitagi/utils/utils.hpp>
+
+#include <fmt/format.h>
+#include <range/v3/numeric/accumulate.hpp>
+#include <range/v3/view/map.hpp>
+#include <spdlog/logger.h>
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+namespace hitagi::ecs {
+
+void SnapshotWriter::Write(std::span<const std::byte> data) {
+    m_Data.insert(m_Data.end(), data.begin(), data.end());
+}
+
+void SnapshotWriter::Write(std::string_view str) {
+    Write<std::uint64_t>(str.size());
+    Write(std::span{reinterpret_cast<const std::byte*>(str.data()), str.size()});
+}
+
+void SnapshotWriter::Write(const Entity& entity) {
+    Write(entity.GetId());
+}
+
+auto SnapshotReader::Read(std::size_t size) -> std::span<const std::byte> {
+    if (size > m_Data.size()) {
+        throw std::out_of_range(fmt::format("Read {} bytes from snapshot, but only {} bytes left", size, m_Data.size()));
+    }
+    const auto result = m_Data.first(size);
+    m_Data            = m_Data.subspan(size);
+    return result;
+}
+
+auto SnapshotReader::ReadString() -> std::pmr::string {
+    const auto size = Read<std::uint64_t>();
+    const auto data = Read(size);
+    return {reinterpret_cast<const char*>(data.data()), data.size()};
+}
+
+auto SnapshotReader::ReadEntity() -> Entity {
+    const auto id = Read<entity_id_t>();
+    // null entity
+    if (id == Entity{}.GetId()) return {};
+    return Entity(&m_EntityManager, id);
+}
+
+Snapshot::Snapshot(std::span<const std::byte> data) : m_Data(data.begin(), data.end()) {}
+
+Snapshot::Snapshot(Snapshot&& other) noexcept
+    : m_Data(std::move(other.m_Data)),
+      m_ComponentCopies(std::move(other.m_ComponentCopies)),
+      m_NumEntities(std::exchange(other.m_NumEntities, 0)) {
+    other.m_ComponentCopies.clear();
+}
+
+Snapshot& Snapshot::operator=(Snapshot&& rhs) noexcept {
+    if (this != &rhs) {
+        DestroyComponentCopies();
+        m_Data            = std::move(rhs.m_Data);
+        m_ComponentCopies = std::move(rhs.m_ComponentCopies);
+        m_NumEntities     = std::exchange(rhs.m_NumEntities, 0);
+        rhs.m_ComponentCopies.clear();
+    }
+    return *this;
+}
+
+Snapshot::~Snapshot() {
+    DestroyComponentCopies();
+}
+
+void Snapshot::DestroyComponentCopies() noexcept {
+    for (auto& copy : m_ComponentCopies) {
+        if (copy.destructor == nullptr) continue;
+        for (std::size_t index = 0; index < copy.num_components; index++) {
+            copy.destructor(copy.data.GetData() + index * copy.size);
+        }
+    }
+    m_ComponentCopies.clear();
+}
+
+auto Snapshot::GetColumnType(const ComponentInfo& component_info) noexcept -> ColumnType {
+    if (component_info.serialize && component_info.deserialize) {
+        return ColumnType::Serialized;
+    }
+    // the same as relocation, components without copy constructor are copied bitwise
+    if (!component_info.copy_constructor || (component_info.trivially_relocatable && !component_info.destructor)) {
+        return ColumnType::Bitwise;
+    }
+    return ColumnType::Copied;
+}
+
+auto EntityManager::TakeSnapshot() const -> Snapshot {
+    Snapshot result;
+    TakeSnapshot(result);
+    return result;
+}
+
+void EntityManager::TakeSnapshot(Snapshot& result) const {
+    result.DestroyComponentCopies();
+    result.m_Data.clear();
+
+    std::size_t estimated_size = 0;
+    std::size_t num_archetypes = 0;
+    for (const auto& archetype : m_Archetypes | ranges::views::values) {
+        if (archetype->NumEntities() == 0) continue;
+        num_archetypes++;
+        for (const auto& component_info : archetype->GetComponentInfoSet()) {
+            estimated_size += archetype->NumEntities() * component_info.size;
+        }
+    }
+    result.m_Data.reserve(estimated_size + 1_kB);
+
+    SnapshotWriter writer(result.m_Data);
+    writer.Write(Snapshot::sm_Magic);
+    writer.Write(Snapshot::sm_Version);
+    writer.Write(m_Counter.load());
+    writer.Write<std::uint64_t>(num_archetypes);
+
+    // [(data, num_components)]
+    const auto write_column = [&](const ComponentInfo& component_info, const std::pmr::vector<std::pair<std::byte*, std::size_t>>& buffers) {
+        const auto size = component_info.size;
+
+        switch (Snapshot::GetColumnType(component_info)) {
+            case Snapshot::ColumnType::Bitwise: {
+                for (const auto& [data, num_components] : buffers) {
+                    writer.Write(std::span{data, num_components * size});
+                }
+            } break;
+            case Snapshot::ColumnType::Serialized: {
+                for (const auto& [data, num_components] : buffers) {
+                    for (std::size_t index = 0; index < num_components; index++) {
+                        component_info.serialize(data + index * size, writer);
+                    }
+                }
+            } break;
+            case Snapshot::ColumnType::Copied: {
+                const auto num_components = ranges::accumulate(buffers | ranges::views::values, std::size_t{0});
+
+                Snapshot::ComponentCopy copy{
+                    .destructor     = component_info.destructor,
+                    .size           = size,
+                    .num_components = 0,
+                    .data           = core::Buffer(num_components * size, nullptr, 64),
+                };
+                for (const auto& [data, num_components] : buffers) {
+                    for (std::size_t index = 0; index < num_components; index++) {
+                        component_info.copy_constructor(copy.data.GetData() + copy.num_components * size, data + index * size);
+                        copy.num_components++;
+                    }
+                }
+                writer.Write<std::uint64_t>(result.m_ComponentCopies.size());
+                result.m_ComponentCopies.emplace_back(std::move(copy));
+            } break;
+        }
+    };
+
+    const auto entity_component_id = utils::TypeID::Create<Entity>();
+
+    std::pmr::vector<entity_id_t> entity_ids;
+
+    for (const auto& archetype : m_Archetypes | ranges::views::values) {
+        if (archetype->NumEntities() == 0) continue;
+
+        // header, the entity component is not included
+        const auto& component_infos = archetype->GetComponentInfoSet();
+        writer.Write<std::uint64_t>(component_infos.size() - 1);
+        writer.Write<std::uint64_t>(archetype->NumEntities());
+        for (const auto& component_info : component_infos) {
+            if (component_info.type_id == entity_component_id) continue;
+            writer.Write(component_info.type_id.GetValue());
+            writer.Write(Snapshot::GetColumnType(component_info));
+        }
+
+        // shared values identify the archetype, so they are written before entities
+        for (const auto& component_info : component_infos) {
+            if (component_info.storage != ComponentStorage::Shared) continue;
+            write_column(component_info, {{archetype->GetComponentBuffers(component_info.type_id).front().first, 1}});
+        }
+
+        // entity ids, gathered chunk by chunk
+        for (const auto& [data, num_entities] : archetype->GetComponentBuffers(entity_component_id)) {
+            entity_ids.resize(num_entities);
+            std::transform(reinterpret_cast<const Entity*>(data), reinterpret_cast<const Entity*>(data) + num_entities,
+                           entity_ids.begin(), [](const Entity& entity) { return entity.GetId(); });
+            writer.Write(std::as_bytes(std::span{entity_ids}));
+        }
+
+        for (const auto& component_info : component_infos) {
+            if (component_info.type_id == entity_component_id) continue;
+
+            auto buffers = archetype->GetComponentBuffers(component_info.type_id);
+            switch (component_info.storage) {
+                case ComponentStorage::Entity: {
+                    write_column(component_info, buffers);
+                } break;
+                case ComponentStorage::Chunk: {
+                    writer.Write<std::uint64_t>(buffers.size());
+                    for (auto& buffer : buffers) buffer.second = 1;
+                    write_column(component_info, buffers);
+                } break;
+                case ComponentStorage::Shared:
+                case ComponentStorage::Sparse:
+                    break;
+            }
+        }
+    }
+
+    const auto num_sparse_sets = std::count_if(m_SparseSets.begin(), m_SparseSets.end(), [](const auto& item) { return item.second->NumComponents() != 0; });
+    writer.Write<std::uint64_t>(num_sparse_sets);
+    for (const auto& sparse_set : m_SparseSets | ranges::views::values) {
+        if (sparse_set->NumComponents() == 0) continue;
+
+        const auto& component_info = sparse_set->GetComponentInfo();
+        writer.Write(component_info.type_id.GetValue());
+        writer.Write(Snapshot::GetColumnType(component_info));
+        writer.Write<std::uint64_t>(sparse_set->NumComponents());
+        writer.Write(std::as_bytes(sparse_set->GetEntities()));
+        write_column(component_info, {sparse_set->GetComponentBuffer()});
+    }
+
+    result.m_NumEntities = NumEntities();
+}
+
+void EntityManager::Restore(const Snapshot& snapshot) {
+    // throws `std::out_of_range` if `num_elements * size` bytes are more than the size of snapshot
+    const auto check_size = [&](std::uint64_t num_elements, std::size_t size) {
+        if (size != 0 && num_elements > snapshot.m_Data.size() / size) {
+            throw std::out_of_range(fmt::format("{} elements of {} bytes are out of the snapshot", num_elements, size));
+        }
+    };
+
+    const auto check_component = [&](utils::TypeID component_id) -> const ComponentInfo& {
+        if (!m_ComponentMap.contains(component_id)) {
+            throw std::out_of_range(fmt::format("The component({}) in snapshot is not registered", component_id.GetValue()));
+        }
+        return GetComponentInfo(component_id);
+    };
+
+    // Walk through the column without constructing any component, the serialized components are
+    // deserialized to a temporary value, since their size is unknown until they are read.
+    const auto check_column = [&](SnapshotReader& reader, const ComponentInfo& component_info, Snapshot::ColumnType column_type, std::uint64_t num_components) {
+        switch (column_type) {
+            case Snapshot::ColumnType::Bitwise: {
+                check_size(num_components, component_info.size);
+                reader.Read(num_components * component_info.size);
+            } break;
+            case Snapshot::ColumnType::Serialized: {
+                if (!component_info.deserialize) {
+                    throw std::invalid_argument(fmt::format("The component({}) can not be deserialized", component_info.name));
+                }
+                core::Buffer value(component_info.size, nullptr, alignof(std::max_align_t));
+                for (std::size_t index = 0; index < num_components; index++) {
+                    component_info.deserialize(value.GetData(), reader);
+                    if (component_info.destructor) component_info.destructor(value.GetData());
+                }
+            } break;
+            case Snapshot::ColumnType::Copied: {
+                const auto copy_index = reader.Read<std::uint64_t>();
+                if (copy_index >= snapshot.m_ComponentCopies.size() || !component_info.copy_constructor ||
+                    snapshot.m_ComponentCopies[copy_index].size != component_info.size ||
+                    snapshot.m_ComponentCopies[copy_index].num_components < num_components) {
+                    throw std::invalid_argument(fmt::format("The copy({}) of component({}) does not match the snapshot", copy_index, component_info.name));
+                }
+            } break;
+            default:
+                throw std::invalid_argument(fmt::format("Unknown column type({}) of component({})", static_cast<int>(column_type), component_info.name));
+        }
+    };
+
+    // construct the components at [(data, num_components)], the column has been checked
+    const auto read_column = [&](SnapshotReader& reader, const ComponentInfo& component_info, Snapshot::ColumnType column_type, const std::pmr::vector<std::pair<std::byte*, std::size_t>>& buffers) {
+        const auto size = component_info.size;
+
+        switch (column_type) {
+            case Snapshot::ColumnType::Bitwise: {
+                for (const auto& [data, num_components] : buffers) {
+                    std::memcpy(data, reader.Read(num_components * size).data(), num_components * size);
+                }
+            } break;
+            case Snapshot::ColumnType::Serialized: {
+                for (const auto& [data, num_components] : buffers) {
+                    for (std::size_t index = 0; index < num_components; index++) {
+                        component_info.deserialize(data + index * size, reader);
+                    }
+                }
+            } break;
+            case Snapshot::ColumnType::Copied: {
+                const auto& copy = snapshot.m_ComponentCopies[reader.Read<std::uint64_t>()];
+
+                std::size_t copy_index = 0;
+                for (const auto& [data, num_components] : buffers) {
+                    for (std::size_t index = 0; index < num_components; index++) {
+                        component_info.copy_constructor(data + index * size, copy.data.GetData() + copy_index * size);
+                        copy_index++;
+                    }
+                }
+            } break;
+        }
+    };
+
+    std::pmr::vector<std::pair<utils::TypeID, Snapshot::ColumnType>> columns;
+    // the number of chunks of each archetype, which is checked against the chunk config before the entities are allocated
+    std::pmr::vector<std::optional<std::uint64_t>> archetype_num_chunks;
+
+    // 1. check the whole snapshot, nothing is changed if it is broken
+    try {
+        SnapshotReader reader(snapshot.m_Data, *this);
+
+        if (reader.Read<std::uint32_t>() != Snapshot::sm_Magic) {
+            throw std::invalid_argument("The data is not a snapshot of entity manager");
+        }
+        if (const auto version = reader.Read<std::uint32_t>(); version != Snapshot::sm_Version) {
+            throw std::invalid_argument(fmt::format("Unsupported snapshot version {}", version));
+        }
+        reader.Read<entity_id_t>();
+        const auto num_archetypes = reader.Read<std::uint64_t>();
+        check_size(num_archetypes, 2 * sizeof(std::uint64_t));
+
+        for (std::size_t archetype_index = 0; archetype_index < num_archetypes; archetype_index++) {
+            const auto num_components = reader.Read<std::uint64_t>();
+            const auto num_entities   = reader.Read<std::uint64_t>();
+            check_size(num_components, sizeof(std::size_t) + sizeof(Snapshot::ColumnType));
+
+            columns.clear();
+            for (std::size_t index = 0; index < num_components; index++) {
+                const auto component_id = utils::TypeID(reader.Read<std::size_t>());
+                columns.emplace_back(component_id, reader.Read<Snapshot::ColumnType>());
+                check_component(component_id);
+            }
+
+            for (const auto& [component_id, column_type] : columns) {
+                if (const auto& component_info = GetComponentInfo(component_id); component_info.storage == ComponentStorage::Shared) {
+                    check_column(reader, component_info, column_type, 1);
+                }
+            }
+
+            check_size(num_entities, sizeof(entity_id_t));
+            reader.Read(num_entities * sizeof(entity_id_t));
+
+            auto& num_chunks = archetype_num_chunks.emplace_back();
+            for (const auto& [component_id, column_type] : columns) {
+                const auto& component_info = GetComponentInfo(component_id);
+                switch (component_info.storage) {
+                    case ComponentStorage::Entity: {
+                        check_column(reader, component_info, column_type, num_entities);
+                    } break;
+                    case ComponentStorage::Chunk: {
+                        num_chunks = reader.Read<std::uint64_t>();
+                        check_column(reader, component_info, column_type, *num_chunks);
+                    } break;
+                    case ComponentStorage::Shared:
+                    case ComponentStorage::Sparse:
+                        break;
+                }
+            }
+        }
+
+        const auto num_sparse_sets = reader.Read<std::uint64_t>();
+        for (std::size_t sparse_set_index = 0; sparse_set_index < num_sparse_sets; sparse_set_index++) {
+            const auto component_id   = utils::TypeID(reader.Read<std::size_t>());
+            const auto column_type    = reader.Read<Snapshot::ColumnType>();
+            const auto num_components = reader.Read<std::uint64_t>();
+
+            const auto& component_info = check_component(component_id);
+            if (component_info.storage != ComponentStorage::Sparse) {
+                throw std::invalid_argument(fmt::format("The component({}) is not a sparse component", component_info.name));
+            }
+            check_size(num_components, sizeof(entity_id_t));
+            reader.Read(num_components * sizeof(entity_id_t));
+            check_column(reader, component_info, column_type, num_components);
+        }
+    } catch (const std::exception& error) {
+        m_World.GetLogger()->error("Failed to restore the snapshot: {}", error.what());
+        throw;
+    }
+
+    // 2. build the entities, the current ones are kept until the snapshot is restored
+    auto entity_maps      = std::exchange(m_EntityMaps, EntityMap<Archetype*>(nullptr));
+    auto archetypes       = std::exchange(m_Archetypes, {});
+    auto empty_archetypes = std::exchange(m_EmptyArchetypes, {});
+    auto sparse_sets      = std::exchange(m_SparseSets, {});
+    auto sparse_signature = std::exchange(m_SparseSignature, {});
+
+    try {
+        SnapshotReader reader(snapshot.m_Data, *this);
+        reader.Read<std::uint32_t>();
+        reader.Read<std::uint32_t>();
+        const auto counter        = reader.Read<entity_id_t>();
+        const auto num_archetypes = reader.Read<std::uint64_t>();
+
+        std::pmr::vector<entity_id_t> entities;
+
+        for (std::size_t archetype_index = 0; archetype_index < num_archetypes; archetype_index++) {
+            const auto num_components = reader.Read<std::uint64_t>();
+            const auto num_entities   = reader.Read<std::uint64_t>();
+
+            columns.clear();
+            auto component_infos = detail::create_component_info_set<Entity>();
+            for (std::size_t index = 0; index < num_components; index++) {
+                const auto component_id = utils::TypeID(reader.Read<std::size_t>());
+                columns.emplace_back(component_id, reader.Read<Snapshot::ColumnType>());
+                component_infos.emplace(GetComponentInfo(component_id));
+            }
+
+            // the shared values are copied by the archetype
+            detail::SharedComponentValues  shared_values;
+            std::pmr::vector<core::Buffer> shared_value_buffers;
+            for (const auto& [component_id, column_type] : columns) {
+                const auto& component_info = GetComponentInfo(component_id);
+                if (component_info.storage != ComponentStorage::Shared) continue;
+
+                auto& value = shared_value_buffers.emplace_back(component_info.size, nullptr, alignof(std::max_align_t));
+                read_column(reader, component_info, column_type, {{value.GetData(), 1}});
+                shared_values.emplace(component_id, value.GetData());
+            }
+
+            auto& archetype = GetOrCreateArchetype(component_infos, shared_values);
+
+            for (const auto& [component_id, value] : shared_values) {
+                if (const auto& component_info = GetComponentInfo(component_id); component_info.destructor) {
+                    component_info.destructor(const_cast<std::byte*>(value));
+                }
+            }
+
+            // nothing is allocated in the archetype yet, so it is safe to throw here
+            if (archetype.NumEntities() != 0) {
+                throw std::invalid_argument("An archetype appears twice in the snapshot");
+            }
+            // entities are allocated in the same order, so the chunks match when the chunk config is the same
+            if (const auto num_chunks = archetype_num_chunks[archetype_index];
+                num_chunks && *num_chunks != (num_entities + archetype.NumEntitiesPerChunk() - 1) / archetype.NumEntitiesPerChunk()) {
+                throw std::invalid_argument("The chunks of archetype do not match the snapshot");
+            }
+
+            entities.resize(num_entities);
+            std::memcpy(entities.data(), reader.Read(num_entities * sizeof(entity_id_t)).data(), num_entities * sizeof(entity_id_t));
+
+            for (const auto entity : entities) {
+                if (!m_EntityMaps.emplace(entity, &archetype)) {
+                    throw std::invalid_argument(fmt::format("The entity({}) appears twice in the snapshot", entity));
+                }
+            }
+            archetype.AllocateFor(entities);
+
+            for (auto entity_iter = entities.begin(); const auto& [data, num_components] : archetype.GetComponentBuffers(utils::TypeID::Create<Entity>())) {
+                for (std::size_t index = 0; index < num_components; index++) {
+                    std::construct_at(reinterpret_cast<Entity*>(data) + index, Entity(this, *entity_iter++));
+                }
+            }
+
+            for (const auto& [component_id, column_type] : columns) {
+                const auto& component_info = GetComponentInfo(component_id);
+
+                auto buffers = archetype.GetComponentBuffers(component_id);
+                switch (component_info.storage) {
+                    case ComponentStorage::Entity: {
+                        read_column(reader, component_info, column_type, buffers);
+                    } break;
+                    case ComponentStorage::Chunk: {
+                        reader.Read<std::uint64_t>();
+                        for (auto& buffer : buffers) {
+                            if (component_info.destructor) component_info.destructor(buffer.first);
+                            buffer.second = 1;
+                        }
+                        read_column(reader, component_info, column_type, buffers);
+                    } break;
+                    case ComponentStorage::Shared:
+                    case ComponentStorage::Sparse:
+                        break;
+                }
+            }
+        }
+
+        const auto num_sparse_sets = reader.Read<std::uint64_t>();
+        for (std::size_t sparse_set_index = 0; sparse_set_index < num_sparse_sets; sparse_set_index++) {
+            const auto component_id = utils::TypeID(reader.Read<std::size_t>());
+            const auto column_type  = reader.Read<Snapshot::ColumnType>();
+            entities.resize(reader.Read<std::uint64_t>());
+            std::memcpy(entities.data(), reader.Read(entities.size() * sizeof(entity_id_t)).data(), entities.size() * sizeof(entity_id_t));
+
+            // the set is empty, so the allocated components are contiguous
+            auto& sparse_set = GetOrCreateSparseSet(GetComponentInfo(component_id));
+            for (const auto entity : entities) {
+                sparse_set.Allocate(entity);
+            }
+            read_column(reader, sparse_set.GetComponentInfo(), column_type, {sparse_set.GetComponentBuffer()});
+        }
+
+        // the ids created after the snapshot are not reused
+        m_Counter = std::max(m_Counter.load(), counter);
+    } catch (const std::exception& error) {
+        // the archetype being built has no entity allocated, so the restored part is destroyed safely
+        m_SparseSets      = std::move(sparse_sets);
+        m_Archetypes      = std::move(archetypes);
+        m_EntityMaps      = std::move(entity_maps);
+        m_EmptyArchetypes = std::move(empty_archetypes);
+        m_SparseSignature = sparse_signature;
+        m_World.GetLogger()->error("Failed to restore the snapshot: {}", error.what());
+        throw;
+    }
+}
+
+}  // namespace hitagi::ecs
@@ -0,0 +1,124 @@
+#include <hitagi/ecs/sparse_set.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace hitagi::ecs {
+
+inline void relocate(const ComponentInfo& component_info, std::byte* dest, std::byte* src) noexcept {
+    if (component_info.trivially_relocatable || !component_info.move_constructor) {
+        std::memcpy(dest, src, component_info.size);
+    } else {
+        component_info.move_constructor(dest, src);
+        if (component_info.destructor) component_info.destructor(src);
+    }
+}
+
+SparseSet::SparseSet(ComponentInfo component_info) : m_ComponentInfo(std::move(component_info)) {}
+
+SparseSet::~SparseSet() {
+    Clear();
+}
+
+bool SparseSet::Contains(entity_id_t entity) const noexcept {
+    return GetIndex(entity) != sm_InvalidIndex;
+}
+
+auto SparseSet::Get(entity_id_t entity) const noexcept -> std::byte* {
+    const auto index = GetIndex(entity);
+    return index == sm_InvalidIndex ? nullptr : GetData(index);
+}
+
+auto SparseSet::Allocate(entity_id_t entity) -> std::byte* {
+    if (const auto index = GetIndex(entity); index != sm_InvalidIndex) {
+        return GetData(index);
+    }
+
+    const auto page_index = entity / sm_PageSize;
+    if (page_index >= m_Pages.size()) {
+        m_Pages.resize(page_index + 1);
+    }
+    auto& page = m_Pages[page_index];
+    if (page.indices.empty()) {
+        page.indices.resize(sm_PageSize, sm_InvalidIndex);
+    }
+
+    if (m_Entities.size() == m_Capacity) Grow();
+
+    page.indices[entity % sm_PageSize] = static_cast<std::uint32_t>(m_Entities.size());
+    page.num_entities++;
+    m_Entities.emplace_back(entity);
+    return GetData(m_Entities.size() - 1);
+}
+
+void SparseSet::Remove(entity_id_t entity) noexcept {
+    const auto index = GetIndex(entity);
+    if (index == sm_InvalidIndex) return;
+
+    if (m_ComponentInfo.destructor) {
+        m_ComponentInfo.destructor(GetData(index));
+    }
+
+    const auto last_index = m_Entities.size() - 1;
+    if (index != last_index) {
+        const auto last_entity = m_Entities[last_index];
+        relocate(m_ComponentInfo, GetData(index), GetData(last_index));
+        m_Entities[index]                                                      = last_entity;
+        m_Pages[last_entity / sm_PageSize].indices[last_entity % sm_PageSize] = index;
+    }
+    m_Entities.pop_back();
+
+    auto& page                         = m_Pages[entity / sm_PageSize];
+    page.indices[entity % sm_PageSize] = sm_InvalidIndex;
+    if (--page.num_entities == 0) {
+        page.indices = {};
+    }
+}
+
+void SparseSet::Clear() noexcept {
+    if (m_ComponentInfo.destructor) {
+        for (std::size_t index = 0; index < m_Entities.size(); index++) {
+            m_ComponentInfo.destructor(GetData(index));
+        }
+    }
+    m_Entities.clear();
+    m_Pages.clear();
+}
+
+auto SparseSet::GetIndex(entity_id_t entity) const noexcept -> std::uint32_t {
+    const auto page_index = entity / sm_PageSize;
+    if (page_index >= m_Pages.size() || m_Pages[page_index].indices.empty()) {
+        return sm_InvalidIndex;
+    }
+    return m_Pages[page_index].indices[entity % sm_PageSize];
+}
+
+auto SparseSet::GetData(std::size_t index) const noexcept -> std::byte* {
+    return const_cast<std::byte*>(m_Data.GetData()) + index * m_ComponentInfo.size;
+}
+
+auto SparseSet::GetMemoryReport() const noexcept -> ComponentMemoryReport {
+    const auto num_pages = std::count_if(m_Pages.begin(), m_Pages.end(), [](const auto& page) { return !page.indices.empty(); });
+    return {
+        .name           = m_ComponentInfo.name,
+        .storage        = m_ComponentInfo.storage,
+        .component_size = m_ComponentInfo.size,
+        .reserved_bytes = m_Capacity * m_ComponentInfo.size +
+                          num_pages * sm_PageSize * sizeof(std::uint32_t) +
+                          m_Entities.capacity() * sizeof(entity_id_t),
+        .used_bytes     = m_Entities.size() * m_ComponentInfo.size,
+    };
+}
+
+void SparseSet::Grow() {
+    const auto new_capacity = std::max<std::size_t>(m_Capacity * 2, sm_AlignSize);
+
+    core::Buffer new_data(new_capacity * m_ComponentInfo.size, nullptr, sm_AlignSize);
+    for (std::size_t index = 0; index < m_Entities.size(); index++) {
+        relocate(m_ComponentInfo, new_data.GetData() + index * m_ComponentInfo.size, GetData(index));
+    }
+    m_Data     = std::move(new_data);
+    m_Capacity = new_capacity;
+}
+
+}  // namespace hitagi::ecs
@@ -1,8 +1,25 @@
 #include <hitagi/ecs/system_manager.hpp>
 #include <hitagi/ecs/schedule.hpp>
 
+#include <tracy/Tracy.hpp>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
 namespace hitagi::ecs {
 
+namespace detail {
+auto demangle(const char* name) -> std::pmr::string {
+#if defined(__GNUG__)
+    int  status    = 0;
+    auto demangled = std::unique_ptr<char, decltype(&std::free)>(abi::__cxa_demangle(name, nullptr, nullptr, &status), &std::free);
+    if (status == 0 && demangled) return demangled.get();
+#endif
+    return name;
+}
+}  // namespace detail
+
 SystemManager::~SystemManager() {
     const auto enabled_systems = m_EnabledSystems;
     for (auto&& id : enabled_systems) {
@@ -15,10 +32,37 @@ SystemManager::~SystemManager() {
     }
 }
 
-void SystemManager::Update(Schedule& schedule) {
+void SystemManager::Update(Schedule& schedule, FrameStats& frame_stats) {
+    ZoneScopedN("SystemManager::Update");
+
+    // the requested tasks are kept and run again every frame until the set of systems changes
+    if (m_Dirty) {
+        schedule.Reset();
+        for (auto&& id : m_EnabledSystems) {
+            schedule.m_RequestingSystem = id;
+            UpdateOne(id, schedule);
+            schedule.m_RequestingSystem.reset();
+        }
+        m_Dirty = false;
+    }
+
+    frame_stats.skipped_systems.clear();
     for (auto&& id : m_EnabledSystems) {
-        UpdateOne(id, schedule);
+        bool skipped = false;
+        if (const auto iter = m_UpdateIntervals.find(id); iter != m_UpdateIntervals.end()) {
+            auto& interval = iter->second;
+            skipped        = interval.frames_to_update != 0;
+            if (skipped) {
+                interval.frames_to_update--;
+                frame_stats.skipped_systems.emplace_back(m_SystemNames.at(id));
+            } else {
+                interval.frames_to_update = interval.num_frames - 1;
+            }
+        }
+        // the tasks of a skipped system are kept in the graph, so it is not compiled again
+        schedule.SetSystemEnabled(id, !skipped);
     }
+    ZoneValue(frame_stats.skipped_systems.size());
 }
 
 void SystemManager::EnableOne(utils::TypeID id) {
@@ -27,6 +71,7 @@ void SystemManager::EnableOne(utils::TypeID id) {
 
     m_DisabledSystems.erase(id);
     m_EnabledSystems.emplace(id);
+    m_Dirty = true;
 
     if (m_OnEnableFns.contains(id))
         m_OnEnableFns.at(id)(m_World);
@@ -45,6 +90,7 @@ void SystemManager::DisableOne(utils::TypeID id) {
 
     m_EnabledSystems.erase(id);
     m_DisabledSystems.emplace(id);
+    m_Dirty = true;
 
     if (m_OnDisableFns.contains(id))
         m_OnDisableFns.at(id)(m_World);
@@ -62,6 +108,16 @@ void SystemManager::UnRegisterOne(utils::TypeID id) {
     m_OnUpdateFns.erase(id);
     m_OnDisableFns.erase(id);
     m_OnDestroyFns.erase(id);
+    m_SystemNames.erase(id);
+    m_UpdateIntervals.erase(id);
+}
+
+void SystemManager::SetUpdateIntervalOne(utils::TypeID id, std::size_t num_frames) {
+    if (num_frames <= 1) {
+        m_UpdateIntervals.erase(id);
+    } else {
+        m_UpdateIntervals.insert_or_assign(id, UpdateInterval{.num_frames = num_frames});
+    }
 }
 
 }  // namespace hitagi::ecs
\ No newline at end of file
@@ -4,19 +4,53 @@
 
 #include <range/v3/view/map.hpp>
 #include <spdlog/spdlog.h>
+#include <tracy/Tracy.hpp>
 
 namespace hitagi::ecs {
-World::World(std::string_view name)
+World::World(std::string_view name, ChunkConfig chunk_config, std::size_t num_workers)
+    : World(name, chunk_config, std::make_unique<tf::Executor>(std::max<std::size_t>(num_workers, 1)), nullptr) {}
+
+World::World(std::string_view name, tf::Executor& executor, ChunkConfig chunk_config)
+    : World(name, chunk_config, nullptr, &executor) {}
+
+World::World(std::string_view name, ChunkConfig chunk_config, std::unique_ptr<tf::Executor> owned_executor, tf::Executor* executor)
     : m_Name(name),
       m_Logger(utils::try_create_logger(name)),
-      m_EntityManager(*this),
-      m_SystemManager(*this) {
+      m_EntityManager(*this, chunk_config),
+      m_SystemManager(*this),
+      m_OwnedExecutor(std::move(owned_executor)),
+      m_Executor(executor ? executor : m_OwnedExecutor.get()) {
+    for (std::size_t i = 0; i < m_Executor->num_workers(); i++) {
+        m_CommandBuffers.emplace_back(std::make_unique<CommandBuffer>(m_EntityManager));
+    }
+    // shared by all threads outside the executor
+    m_CommandBuffers.emplace_back(std::make_unique<CommandBuffer>(m_EntityManager, true));
+    m_Schedule = std::make_unique<Schedule>(*this);
 }
 
+World::~World() = default;  // forward declaration of unique_ptr<Schedule>
+
 void World::Update() {
-    Schedule schedule(*this);
-    m_SystemManager.Update(schedule);
-    schedule.Run(m_Executor);
+    ZoneScopedN("World::Update");
+    const auto update_start = std::chrono::steady_clock::now();
+
+    m_SystemManager.Update(*m_Schedule, m_LastFrameStats);
+    m_EntityManager.UpdateLastFrameComponents();
+    m_Schedule->Run(*m_Executor, m_LastFrameStats);
+
+    // sync point
+    const auto playback_start = std::chrono::steady_clock::now();
+    m_EntityManager.Playback(m_CommandBuffers);
+    m_EntityManager.CollectEmptyArchetypes();
+
+    const auto update_end          = std::chrono::steady_clock::now();
+    m_LastFrameStats.playback_time = update_end - playback_start;
+    m_LastFrameStats.update_time   = update_end - update_start;
+}
+
+auto World::GetCommandBuffer() noexcept -> CommandBuffer& {
+    const auto worker_id = m_Executor->this_worker_id();
+    return worker_id < 0 ? *m_CommandBuffers.back() : *m_CommandBuffers[worker_id];
 }
 
 }  // namespace hitagi::ecs
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <hitagi/ecs/world_group.hpp>
+
+#include <fmt/format.h>
+#include <tracy/Tracy.hpp>
+
+#include <algorithm>
+
+namespace hitagi::ecs {
+
+WorldGroup::WorldGroup(std::size_t num_workers) : m_Executor(std::max<std::size_t>(num_workers, 1)) {}
+
+WorldGroup::~WorldGroup() = default;
+
+auto WorldGroup::CreateWorld(std::string_view name, WorldConfig config, ChunkConfig chunk_config) -> World& {
+    if (std::any_of(m_Worlds.begin(), m_Worlds.end(), [&](const auto& member) { return member->world->GetName() == name; })) {
+        throw std::invalid_argument(fmt::format("The world({}) already exists in the group", name));
+    }
+
+    auto member = std::make_unique<Member>(Member{
+        .world  = std::make_unique<World>(name, m_Executor, chunk_config),
+        .config = config,
+    });
+    auto& world = *member->world;
+    Insert(std::move(member));
+    return world;
+}
+
+void WorldGroup::DestroyWorld(std::string_view name) {
+    auto& member = GetMember(name);
+    std::erase_if(m_Worlds, [&](const auto& item) { return item.get() == &member; });
+}
+
+auto WorldGroup::GetWorld(std::string_view name) -> World& {
+    return *GetMember(name).world;
+}
+
+auto WorldGroup::GetWorld(std::string_view name) const -> const World& {
+    return *GetMember(name).world;
+}
+
+void WorldGroup::SetWorldConfig(std::string_view name, WorldConfig config) {
+    auto& member = GetMember(name);
+    auto  iter   = std::find_if(m_Worlds.begin(), m_Worlds.end(), [&](const auto& item) { return item.get() == &member; });
+
+    auto item = std::move(*iter);
+    m_Worlds.erase(iter);
+    item->config        = config;
+    item->budget_credit = {};
+    Insert(std::move(item));
+}
+
+void WorldGroup::AddSyncCallback(std::function<void(const WorldGroup&)> callback) {
+    m_SyncCallbacks.emplace_back(std::move(callback));
+}
+
+void WorldGroup::Update() {
+    ZoneScopedN("WorldGroup::Update");
+    const auto update_start = std::chrono::steady_clock::now();
+
+    m_LastFrameStats.worlds.clear();
+
+    // a world is updated when it has budget left, the unused budget is not saved for later frames
+    std::pmr::vector<Member*> updated_members;
+    for (const auto& member : m_Worlds) {
+        auto& stats = m_LastFrameStats.worlds.emplace_back(WorldGroupStats::WorldStats{
+            .name     = std::pmr::string(member->world->GetName()),
+            .priority = member->config.priority,
+        });
+
+        if (const auto budget = member->config.frame_budget; budget) {
+            member->budget_credit = std::min(member->budget_credit + *budget, *budget);
+            if (member->budget_credit <= std::chrono::nanoseconds::zero()) {
+                stats.budget_credit = member->budget_credit;
+                continue;
+            }
+        }
+        stats.updated = true;
+        updated_members.emplace_back(member.get());
+    }
+
+    // tasks are emplaced in the order of priority, so the workers pick up the worlds with higher priority first
+    tf::Taskflow taskflow;
+    for (const auto member : updated_members) {
+        taskflow.emplace([member]() { member->world->Update(); }).name(member->world->GetName().data());
+    }
+    m_Executor.run(taskflow).wait();
+
+    for (std::size_t index = 0; const auto& member : m_Worlds) {
+        auto& stats = m_LastFrameStats.worlds[index++];
+        if (!stats.updated) continue;
+
+        stats.update_time = member->world->GetLastFrameStats().update_time;
+        if (member->config.frame_budget) {
+            member->budget_credit -= stats.update_time;
+        }
+        stats.budget_credit = member->budget_credit;
+    }
+
+    // sync point
+    const auto sync_start = std::chrono::steady_clock::now();
+    for (const auto& callback : m_SyncCallbacks) {
+        callback(*this);
+    }
+
+    const auto update_end        = std::chrono::steady_clock::now();
+    m_LastFrameStats.sync_time   = update_end - sync_start;
+    m_LastFrameStats.update_time = update_end - update_start;
+}
+
+void WorldGroup::Insert(std::unique_ptr<Member> member) {
+    // the worlds with the same priority keep the order of insertion
+    const auto iter = std::upper_bound(m_Worlds.begin(), m_Worlds.end(), member->config.priority, [](int priority, const auto& item) {
+        return priority > item->config.priority;
+    });
+    m_Worlds.emplace(iter, std::move(member));
+}
+
+auto WorldGroup::GetMember(std::string_view name) const -> Member& {
+    const auto iter = std::find_if(m_Worlds.begin(), m_Worlds.end(), [&](const auto& member) { return member->world->GetName() == name; });
+    if (iter == m_Worlds.end()) {
+        throw std::out_of_range(fmt::format("The world({}) is not in the group", name));
+    }
+    return **iter;
+}
+
+}  // namespace hitagi::ecs
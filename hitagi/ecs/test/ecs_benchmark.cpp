@@ -1,9 +1,14 @@
 #include <hitagi/ecs/world.hpp>
 #include <hitagi/ecs/schedule.hpp>
+#include <hitagi/ecs/prefab.hpp>
+#include <hitagi/ecs/query.hpp>
+#include <hitagi/ecs/snapshot.hpp>
 #include <hitagi/core/timer.hpp>
 #include <hitagi/math/transform.hpp>
 #include <hitagi/utils/test.hpp>
 
+#include <random>
+
 using namespace hitagi;
 
 static void ECS_Update(benchmark::State& state) {
@@ -47,4 +52,612 @@ static void ECS_Update(benchmark::State& state) {
 }
 BENCHMARK(ECS_Update);
 
+struct LargeTransform {
+    math::vec3f position;
+    math::quatf rotation;
+    math::vec3f scaling;
+    math::mat4f local_matrix;
+    math::mat4f world_matrix;
+};
+
+static void iterate_large_transform(benchmark::State& state, ecs::ChunkConfig chunk_config) {
+    ecs::World world(fmt::format("ECS_Iterate-{}", state.thread_index()), chunk_config);
+
+    struct TransformSystem {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule.Request("UpdateMatrix", [](LargeTransform& transform) {
+                transform.local_matrix = math::translate(transform.position) * math::rotate(transform.rotation) * math::scale(transform.scaling);
+                transform.world_matrix = transform.local_matrix;
+            });
+        }
+    };
+    world.GetSystemManager().Register<TransformSystem>();
+
+    constexpr std::size_t num_entities = 100'000;
+    std::ignore = world.GetEntityManager().CreateMany<LargeTransform>(num_entities);
+
+    for (auto _ : state) {
+        world.Update();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+
+static void ECS_IterateWithChunkSize(benchmark::State& state) {
+    iterate_large_transform(state, {.chunk_size = static_cast<std::size_t>(state.range(0))});
+}
+BENCHMARK(ECS_IterateWithChunkSize)->RangeMultiplier(2)->Range(2_kB, 64_kB);
+
+static void ECS_IterateWithAdaptiveChunkSize(benchmark::State& state) {
+    iterate_large_transform(state, {.chunk_size = 2_kB, .min_entities_per_chunk = static_cast<std::size_t>(state.range(0))});
+}
+BENCHMARK(ECS_IterateWithAdaptiveChunkSize)->RangeMultiplier(4)->Range(16, 1024);
+
+struct Position {
+    math::vec3f value;
+};
+struct Velocity {
+    math::vec3f value;
+};
+
+struct DoubleBufferedPosition {
+    constexpr static bool double_buffered = true;
+
+    math::vec3f value;
+};
+struct MotionVector {
+    math::vec3f value;
+};
+
+// a writer and a reader of last frame value, they run one after another unless the component is double-buffered
+template <typename T>
+static void ECS_ReadLastFrame(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_ReadLastFrame-{}", state.thread_index()), {}, 2);
+
+    struct System {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule
+                .Request(
+                    "Move",
+                    [](T& position, const Velocity& velocity) {
+                        position.value = position.value + velocity.value * std::sqrt(velocity.value.x + 1.0f);
+                    })
+                .Request(
+                    "MotionVector",
+                    [](ecs::LastFrame<const T&> last_position, MotionVector& motion) {
+                        motion.value = motion.value * 0.5f + last_position.value.value * std::sqrt(motion.value.y + 1.0f);
+                    });
+        }
+    };
+    world.GetSystemManager().Register<System>();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    std::ignore = world.GetEntityManager().CreateMany<T, Velocity, MotionVector>(num_entities);
+
+    for (auto _ : state) {
+        world.Update();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities * 2);
+}
+BENCHMARK_TEMPLATE(ECS_ReadLastFrame, Position)->Arg(100'000)->UseRealTime();
+BENCHMARK_TEMPLATE(ECS_ReadLastFrame, DoubleBufferedPosition)->Arg(100'000)->UseRealTime();
+
+static void ECS_IteratePerEntity(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_IteratePerEntity-{}", state.thread_index()));
+
+    struct MoveSystem {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule.Request("Move", [](Position& position, const Velocity& velocity) {
+                position.value += velocity.value * 0.01f;
+            });
+        }
+    };
+    world.GetSystemManager().Register<MoveSystem>();
+
+    constexpr std::size_t num_entities = 1'000'000;
+    std::ignore = world.GetEntityManager().CreateMany<Position, Velocity>(num_entities);
+
+    for (auto _ : state) {
+        world.Update();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_IteratePerEntity);
+
+static void ECS_IteratePerChunk(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_IteratePerChunk-{}", state.thread_index()));
+
+    struct MoveSystem {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule.Request("Move", [](std::span<Position> positions, std::span<const Velocity> velocities) {
+                for (std::size_t index = 0; index < positions.size(); index++) {
+                    positions[index].value += velocities[index].value * 0.01f;
+                }
+            });
+        }
+    };
+    world.GetSystemManager().Register<MoveSystem>();
+
+    constexpr std::size_t num_entities = 1'000'000;
+    std::ignore = world.GetEntityManager().CreateMany<Position, Velocity>(num_entities);
+
+    for (auto _ : state) {
+        world.Update();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_IteratePerChunk);
+
+// extract the positions outside of schedule, as renderers do
+static void ECS_ExtractWithGet(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_ExtractWithGet-{}", state.thread_index()));
+
+    constexpr std::size_t num_entities = 1'000'000;
+    const auto            entities     = world.GetEntityManager().CreateMany<Position, Velocity>(num_entities);
+
+    std::pmr::vector<math::vec3f> positions(num_entities);
+    for (auto _ : state) {
+        for (std::size_t index = 0; index < num_entities; index++) {
+            positions[index] = entities[index].Get<Position>().value;
+        }
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_ExtractWithGet);
+
+static void ECS_ExtractWithQuery(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_ExtractWithQuery-{}", state.thread_index()));
+
+    constexpr std::size_t num_entities = 1'000'000;
+    std::ignore = world.GetEntityManager().CreateMany<Position, Velocity>(num_entities);
+
+    std::pmr::vector<math::vec3f> positions(num_entities);
+    for (auto _ : state) {
+        auto iter = positions.begin();
+        for (const auto& [chunk_positions] : world.GetEntityManager().Query<const Position>()) {
+            iter = std::transform(chunk_positions.begin(), chunk_positions.end(), iter, [](const Position& position) { return position.value; });
+        }
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_ExtractWithQuery);
+
+template <std::size_t I>
+struct Data {
+    float value = 1.0f;
+};
+
+template <std::size_t N>
+static void ECS_IterateComponents(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_IterateComponents-{}", state.thread_index()));
+
+    struct IterateSystem {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule.Request("Iterate", []<std::size_t... I>(std::index_sequence<I...>) {
+                return [](Data<0>& first, const Data<I + 1>&... rest) { first.value += (rest.value + ... + 1.0f); };
+            }(std::make_index_sequence<N - 1>{}));
+        }
+    };
+    world.GetSystemManager().Register<IterateSystem>();
+
+    constexpr std::size_t num_entities = 100'000;
+    std::ignore = world.GetEntityManager().CreateMany<Data<0>, Data<1>, Data<2>, Data<3>>(num_entities);
+
+    for (auto _ : state) {
+        world.Update();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK_TEMPLATE(ECS_IterateComponents, 1);
+BENCHMARK_TEMPLATE(ECS_IterateComponents, 2);
+BENCHMARK_TEMPLATE(ECS_IterateComponents, 3);
+BENCHMARK_TEMPLATE(ECS_IterateComponents, 4);
+
+// the same number of entities are spread over `state.range(0)` archetypes
+static void ECS_IterateFragmentedArchetypes(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_IterateFragmentedArchetypes-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    struct MoveSystem {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule.Request("Move", [](Position& position, const Velocity& velocity) {
+                position.value += velocity.value * 0.01f;
+            });
+        }
+    };
+    world.GetSystemManager().Register<MoveSystem>();
+
+    constexpr std::size_t num_tags = 10;
+    for (std::size_t index = 0; index < num_tags; index++) {
+        em.RegisterDynamicComponent({.name = std::pmr::string(fmt::format("Tag-{}", index)), .size = sizeof(int)});
+    }
+
+    constexpr std::size_t num_entities   = 100'000;
+    const auto            num_archetypes = static_cast<std::size_t>(state.range(0));
+    for (std::size_t archetype_index = 0; archetype_index < num_archetypes; archetype_index++) {
+        std::pmr::set<std::string_view> tags;
+        for (std::size_t index = 0; index < num_tags; index++) {
+            if (archetype_index & (1 << index)) {
+                tags.emplace(em.GetDynamicComponentInfo(fmt::format("Tag-{}", index)).name);
+            }
+        }
+        std::ignore = em.CreateMany<Position, Velocity>(num_entities / num_archetypes, tags);
+    }
+
+    for (auto _ : state) {
+        world.Update();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_IterateFragmentedArchetypes)->RangeMultiplier(4)->Range(1, 1024);
+
+template <std::size_t I>
+struct ParallelSystem {
+    static void OnUpdate(ecs::Schedule& schedule) {
+        static const auto name = fmt::format("Parallel-{}", I);
+        schedule.Request(name, [](Data<I>& data) {
+            data.value = std::sqrt(data.value * data.value + 1.0f);
+        });
+    }
+};
+
+// systems writing different components run in parallel, `state.range(0)` is the number of workers
+static void ECS_UpdateWithWorkers(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_UpdateWithWorkers-{}", state.thread_index()), {}, state.range(0));
+
+    world.GetSystemManager().Register<ParallelSystem<0>, ParallelSystem<1>, ParallelSystem<2>, ParallelSystem<3>,
+                                      ParallelSystem<4>, ParallelSystem<5>, ParallelSystem<6>, ParallelSystem<7>>();
+
+    constexpr std::size_t num_entities = 100'000;
+    std::ignore = world.GetEntityManager().CreateMany<Data<0>, Data<1>, Data<2>, Data<3>, Data<4>, Data<5>, Data<6>, Data<7>>(num_entities);
+
+    for (auto _ : state) {
+        world.Update();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities * 8);
+}
+BENCHMARK(ECS_UpdateWithWorkers)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+template <typename T>
+static void destroy_entities(benchmark::State& state, T value) {
+    ecs::World world(fmt::format("ECS_Destroy-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto entities = em.SpawnBatch(num_entities, [&](std::size_t) { return std::tuple{Position{}, Velocity{}, value}; });
+        state.ResumeTiming();
+
+        // destroy from the front, so every destruction moves the last entity
+        for (auto& entity : entities) {
+            em.Destroy(entity);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+
+struct TrivialComponent {
+    std::array<float, 16> value;
+};
+struct NonTrivialComponent {
+    std::pmr::string value;
+};
+
+static void ECS_CreateMany(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_CreateMany-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        auto entities = em.CreateMany<Position, Velocity, TrivialComponent>(num_entities);
+
+        state.PauseTiming();
+        for (auto& entity : entities) {
+            em.Destroy(entity);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_CreateMany)->Arg(10'000)->Arg(100'000);
+
+static void ECS_SpawnBatch(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_SpawnBatch-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        auto entities = em.SpawnBatch(num_entities, [](std::size_t index) {
+            return std::tuple{Position{math::vec3f(static_cast<float>(index))}, Velocity{math::vec3f(1.0f)}, NonTrivialComponent{"spawned"}};
+        });
+
+        state.PauseTiming();
+        for (auto& entity : entities) {
+            em.Destroy(entity);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_SpawnBatch)->Arg(10'000)->Arg(100'000);
+
+static void ECS_DestroyTrivialComponents(benchmark::State& state) {
+    destroy_entities(state, TrivialComponent{});
+}
+BENCHMARK(ECS_DestroyTrivialComponents)->Arg(10'000)->Arg(100'000);
+
+static void ECS_DestroyNonTrivialComponents(benchmark::State& state) {
+    destroy_entities(state, NonTrivialComponent{"a string longer than the small string buffer"});
+}
+BENCHMARK(ECS_DestroyNonTrivialComponents)->Arg(10'000)->Arg(100'000);
+
+static void ECS_MoveBetweenArchetypes(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_MoveBetweenArchetypes-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    auto       entities     = em.CreateMany<Position, Velocity, TrivialComponent>(num_entities);
+
+    for (auto _ : state) {
+        for (auto& entity : entities) {
+            entity.Emplace<NonTrivialComponent>();
+        }
+        for (auto& entity : entities) {
+            entity.Remove<NonTrivialComponent>();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities * 2);
+}
+BENCHMARK(ECS_MoveBetweenArchetypes)->Arg(10'000);
+
+struct PerEntityMesh {
+    std::shared_ptr<int> mesh;
+};
+struct SharedMesh {
+    constexpr static auto storage = ecs::ComponentStorage::Shared;
+
+    bool operator==(const SharedMesh&) const = default;
+
+    std::shared_ptr<int> mesh;
+};
+template <>
+struct std::hash<SharedMesh> {
+    std::size_t operator()(const SharedMesh& component) const noexcept {
+        return std::hash<std::shared_ptr<int>>{}(component.mesh);
+    }
+};
+
+// the per entity pointer pays for refcount on every move
+template <typename Mesh>
+static void ECS_MoveWithMeshComponent(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_MoveWithMeshComponent-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    const auto mesh         = std::make_shared<int>(0);
+
+    std::pmr::vector<ecs::Entity> entities = em.SpawnBatch(num_entities, [&](std::size_t) {
+        return std::tuple{Position{}, Velocity{}, Mesh{mesh}};
+    });
+
+    for (auto _ : state) {
+        for (auto& entity : entities) {
+            entity.Emplace<TrivialComponent>();
+        }
+        for (auto& entity : entities) {
+            entity.Remove<TrivialComponent>();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities * 2);
+}
+BENCHMARK_TEMPLATE(ECS_MoveWithMeshComponent, PerEntityMesh)->Arg(10'000);
+BENCHMARK_TEMPLATE(ECS_MoveWithMeshComponent, SharedMesh)->Arg(10'000);
+
+static void ECS_AddRemoveDynamicComponent(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_AddRemoveDynamicComponent-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+    em.RegisterDynamicComponent({.name = "DynamicComponent", .size = sizeof(math::vec4f)});
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    auto       entities     = em.CreateMany<Position, Velocity>(num_entities);
+
+    for (auto _ : state) {
+        for (auto& entity : entities) {
+            entity.Add("DynamicComponent");
+        }
+        for (auto& entity : entities) {
+            entity.Remove("DynamicComponent");
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities * 2);
+}
+BENCHMARK(ECS_AddRemoveDynamicComponent)->Arg(10'000);
+
+struct ArchetypeTag {};
+struct SparseTag {
+    constexpr static auto storage = ecs::ComponentStorage::Sparse;
+};
+
+// toggle a tag on entities with large components, then visit the tagged ones
+template <typename Tag>
+static void ECS_ToggleTag(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_ToggleTag-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    auto       entities     = em.CreateMany<Position, Velocity, LargeTransform>(num_entities);
+
+    struct System {
+        static void OnUpdate(ecs::Schedule& schedule) {
+            schedule.Request("MoveTagged", [](Position& position, const Velocity& velocity, const Tag&) {
+                position.value += velocity.value;
+            });
+        }
+    };
+    world.GetSystemManager().Register<System>();
+
+    for (auto _ : state) {
+        for (std::size_t index = 0; index < num_entities; index += 4) {
+            entities[index].Emplace<Tag>();
+        }
+        world.Update();
+        for (std::size_t index = 0; index < num_entities; index += 4) {
+            entities[index].Remove<Tag>();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities / 4 * 2);
+}
+BENCHMARK_TEMPLATE(ECS_ToggleTag, ArchetypeTag)->Arg(10'000);
+BENCHMARK_TEMPLATE(ECS_ToggleTag, SparseTag)->Arg(10'000);
+
+static void ECS_RandomAccessGet(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_RandomAccessGet-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    auto       entities     = em.CreateMany<Position, Velocity, TrivialComponent>(num_entities);
+    std::shuffle(entities.begin(), entities.end(), std::mt19937{42});
+
+    for (auto _ : state) {
+        math::vec3f sum(0.0f);
+        for (const auto& entity : entities) {
+            sum += entity.Get<Position>().value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_RandomAccessGet)->Arg(10'000)->Arg(100'000);
+
+template <std::size_t N>
+struct TrivialSystem {
+    static void OnUpdate(ecs::Schedule& schedule) {
+        static const auto name = fmt::format("Trivial-{}", N);
+        if constexpr (N % 2 == 0) {
+            schedule.Request(name, [](Position&) {});
+        } else {
+            schedule.Request(name, [](const Position&, const Velocity&) {});
+        }
+    }
+};
+
+static void ECS_UpdateTrivialSystems(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_UpdateTrivialSystems-{}", state.thread_index()));
+
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        world.GetSystemManager().Register<TrivialSystem<I>...>();
+    }(std::make_index_sequence<100>{});
+
+    for (auto _ : state) {
+        world.Update();
+    }
+}
+BENCHMARK(ECS_UpdateTrivialSystems);
+
+static void ECS_TakeSnapshot(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_TakeSnapshot-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    const auto entities     = em.CreateMany<Position, Velocity, TrivialComponent>(num_entities);
+
+    for (auto _ : state) {
+        auto snapshot = em.TakeSnapshot();
+        benchmark::DoNotOptimize(snapshot.GetData().data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_TakeSnapshot)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void ECS_TakeSnapshotReuse(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_TakeSnapshotReuse-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    const auto entities     = em.CreateMany<Position, Velocity, TrivialComponent>(num_entities);
+
+    auto snapshot = em.TakeSnapshot();
+    for (auto _ : state) {
+        em.TakeSnapshot(snapshot);
+        benchmark::DoNotOptimize(snapshot.GetData().data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_TakeSnapshotReuse)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void ECS_RestoreSnapshot(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_RestoreSnapshot-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_entities = static_cast<std::size_t>(state.range(0));
+    const auto entities     = em.CreateMany<Position, Velocity, TrivialComponent>(num_entities);
+    const auto snapshot     = em.TakeSnapshot();
+
+    for (auto _ : state) {
+        em.Restore(snapshot);
+    }
+    state.SetItemsProcessed(state.iterations() * num_entities);
+}
+BENCHMARK(ECS_RestoreSnapshot)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+struct PrefabParent {
+    ecs::Entity parent;
+
+    void RemapEntities(const ecs::EntityRemap& remap) { parent = remap(parent); }
+};
+
+// a root with 3 children, the children are in another archetype
+static constexpr std::size_t num_prefab_nodes = 4;
+
+static void ECS_InstantiatePrefab(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_InstantiatePrefab-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    std::pmr::vector<ecs::Entity> nodes{em.Spawn(Position{}, Velocity{math::vec3f(1.0f)})};
+    for (std::size_t index = 1; index < num_prefab_nodes; index++) {
+        nodes.emplace_back(em.Spawn(Position{math::vec3f(static_cast<float>(index))}, TrivialComponent{}, PrefabParent{nodes.front()}));
+    }
+    const auto prefab = em.CreatePrefab(nodes);
+
+    const auto num_instances = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        auto entities = em.Instantiate(prefab, num_instances);
+
+        state.PauseTiming();
+        for (auto& entity : entities) {
+            em.Destroy(entity);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_instances * num_prefab_nodes);
+}
+BENCHMARK(ECS_InstantiatePrefab)->Arg(10'000);
+
+// the same entities as `ECS_InstantiatePrefab`, but spawned instance by instance
+static void ECS_SpawnPrefabNodes(benchmark::State& state) {
+    ecs::World world(fmt::format("ECS_SpawnPrefabNodes-{}", state.thread_index()));
+    auto&      em = world.GetEntityManager();
+
+    const auto num_instances = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        std::pmr::vector<ecs::Entity> entities;
+        for (std::size_t instance = 0; instance < num_instances; instance++) {
+            const auto root = entities.emplace_back(em.Spawn(Position{}, Velocity{math::vec3f(1.0f)}));
+            for (std::size_t index = 1; index < num_prefab_nodes; index++) {
+                entities.emplace_back(em.Spawn(Position{math::vec3f(static_cast<float>(index))}, TrivialComponent{}, PrefabParent{root}));
+            }
+        }
+
+        state.PauseTiming();
+        for (auto& entity : entities) {
+            em.Destroy(entity);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_instances * num_prefab_nodes);
+}
+BENCHMARK(ECS_SpawnPrefabNodes)->Arg(10'000);
+
 BENCHMARK_MAIN();
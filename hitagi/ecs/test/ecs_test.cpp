@@ -1,7 +1,11 @@
 #include <hitagi/math/transform.hpp>
 #include <hitagi/ecs/world.hpp>
+#include <hitagi/ecs/world_group.hpp>
 #include <hitagi/ecs/entity.hpp>
 #include <hitagi/ecs/schedule.hpp>
+#include <hitagi/ecs/prefab.hpp>
+#include <hitagi/ecs/query.hpp>
+#include <hitagi/ecs/snapshot.hpp>
 #include <hitagi/utils/test.hpp>
 
 #include <range/v3/view/zip.hpp>
@@ -57,6 +61,59 @@ struct Component_3 {
 struct ContainerComponent {
     std::string value;
 };
+struct PersistableComponent {
+    std::string value;
+    Entity      target;
+
+    void Serialize(SnapshotWriter& writer) const {
+        writer.Write(value);
+        writer.Write(target);
+    }
+    static auto Deserialize(SnapshotReader& reader) -> PersistableComponent {
+        auto value = reader.ReadString();
+        return {std::string(value), reader.ReadEntity()};
+    }
+};
+
+struct SharedValueComponent {
+    constexpr static auto storage = ComponentStorage::Shared;
+
+    bool operator==(const SharedValueComponent&) const = default;
+
+    std::shared_ptr<int> value;
+};
+template <>
+struct std::hash<SharedValueComponent> {
+    std::size_t operator()(const SharedValueComponent& component) const noexcept {
+        return std::hash<std::shared_ptr<int>>{}(component.value);
+    }
+};
+struct ChunkComponent_1 {
+    constexpr static auto storage = ComponentStorage::Chunk;
+
+    std::size_t num_entities = 0;
+};
+
+struct SparseTag {
+    constexpr static auto storage = ComponentStorage::Sparse;
+};
+struct SparseValueComponent {
+    constexpr static auto storage = ComponentStorage::Sparse;
+
+    std::string value;
+};
+
+struct DoubleBufferedValueComponent {
+    constexpr static bool double_buffered = true;
+
+    int value = 0;
+};
+
+struct LinkComponent {
+    Entity target;
+
+    void RemapEntities(const EntityRemap& remap) { target = remap(target); }
+};
 
 class EcsTest : public ::testing::Test {
 public:
@@ -87,8 +144,8 @@ TEST_F(EcsTest, CreateManyEntitiesWithComponent) {
     em.RegisterDynamicComponent({
         .name                = "DynamicComponent",
         .size                = sizeof(int),
-        .default_constructor = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
-        .destructor          = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
+        .default_constructor = [](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
+        .destructor          = [](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
     });
 
     const auto entities = em.CreateMany<Component_1, Component_2>(100, {"DynamicComponent"});
@@ -127,8 +184,8 @@ TEST_F(EcsTest, AddComponent) {
     em.RegisterDynamicComponent({
         .name                = "DynamicComponent",
         .size                = sizeof(int),
-        .default_constructor = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
-        .destructor          = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
+        .default_constructor = [](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
+        .destructor          = [](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
     });
 
     auto entity = em.Create();
@@ -177,6 +234,37 @@ TEST_F(EcsTest, AddComponentKeepOldComponent) {
     EXPECT_STREQ(entity_2.Get<ContainerComponent>().value.c_str(), "test");
 }
 
+TEST_F(EcsTest, AddComponentKeepDynamicComponent) {
+    em.RegisterDynamicComponent({
+        .name = "DynamicComponent",
+        .size = sizeof(int),
+    });
+
+    auto entity                                              = em.Create();
+    *reinterpret_cast<int*>(entity.Add("DynamicComponent")) = 10;
+    entity.Emplace<Component_1>();
+    EXPECT_DYNAMIC_COMPONENT_EQ(entity, "DynamicComponent", 10);
+    entity.Remove<Component_1>();
+    EXPECT_DYNAMIC_COMPONENT_EQ(entity, "DynamicComponent", 10);
+}
+
+TEST_F(EcsTest, DestroyKeepOtherEntities) {
+    auto entities = em.SpawnBatch(1000, [](std::size_t index) {
+        return std::tuple{Component_1{static_cast<int>(index)}, ContainerComponent{std::to_string(index)}};
+    });
+
+    for (std::size_t index = 0; index < entities.size(); index += 2) {
+        em.Destroy(entities[index]);
+    }
+
+    EXPECT_EQ(em.NumEntities(), entities.size() / 2);
+    for (std::size_t index = 1; index < entities.size(); index += 2) {
+        EXPECT_COMPONENT_EQ(entities[index], Component_1, static_cast<int>(index));
+        EXPECT_EQ(entities[index].Get<ContainerComponent>().value, std::to_string(index));
+        EXPECT_EQ(entities[index].Get<Entity>(), entities[index]);
+    }
+}
+
 TEST_F(EcsTest, GetComponent) {
     auto entity = em.Create();
     entity.Emplace<Component_1>();
@@ -201,8 +289,8 @@ TEST_F(EcsTest, ModifyComponent) {
     em.RegisterDynamicComponent({
         .name                = "DynamicComponent",
         .size                = sizeof(int),
-        .default_constructor = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 2; },
-        .destructor          = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
+        .default_constructor = [](std::byte* data) { *reinterpret_cast<int*>(data) = 2; },
+        .destructor          = [](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
     });
 
     entity.Add("DynamicComponent");
@@ -210,12 +298,13 @@ TEST_F(EcsTest, ModifyComponent) {
 }
 
 TEST_F(EcsTest, RemoveComponent) {
-    bool is_destructed = false;
+    static bool is_destructed;
+    is_destructed = false;
 
     em.RegisterDynamicComponent({
         .name       = "DynamicComponent",
         .size       = sizeof(int),
-        .destructor = [&](std::byte*) { is_destructed = true; },
+        .destructor = [](std::byte*) { is_destructed = true; },
     });
 
     auto entity = em.Create();
@@ -230,13 +319,14 @@ TEST_F(EcsTest, RemoveComponent) {
 }
 
 TEST_F(EcsTest, DestructComponentAfterWorldDestroyed) {
-    bool is_destructed = false;
+    static bool is_destructed;
+    is_destructed = false;
     {
         World _world("DestructComponentAfterWorldDestroyed");
         _world.GetEntityManager().RegisterDynamicComponent({
             .name       = "DynamicComponent",
             .size       = sizeof(int),
-            .destructor = [&](std::byte*) { is_destructed = true; },
+            .destructor = [](std::byte*) { is_destructed = true; },
         });
         auto entity = _world.GetEntityManager().Create();
         entity.Add("DynamicComponent");
@@ -305,8 +395,8 @@ TEST_F(EcsTest, SystemUpdate) {
     em.RegisterDynamicComponent({
         .name                = "DynamicComponent",
         .size                = sizeof(int),
-        .default_constructor = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
-        .destructor          = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
+        .default_constructor = [](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
+        .destructor          = [](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
     });
 
     static std::vector<Entity> invoked_entities;
@@ -314,7 +404,7 @@ TEST_F(EcsTest, SystemUpdate) {
     struct System {
         static void OnUpdate(Schedule& schedule) {
             schedule.Request(
-                "ImplicitFilterAll", [&](Entity e, LastFrame<Component_1> c1, Component_2& c2, std::byte* c3) {
+                "ImplicitFilterAll", [&](Entity e, LastFrame<Component_1>, Component_2& c2, std::byte* c3) {
                     invoked_entities.emplace_back(e);
                     c2.value                    = 200;
                     *reinterpret_cast<int*>(c3) = 300;
@@ -348,8 +438,8 @@ TEST_F(EcsTest, SystemUpdateWithNoEntities) {
     em.RegisterDynamicComponent({
         .name                = "DynamicComponent",
         .size                = sizeof(int),
-        .default_constructor = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
-        .destructor          = [&](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
+        .default_constructor = [](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
+        .destructor          = [](std::byte* data) { *reinterpret_cast<int*>(data) = 0; },
     });
 
     static bool invoked = false;
@@ -411,6 +501,37 @@ TEST_F(EcsTest, SystemUpdateOrder) {
         << "3(ReadAfterWrite). Execute parallel all function request with const Component&";
 }
 
+TEST_F(EcsTest, SystemUpdateOrderAfterRequestsChanged) {
+    static std::pmr::vector<std::size_t> order;
+
+    struct System_1 {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Fn1", [&](Component_1&) { order.emplace_back(1); });
+        }
+    };
+    struct System_2 {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Fn2", [&](const Component_1&) { order.emplace_back(2); });
+        }
+    };
+
+    em.Create().Emplace<Component_1>();
+    sm.Register<System_2>();
+    world.Update();
+    EXPECT_EQ(order, std::pmr::vector<std::size_t>({2}));
+
+    order.clear();
+    sm.Register<System_1>();
+    world.Update();
+    world.Update();
+    EXPECT_EQ(order, std::pmr::vector<std::size_t>({1, 2, 1, 2})) << "The task graph should be compiled again after registering";
+
+    order.clear();
+    sm.Disable<System_2>();
+    world.Update();
+    EXPECT_EQ(order, std::pmr::vector<std::size_t>({1})) << "The task graph should be compiled again after disabling";
+}
+
 TEST_F(EcsTest, SystemUpdateInCustomOrder) {
     static std::pmr::vector<std::size_t> order;
     std::pmr::vector<std::size_t>        expected_order{2, 1};
@@ -526,6 +647,1296 @@ TEST_F(EcsTest, SystemFilterNone) {
     EXPECT_COMPONENT_EQ(entity_with_both, Component_1, 1) << "Component_1 should not be updated";
 }
 
+TEST_F(EcsTest, CommandBufferCreateEntity) {
+    auto& command_buffer = world.GetCommandBuffer();
+
+    auto entity = command_buffer.Create();
+    command_buffer.Emplace<Component_1>(entity, 10);
+    command_buffer.Emplace<ContainerComponent>(entity, "test");
+    EXPECT_FALSE(entity.Valid()) << "The entity should not be valid before the command buffer is played back";
+
+    world.Update();
+
+    ASSERT_TRUE(entity.Valid());
+    EXPECT_EQ(entity.Get<Entity>(), entity);
+    EXPECT_COMPONENT_EQ(entity, Component_1, 10);
+    EXPECT_STREQ(entity.Get<ContainerComponent>().value.c_str(), "test");
+    EXPECT_TRUE(command_buffer.Empty());
+}
+
+TEST_F(EcsTest, CommandBufferDestroyEntity) {
+    auto entity = em.Create();
+
+    auto& command_buffer = world.GetCommandBuffer();
+    command_buffer.Destroy(entity);
+    command_buffer.Emplace<Component_1>(entity);
+    EXPECT_TRUE(entity.Valid());
+
+    auto temp_entity = command_buffer.Create();
+    command_buffer.Destroy(temp_entity);
+
+    world.Update();
+
+    EXPECT_FALSE(entity.Valid());
+    EXPECT_FALSE(temp_entity.Valid());
+    EXPECT_EQ(em.NumEntities(), 0);
+}
+
+TEST_F(EcsTest, CommandBufferAddAndRemoveComponent) {
+    em.RegisterDynamicComponent({
+        .name                = "DynamicComponent",
+        .size                = sizeof(int),
+        .default_constructor = [](std::byte* data) { *reinterpret_cast<int*>(data) = 1; },
+    });
+
+    auto entity                                = em.Create();
+    entity.Emplace<Component_1>().value        = 10;
+    entity.Emplace<ContainerComponent>().value = "keep";
+    entity.Emplace<Component_2>();
+
+    auto& command_buffer = world.GetCommandBuffer();
+    command_buffer.Emplace<Component_1>(entity, 20);  // existed component will not be replaced
+    command_buffer.Remove<Component_2>(entity);
+    command_buffer.Emplace<Component_3>(entity, 30);
+    command_buffer.Add(entity, "DynamicComponent");
+
+    world.Update();
+
+    EXPECT_COMPONENT_EQ(entity, Component_1, 10);
+    EXPECT_FALSE(entity.Has<Component_2>());
+    EXPECT_COMPONENT_EQ(entity, Component_3, 30);
+    EXPECT_STREQ(entity.Get<ContainerComponent>().value.c_str(), "keep");
+    EXPECT_DYNAMIC_COMPONENT_EQ(entity, "DynamicComponent", 1);
+
+    command_buffer.Remove<Component_1>(entity);
+    command_buffer.Emplace<Component_1>(entity, 40);  // replace the component
+    world.Update();
+
+    EXPECT_COMPONENT_EQ(entity, Component_1, 40);
+}
+
+TEST_F(EcsTest, CommandBufferInSystem) {
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule
+                .Request(
+                    "SpawnChild",
+                    [&world = schedule.world](const Component_1& c1) {
+                        auto& command_buffer = world.GetCommandBuffer();
+                        auto  child          = command_buffer.Create();
+                        command_buffer.Emplace<Component_2>(child, c1.value);
+                    })
+                .Request(
+                    "DestroySelf",
+                    [&world = schedule.world](Entity entity, const Component_1&) {
+                        world.GetCommandBuffer().Destroy(entity);
+                    });
+        }
+    };
+
+    auto entities = em.CreateMany<Component_1>(100);
+    for (std::size_t i = 0; i < entities.size(); i++) {
+        entities[i].Get<Component_1>().value = i;
+    }
+
+    sm.Register<System>();
+    world.Update();
+
+    for (const auto entity : entities) {
+        EXPECT_FALSE(entity.Valid());
+    }
+    EXPECT_EQ(em.NumEntities(), entities.size());
+
+    static std::pmr::set<int> collected_values;
+    struct CollectSystem {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Collect", [](const Component_2& c2) { collected_values.emplace(c2.value); });
+        }
+    };
+    sm.Unregister<System>();
+    sm.Register<CollectSystem>();
+    world.Update();
+    EXPECT_EQ(collected_values.size(), entities.size()) << "Each spawned child should keep the value of its parent";
+}
+
+TEST_F(EcsTest, CommandBufferAcrossThreads) {
+    // created in the buffer of the threads outside the executor, which is played back after the buffers of workers
+    static Entity entity;
+    entity = world.GetCommandBuffer().Create();
+
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("EmplaceOnWorker", [&world = schedule.world](const Component_1&) {
+                world.GetCommandBuffer().Emplace<Component_2>(entity, 20);
+            });
+        }
+    };
+    em.Create().Emplace<Component_1>();
+    sm.Register<System>();
+    world.Update();
+
+    ASSERT_TRUE(entity.Valid());
+    EXPECT_COMPONENT_EQ(entity, Component_2, 20) << "The command recorded on a worker should see the entity created before it";
+
+    sm.Unregister<System>();
+    std::pmr::vector<std::thread> threads;
+    for (std::size_t thread_index = 0; thread_index < 4; thread_index++) {
+        threads.emplace_back([&] {
+            for (std::size_t index = 0; index < 100; index++) {
+                auto& command_buffer = world.GetCommandBuffer();
+                command_buffer.Emplace<Component_1>(command_buffer.Create(), static_cast<int>(index));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    world.Update();
+
+    EXPECT_EQ(em.Query<const Component_1>().NumEntities(), 401) << "The buffer shared by other threads should not lose commands";
+}
+
+TEST_F(EcsTest, SpawnEntity) {
+    const auto entity = em.Spawn(Component_1{10}, ContainerComponent{"test"});
+
+    ASSERT_TRUE(entity.Valid());
+    EXPECT_EQ(entity.Get<Entity>(), entity);
+    EXPECT_COMPONENT_EQ(entity, Component_1, 10);
+    EXPECT_STREQ(entity.Get<ContainerComponent>().value.c_str(), "test");
+    EXPECT_FALSE(entity.Has<Component_2>());
+}
+
+TEST_F(EcsTest, SpawnBatch) {
+    const auto existed_entities = em.CreateMany<Component_1, ContainerComponent>(10);
+
+    const auto entities = em.SpawnBatch(1000, [](std::size_t index) {
+        return std::tuple{Component_1{static_cast<int>(index)}, ContainerComponent{std::to_string(index)}};
+    });
+
+    ASSERT_EQ(entities.size(), 1000);
+    EXPECT_EQ(em.NumEntities(), 1010);
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        const auto entity = entities[index];
+        ASSERT_TRUE(entity.Valid());
+        EXPECT_EQ(entity.Get<Entity>(), entity);
+        EXPECT_COMPONENT_EQ(entity, Component_1, static_cast<int>(index));
+        EXPECT_EQ(entity.Get<ContainerComponent>().value, std::to_string(index));
+    }
+    for (const auto entity : existed_entities) {
+        EXPECT_COMPONENT_EQ(entity, Component_1, 1) << "The existed entities in the same archetype should not be affected";
+    }
+}
+
+TEST_F(EcsTest, ChangedFilterSkipUnchangedChunks) {
+    static std::size_t num_visited = 0;
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Observe", [](Changed<const Component_1&>) { num_visited++; });
+        }
+    };
+
+    auto entities = em.CreateMany<Component_1>(10000);
+    sm.Register<System>();
+
+    num_visited = 0;
+    world.Update();
+    EXPECT_EQ(num_visited, entities.size()) << "New entities should be visited at the first run";
+
+    num_visited = 0;
+    world.Update();
+    EXPECT_EQ(num_visited, 0) << "Nothing changed since last run";
+
+    entities.front().Get<Component_1>().value = 10;
+    entities.front().MarkChanged<Component_1>();
+    num_visited = 0;
+    world.Update();
+    EXPECT_GT(num_visited, 0) << "The chunk of marked entity should be visited";
+    EXPECT_LT(num_visited, entities.size()) << "Other chunks should be skipped";
+
+    em.Spawn(Component_1{});
+    num_visited = 0;
+    world.Update();
+    EXPECT_GT(num_visited, 0) << "Structural changes should be visible";
+    EXPECT_LT(num_visited, entities.size());
+}
+
+TEST_F(EcsTest, ChangedFilterSeeWriteTask) {
+    static std::size_t num_visited = 0;
+    struct WriteSystem {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Write", [](Component_1& c1) { c1.value++; });
+        }
+    };
+    struct ObserveSystem {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Observe", [](Changed<const Component_1&> c1) {
+                EXPECT_GT(c1->value, 1);
+                num_visited++;
+            });
+        }
+    };
+
+    std::ignore = em.CreateMany<Component_1>(1000);
+    sm.Register<WriteSystem, ObserveSystem>();
+
+    world.Update();
+    num_visited = 0;
+    world.Update();
+    EXPECT_EQ(num_visited, 1000) << "Chunks written by other task should be visited";
+
+    sm.Disable<WriteSystem>();
+    num_visited = 0;
+    world.Update();
+    EXPECT_EQ(num_visited, 0);
+}
+
+TEST_F(EcsTest, ChunkHoldsAtLeastOneEntity) {
+    struct HugeComponent {
+        std::array<int, 1024> value;
+    };
+
+    World small_chunk_world("ChunkHoldsAtLeastOneEntity", {.chunk_size = 1_kB});
+    const auto entities = small_chunk_world.GetEntityManager().SpawnBatch(10, [](std::size_t index) {
+        HugeComponent component;
+        component.value.fill(static_cast<int>(index));
+        return std::tuple{component};
+    });
+
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        auto entity = entities[index];
+        EXPECT_EQ(entity.Get<HugeComponent>().value.front(), index);
+        EXPECT_EQ(entity.Get<HugeComponent>().value.back(), index);
+    }
+}
+
+TEST_F(EcsTest, InvalidChunkConfig) {
+    EXPECT_THROW(World("ZeroChunkSize", {.chunk_size = 0}), std::invalid_argument);
+    EXPECT_THROW(World("ChunkSizeOverMax", {.chunk_size = 64_kB, .max_chunk_size = 16_kB}), std::invalid_argument);
+}
+
+TEST_F(EcsTest, AdaptiveChunkSize) {
+    static std::size_t num_visited = 0;
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Observe", [](Changed<const Component_1&>) { num_visited++; });
+        }
+    };
+
+    World adaptive_world("AdaptiveChunkSize", {.chunk_size = 1_kB, .min_entities_per_chunk = 256});
+    auto  entities = adaptive_world.GetEntityManager().CreateMany<Component_1>(1000);
+    adaptive_world.GetSystemManager().Register<System>();
+    adaptive_world.Update();
+
+    entities.front().MarkChanged<Component_1>();
+    num_visited = 0;
+    adaptive_world.Update();
+    EXPECT_GE(num_visited, 256) << "The chunk should be grown to hold at least 256 entities";
+    EXPECT_LT(num_visited, entities.size());
+}
+
+TEST_F(EcsTest, ChunkTask) {
+    static std::size_t num_calls    = 0;
+    static std::size_t num_entities = 0;
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule
+                .Request(
+                    "Integrate",
+                    [](std::span<Component_1> c1, std::span<const Component_2> c2) {
+                        EXPECT_EQ(c1.size(), c2.size());
+                        for (std::size_t index = 0; index < c1.size(); index++) {
+                            c1[index].value += c2[index].value;
+                        }
+                        num_calls++;
+                        num_entities += c1.size();
+                    })
+                .Request(
+                    "PerEntityCheck",
+                    [](const Component_1& c1) {
+                        EXPECT_EQ(c1.value, 3);
+                    });
+        }
+    };
+
+    const auto entities = em.CreateMany<Component_1, Component_2>(10000);
+    sm.Register<System>();
+    world.Update();
+
+    EXPECT_EQ(num_entities, entities.size());
+    EXPECT_LT(num_calls, entities.size()) << "Chunk task should be called once per chunk";
+    for (const auto entity : entities) {
+        EXPECT_COMPONENT_EQ(entity, Component_1, 3);
+    }
+}
+
+TEST_F(EcsTest, Query) {
+    static std::size_t num_visited = 0;
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Observe", [](Changed<const Component_2&>) { num_visited++; });
+        }
+    };
+
+    const auto entities = em.CreateMany<Component_1, Component_2>(10000);
+    std::ignore = em.CreateMany<Component_1>(100);
+    const auto shared_value = std::make_shared<int>(1);
+    em.Spawn(Component_1{}, SharedValueComponent{shared_value});
+    sm.Register<System>();
+    world.Update();
+
+    std::size_t num_entities = 0;
+    for (const auto& [c1] : em.Query<const Component_1>()) {
+        num_entities += c1.size();
+    }
+    EXPECT_EQ(num_entities, 10101);
+    EXPECT_EQ(em.Query<const Component_1>(filter::None<Component_2>()).NumEntities(), 101);
+
+    const auto query = em.Query<Component_2, const Entity>();
+    EXPECT_EQ(query.NumEntities(), entities.size());
+    EXPECT_GT(query.NumChunks(), 1);
+    query.ParallelForEach([](const auto& chunk) {
+        const auto& [c2, chunk_entities] = chunk;
+        ASSERT_EQ(c2.size(), chunk_entities.size());
+        for (std::size_t index = 0; index < c2.size(); index++) {
+            c2[index].value = static_cast<int>(chunk_entities[index].GetId());
+        }
+    });
+    for (const auto entity : entities) {
+        EXPECT_COMPONENT_EQ(entity, Component_2, static_cast<int>(entity.GetId()));
+    }
+
+    num_visited = 0;
+    world.Update();
+    EXPECT_EQ(num_visited, entities.size()) << "The writes through query should be seen by Changed<T>";
+
+    // read only query from a const entity manager, shared components have one value per chunk
+    const auto& const_em     = em;
+    const auto  shared_query = const_em.Query<const SharedValueComponent, const Component_1>();
+    ASSERT_EQ(shared_query.NumChunks(), 1);
+    const auto& [shared, c1] = shared_query[0];
+    EXPECT_EQ(shared.size(), 1);
+    EXPECT_EQ(shared.front().value, shared_value);
+    EXPECT_EQ(c1.size(), 1);
+
+    EXPECT_EQ(em.Query<const Component_3>().NumChunks(), 0);
+}
+
+TEST_F(EcsTest, QueryFilterOnSparseComponent) {
+    auto entities = em.CreateMany<Component_3>(10);
+    entities[2].Emplace<SparseTag>();
+    entities[7].Emplace<SparseTag>();
+
+    const auto tagged = em.Query<const Component_3, const Entity>(filter::All<SparseTag>());
+    EXPECT_EQ(tagged.NumEntities(), 2);
+    EXPECT_EQ(tagged.NumChunks(), 2) << "The chunk is split into runs of matched entities";
+    for (const auto& [c3, chunk_entities] : tagged) {
+        ASSERT_EQ(c3.size(), chunk_entities.size());
+        for (const auto& entity : chunk_entities) {
+            EXPECT_TRUE(entity.Has<SparseTag>());
+        }
+    }
+
+    const auto untagged = em.Query<const Component_3, const Entity>(filter::None<SparseTag>());
+    EXPECT_EQ(untagged.NumEntities(), 8);
+    EXPECT_EQ(untagged.NumChunks(), 3);
+    for (const auto& [c3, chunk_entities] : untagged) {
+        for (const auto& entity : chunk_entities) {
+            EXPECT_FALSE(entity.Has<SparseTag>());
+        }
+    }
+}
+
+TEST_F(EcsTest, SnapshotRestore) {
+    em.RegisterDynamicComponent({
+        .name = "DynamicComponent",
+        .size = sizeof(int),
+    });
+
+    auto entities = em.SpawnBatch(1000, [](std::size_t index) {
+        return std::tuple{Component_1{static_cast<int>(index)}, ContainerComponent{std::to_string(index)}};
+    });
+    auto entity_with_dynamic_component = em.Create();
+
+    *reinterpret_cast<int*>(entity_with_dynamic_component.Add("DynamicComponent")) = 10;
+
+    const auto snapshot = em.TakeSnapshot();
+    EXPECT_EQ(snapshot.NumEntities(), entities.size() + 1);
+    EXPECT_FALSE(snapshot.IsPersistable()) << "std::string is neither trivially copyable nor serializable";
+
+    // destroy copies of handles, which are reset by `Destroy`
+    for (std::size_t index = 0; index < entities.size(); index += 2) {
+        auto entity = entities[index];
+        em.Destroy(entity);
+    }
+    entities[1].Get<Component_1>().value = -1;
+    entities[1].Get<ContainerComponent>().value.clear();
+    entity_with_dynamic_component.Remove("DynamicComponent");
+    const auto new_entity = em.Spawn(Component_2{});
+
+    em.Restore(snapshot);
+
+    EXPECT_EQ(em.NumEntities(), snapshot.NumEntities());
+    EXPECT_FALSE(new_entity.Valid());
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        const auto entity = entities[index];
+        ASSERT_TRUE(entity.Valid());
+        EXPECT_COMPONENT_EQ(entity, Component_1, static_cast<int>(index));
+        EXPECT_EQ(entity.Get<ContainerComponent>().value, std::to_string(index));
+        EXPECT_EQ(entity.Get<Entity>(), entity);
+    }
+    EXPECT_DYNAMIC_COMPONENT_EQ(entity_with_dynamic_component, "DynamicComponent", 10);
+
+    // the ids are not reused after restore
+    EXPECT_GT(em.Create().GetId(), new_entity.GetId());
+
+    // a snapshot can be restored again
+    em.Restore(snapshot);
+    EXPECT_EQ(em.NumEntities(), snapshot.NumEntities());
+}
+
+TEST_F(EcsTest, SnapshotReuse) {
+    auto entity = em.Spawn(Component_1{1}, ContainerComponent{"first"});
+
+    auto snapshot = em.TakeSnapshot();
+    entity.Get<Component_1>().value        = 2;
+    entity.Get<ContainerComponent>().value = "second";
+    em.TakeSnapshot(snapshot);
+    EXPECT_EQ(snapshot.NumEntities(), 1);
+
+    entity.Get<Component_1>().value = 3;
+    entity.Get<ContainerComponent>().value.clear();
+    em.Restore(snapshot);
+
+    EXPECT_COMPONENT_EQ(entity, Component_1, 2);
+    EXPECT_EQ(entity.Get<ContainerComponent>().value, "second");
+}
+
+TEST_F(EcsTest, SnapshotPersist) {
+    auto parent = em.Spawn(Component_1{10}, PersistableComponent{"parent", {}});
+    auto child  = em.Spawn(Component_1{20}, PersistableComponent{"child", parent});
+
+    std::pmr::vector<std::byte> data;
+    {
+        const auto snapshot = em.TakeSnapshot();
+        ASSERT_TRUE(snapshot.IsPersistable());
+        data.assign(snapshot.GetData().begin(), snapshot.GetData().end());
+    }
+
+    child.Get<PersistableComponent>().target = {};
+    auto parent_copy = parent;
+    em.Destroy(parent_copy);
+
+    em.Restore(Snapshot(data));
+
+    ASSERT_TRUE(parent.Valid());
+    ASSERT_TRUE(child.Valid());
+    EXPECT_COMPONENT_EQ(parent, Component_1, 10);
+    EXPECT_EQ(parent.Get<PersistableComponent>().value, "parent");
+    EXPECT_FALSE(parent.Get<PersistableComponent>().target);
+    EXPECT_EQ(child.Get<PersistableComponent>().value, "child");
+    EXPECT_EQ(child.Get<PersistableComponent>().target, parent);
+}
+
+TEST_F(EcsTest, RestoreInvalidSnapshot) {
+    const std::array<std::byte, 4> data{};
+    EXPECT_THROW(em.Restore(Snapshot(data)), std::invalid_argument);
+}
+
+TEST_F(EcsTest, RestoreBrokenSnapshotKeepsEntities) {
+    auto entity = em.Spawn(Component_1{}, PersistableComponent{"before", {}});
+
+    const auto snapshot = em.TakeSnapshot();
+    const auto data     = snapshot.GetData();
+
+    const auto other = em.Spawn(Component_2{});
+    entity.Get<PersistableComponent>().value = "after";
+
+    // the last byte is cut off
+    EXPECT_THROW(em.Restore(Snapshot(data.first(data.size() - 1))), std::out_of_range);
+    EXPECT_EQ(em.NumEntities(), 2);
+    EXPECT_TRUE(em.Has(other));
+    EXPECT_EQ(entity.Get<PersistableComponent>().value, "after");
+}
+
+TEST_F(EcsTest, RestoreMismatchedChunksKeepsEntities) {
+    World small_chunk_world("RestoreMismatchedChunksKeepsEntities", {.chunk_size = 1_kB});
+    auto& small_chunk_em = small_chunk_world.GetEntityManager();
+    std::ignore          = small_chunk_em.CreateMany<Component_1>(10);
+    std::ignore          = small_chunk_em.CreateMany<Component_2, ChunkComponent_1>(1000);
+    const auto snapshot  = small_chunk_em.TakeSnapshot();
+
+    const auto entities = em.CreateMany<Component_1>(10);
+    std::ignore         = em.CreateMany<Component_2, ChunkComponent_1>(10);
+
+    // the chunks of the archetype with `ChunkComponent_1` mismatch, whether the other one has been restored or not
+    EXPECT_THROW(em.Restore(Snapshot(snapshot.GetData())), std::invalid_argument);
+    EXPECT_EQ(em.NumEntities(), 20);
+    for (auto entity : entities) {
+        EXPECT_COMPONENT_EQ(entity, Component_1, 1);
+    }
+}
+
+TEST_F(EcsTest, SharedComponent) {
+    const auto value_1 = std::make_shared<int>(1);
+    const auto value_2 = std::make_shared<int>(2);
+
+    const auto entities = em.SpawnBatch(1000, [&](std::size_t index) {
+        return std::tuple{Component_1{static_cast<int>(index)}, SharedValueComponent{index % 2 ? value_1 : value_2}};
+    });
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        EXPECT_COMPONENT_EQ(entities[index], Component_1, static_cast<int>(index));
+        EXPECT_EQ(entities[index].Get<SharedValueComponent>().value, index % 2 ? value_1 : value_2);
+    }
+    EXPECT_EQ(value_1.use_count(), 2) << "The value is stored once";
+    EXPECT_EQ(value_2.use_count(), 2) << "The value is stored once";
+
+    static std::size_t num_entities = 0;
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule
+                .Request(
+                    "ChunkOfOneValue",
+                    [](std::span<const SharedValueComponent> shared, std::span<Component_1> c1) {
+                        EXPECT_EQ(shared.size(), 1);
+                        for (auto& component : c1) {
+                            EXPECT_EQ(component.value % 2 ? 1 : 2, *shared.front().value);
+                        }
+                        num_entities += c1.size();
+                    })
+                .Request(
+                    "PerEntity",
+                    [](const SharedValueComponent& shared, Component_1& c1) {
+                        c1.value = *shared.value;
+                    });
+        }
+    };
+    sm.Register<System>();
+    world.Update();
+
+    EXPECT_EQ(num_entities, entities.size());
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        EXPECT_COMPONENT_EQ(entities[index], Component_1, index % 2 ? 1 : 2);
+    }
+
+    auto entity = entities.front();
+    EXPECT_EQ(entity.SetShared(SharedValueComponent{value_1}).value, value_1);
+    EXPECT_COMPONENT_EQ(entity, Component_1, 2);
+    EXPECT_EQ(entities[1].Get<SharedValueComponent>().value, value_1);
+    EXPECT_EQ(entities[2].Get<SharedValueComponent>().value, value_2);
+
+    entity.Remove<SharedValueComponent>();
+    EXPECT_FALSE(entity.Has<SharedValueComponent>());
+    EXPECT_COMPONENT_EQ(entity, Component_1, 2);
+
+    world.GetCommandBuffer().Emplace<SharedValueComponent>(entity, value_2);
+    world.Update();
+    EXPECT_EQ(entity.Get<SharedValueComponent>().value, value_2);
+}
+
+TEST_F(EcsTest, ChunkComponent) {
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request(
+                "CountEntities",
+                [](std::span<ChunkComponent_1> chunk, std::span<const Component_1> c1) {
+                    EXPECT_EQ(chunk.size(), 1);
+                    chunk.front().num_entities = c1.size();
+                });
+        }
+    };
+
+    const auto entities = em.CreateMany<Component_1, ChunkComponent_1>(10000);
+    sm.Register<System>();
+    world.Update();
+
+    std::size_t num_entities = 0;
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        const auto& chunk_component = entities[index].Get<ChunkComponent_1>();
+        // the first entity of each chunk
+        if (index == 0 || &chunk_component != &entities[index - 1].Get<ChunkComponent_1>()) {
+            num_entities += chunk_component.num_entities;
+        }
+    }
+    EXPECT_EQ(num_entities, entities.size());
+
+    auto entity = entities.back();
+    entity.Remove<ChunkComponent_1>();
+    EXPECT_FALSE(entity.Has<ChunkComponent_1>());
+    entity.Emplace<ChunkComponent_1>();
+    EXPECT_TRUE(entity.Has<ChunkComponent_1>());
+
+    auto new_entity = em.Spawn(Component_2{});
+    EXPECT_EQ(new_entity.Emplace<ChunkComponent_1>().num_entities, 0) << "The chunk component of new chunk is default constructed";
+}
+
+TEST_F(EcsTest, SnapshotSharedAndChunkComponent) {
+    const auto value_1 = std::make_shared<int>(1);
+    const auto value_2 = std::make_shared<int>(2);
+
+    const auto entities = em.SpawnBatch(100, [&](std::size_t index) {
+        return std::tuple{Component_1{static_cast<int>(index)}, SharedValueComponent{index % 2 ? value_1 : value_2}};
+    });
+    for (auto entity : entities) {
+        entity.Emplace<ChunkComponent_1>().num_entities = 10;
+    }
+
+    const auto snapshot = em.TakeSnapshot();
+
+    for (auto entity : entities) {
+        entity.SetShared(SharedValueComponent{value_1});
+        entity.Get<ChunkComponent_1>().num_entities = 0;
+    }
+
+    em.Restore(snapshot);
+
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        EXPECT_COMPONENT_EQ(entities[index], Component_1, static_cast<int>(index));
+        EXPECT_EQ(entities[index].Get<SharedValueComponent>().value, index % 2 ? value_1 : value_2);
+        EXPECT_EQ(entities[index].Get<ChunkComponent_1>().num_entities, 10);
+    }
+}
+
+TEST_F(EcsTest, DynamicComponentCanNotBeShared) {
+    EXPECT_THROW(em.RegisterDynamicComponent({.name = "DynamicComponent", .size = sizeof(int), .storage = ComponentStorage::Shared}),
+                 std::invalid_argument);
+}
+
+TEST_F(EcsTest, SparseComponent) {
+    auto entities = em.CreateMany<Component_1>(100);
+    auto entity   = entities.front();
+
+    auto& c1 = entity.Get<Component_1>();
+    entity.Emplace<SparseTag>();
+    entity.Emplace<SparseValueComponent>("sparse");
+    EXPECT_EQ(&entity.Get<Component_1>(), &c1) << "The entity should not be moved";
+    EXPECT_TRUE(entity.Has<SparseTag>());
+    EXPECT_STREQ(entity.Get<SparseValueComponent>().value.c_str(), "sparse");
+    EXPECT_FALSE(entities.back().Has<SparseTag>());
+
+    for (auto other : entities) {
+        other.Emplace<SparseValueComponent>(fmt::format("{}", other.GetId()));
+    }
+    EXPECT_STREQ(entity.Get<SparseValueComponent>().value.c_str(), "sparse") << "The existed component will not be replaced";
+
+    entity.Remove<SparseTag>();
+    entity.Remove<SparseValueComponent>();
+    EXPECT_EQ(&entity.Get<Component_1>(), &c1) << "The entity should not be moved";
+    EXPECT_FALSE(entity.Has<SparseTag>());
+    EXPECT_FALSE(entity.Has<SparseValueComponent>());
+    for (std::size_t index = 1; index < entities.size(); index++) {
+        EXPECT_EQ(entities[index].Get<SparseValueComponent>().value, fmt::format("{}", entities[index].GetId()));
+    }
+
+    auto spawned = em.Spawn(Component_2{}, SparseValueComponent{"spawned"});
+    EXPECT_STREQ(spawned.Get<SparseValueComponent>().value.c_str(), "spawned");
+    em.Destroy(spawned);
+    EXPECT_EQ(em.CreateMany<SparseTag>(1).front().Has<SparseTag>(), true);
+}
+
+TEST_F(EcsTest, SparseComponentInSystem) {
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule
+                .Request(
+                    "WithSparse",
+                    [](Component_1& c1, const SparseValueComponent& sparse) {
+                        c1.value = static_cast<int>(sparse.value.size());
+                    })
+                .Request(
+                    "FilterAll",
+                    [](Component_2& c2) {
+                        c2.value = 100;
+                    },
+                    {},
+                    filter::All<SparseTag>())
+                .Request(
+                    "FilterNone",
+                    [](Component_3& c3) {
+                        c3.value = 100;
+                    },
+                    {},
+                    filter::None<SparseTag>());
+        }
+    };
+
+    const auto entities = em.CreateMany<Component_1, Component_2, Component_3>(10);
+    for (std::size_t index = 0; index < entities.size(); index += 2) {
+        auto entity = entities[index];
+        entity.Emplace<SparseValueComponent>("sparse");
+        entity.Emplace<SparseTag>();
+    }
+
+    sm.Register<System>();
+    world.Update();
+
+    for (std::size_t index = 0; index < entities.size(); index++) {
+        const bool tagged = index % 2 == 0;
+        EXPECT_COMPONENT_EQ(entities[index], Component_1, tagged ? 6 : 1);
+        EXPECT_COMPONENT_EQ(entities[index], Component_2, tagged ? 100 : 2);
+        EXPECT_COMPONENT_EQ(entities[index], Component_3, tagged ? 3 : 100);
+    }
+}
+
+TEST_F(EcsTest, SparseComponentCommandBufferAndSnapshot) {
+    auto entity = em.Create();
+    entity.Emplace<SparseTag>();
+
+    auto& command_buffer = world.GetCommandBuffer();
+    command_buffer.Emplace<SparseValueComponent>(entity, "command");
+    command_buffer.Remove<SparseTag>(entity);
+    world.Update();
+
+    EXPECT_FALSE(entity.Has<SparseTag>());
+    EXPECT_STREQ(entity.Get<SparseValueComponent>().value.c_str(), "command");
+
+    const auto snapshot = em.TakeSnapshot();
+    entity.Remove<SparseValueComponent>();
+    entity.Emplace<SparseTag>();
+
+    em.Restore(snapshot);
+    EXPECT_FALSE(entity.Has<SparseTag>());
+    EXPECT_STREQ(entity.Get<SparseValueComponent>().value.c_str(), "command");
+
+    command_buffer.Destroy(entity);
+    world.Update();
+    EXPECT_FALSE(entity.Valid());
+
+    auto new_entity = em.Create();
+    EXPECT_FALSE(new_entity.Has<SparseValueComponent>());
+}
+
+TEST_F(EcsTest, LastFrameStats) {
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule
+                .Request(
+                    "Write",
+                    [](Component_1& c1) {
+                        c1.value++;
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    })
+                .Request(
+                    "ReadAfterWrite",
+                    [](const Component_1& c1, Component_2& c2) {
+                        c2.value = c1.value;
+                    })
+                .Request(
+                    "Independent",
+                    [](std::span<Component_3> c3) {
+                        c3.front().value = 0;
+                    });
+        }
+    };
+
+    std::ignore = em.CreateMany<Component_1>(10);
+    std::ignore = em.CreateMany<Component_1, Component_2>(5);
+    std::ignore = em.CreateMany<Component_3>(1);
+    sm.Register<System>();
+    world.Update();
+
+    const auto& stats = world.GetLastFrameStats();
+    ASSERT_EQ(stats.tasks.size(), 3);
+    EXPECT_EQ(stats.tasks[0].name, "Write");
+    EXPECT_EQ(stats.tasks[0].num_entities, 15);
+    EXPECT_EQ(stats.tasks[0].num_chunks, 2);
+    EXPECT_GE(stats.tasks[0].duration, std::chrono::microseconds(100 * 15));
+    EXPECT_EQ(stats.tasks[1].num_entities, 5);
+    EXPECT_GE(stats.tasks[1].start_time, stats.tasks[0].start_time + stats.tasks[0].duration) << "ReadAfterWrite depends on Write";
+    EXPECT_EQ(stats.tasks[2].num_entities, 1);
+    EXPECT_EQ(stats.tasks[2].num_chunks, 1);
+
+    EXPECT_EQ(stats.critical_path, (std::pmr::vector<std::size_t>{0, 1}));
+    EXPECT_EQ(stats.critical_path_time, stats.tasks[0].duration + stats.tasks[1].duration);
+    EXPECT_GE(stats.update_time, stats.schedule_time + stats.playback_time);
+}
+
+TEST_F(EcsTest, DoubleBufferedComponent) {
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule
+                .Request(
+                    "Write",
+                    [](DoubleBufferedValueComponent& c) {
+                        c.value++;
+                    })
+                .Request(
+                    "ReadLastFrame",
+                    [](LastFrame<const DoubleBufferedValueComponent&> last, const DoubleBufferedValueComponent& c, Component_1& c1) {
+                        c1.value = c.value - last.value.value;
+                    });
+        }
+    };
+
+    auto entities = em.CreateMany<DoubleBufferedValueComponent, Component_1>(100);
+    sm.Register<System>();
+
+    for (int frame = 1; frame <= 3; frame++) {
+        world.Update();
+        for (auto entity : entities) {
+            EXPECT_COMPONENT_EQ(entity, DoubleBufferedValueComponent, frame);
+            EXPECT_COMPONENT_EQ(entity, Component_1, 1) << "The last frame value is copied at the start of each update";
+        }
+    }
+
+    // writes outside of the schedule are seen in the next update
+    entities.front().Get<DoubleBufferedValueComponent>().value = 10;
+    entities.front().MarkChanged<DoubleBufferedValueComponent>();
+    world.Update();
+    EXPECT_COMPONENT_EQ(entities.front(), DoubleBufferedValueComponent, 11);
+    EXPECT_COMPONENT_EQ(entities.front(), Component_1, 1);
+
+    // the last frame column moves with the component
+    auto entity = em.Spawn(DoubleBufferedValueComponent{.value = 100});
+    entity.Emplace<Component_1>();
+    entity.Emplace<Component_2>();
+    world.Update();
+    EXPECT_COMPONENT_EQ(entity, DoubleBufferedValueComponent, 101);
+    EXPECT_COMPONENT_EQ(entity, Component_1, 1);
+
+    entity.Remove<DoubleBufferedValueComponent>();
+    EXPECT_FALSE(entity.Has<DoubleBufferedValueComponent>());
+    entity.Emplace<DoubleBufferedValueComponent>();
+    world.Update();
+    EXPECT_COMPONENT_EQ(entity, DoubleBufferedValueComponent, 1);
+    EXPECT_COMPONENT_EQ(entity, Component_1, 1);
+}
+
+TEST_F(EcsTest, DoubleBufferedComponentNotOrdered) {
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            // the reader of last frame value runs after the writer without a cycle
+            schedule.SetOrder("Write", "ReadLastFrame");
+            schedule
+                .Request(
+                    "ReadLastFrame",
+                    [](LastFrame<DoubleBufferedValueComponent> last, Component_1& c1) {
+                        c1.value = last.value.value;
+                    })
+                .Request(
+                    "Write",
+                    [](DoubleBufferedValueComponent& c) {
+                        c.value = 42;
+                    });
+        }
+    };
+
+    auto entity = em.CreateMany<DoubleBufferedValueComponent, Component_1>(1).front();
+    sm.Register<System>();
+
+    world.Update();
+    EXPECT_COMPONENT_EQ(entity, DoubleBufferedValueComponent, 42);
+    EXPECT_COMPONENT_EQ(entity, Component_1, 0);
+    world.Update();
+    EXPECT_COMPONENT_EQ(entity, Component_1, 42);
+
+    const auto& stats = world.GetLastFrameStats();
+    ASSERT_EQ(stats.tasks.size(), 2);
+    EXPECT_GE(stats.tasks[0].start_time, stats.tasks[1].start_time + stats.tasks[1].duration);
+}
+
+TEST_F(EcsTest, SystemRequestsTasksOnce) {
+    static std::size_t num_requests = 0, num_runs = 0;
+    num_requests = num_runs = 0;
+
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            num_requests++;
+            schedule.Request("Count", [](const Component_1&) { num_runs++; });
+        }
+    };
+    struct OtherSystem {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Other", [](Component_2&) {});
+        }
+    };
+    std::ignore = em.CreateMany<Component_1>(1);
+    sm.Register<System>();
+
+    for (int i = 0; i < 3; i++) world.Update();
+    EXPECT_EQ(num_requests, 1);
+    EXPECT_EQ(num_runs, 3);
+    EXPECT_FALSE(world.GetLastFrameStats().graph_compiled);
+
+    // the tasks are requested again when the enabled systems change
+    sm.Register<OtherSystem>();
+    world.Update();
+    EXPECT_EQ(num_requests, 2);
+    EXPECT_EQ(num_runs, 4);
+    EXPECT_TRUE(world.GetLastFrameStats().graph_compiled);
+    EXPECT_EQ(world.GetLastFrameStats().tasks.size(), 2);
+
+    sm.Disable<OtherSystem>();
+    world.Update();
+    EXPECT_EQ(world.GetLastFrameStats().tasks.size(), 1);
+}
+
+static std::size_t num_fast_updates = 0, num_slow_updates = 0;
+struct FastSystem {
+    static void OnUpdate(Schedule& schedule) {
+        schedule.Request("Fast", [](const Component_1&) { num_fast_updates++; });
+    }
+};
+struct SlowSystem {
+    constexpr static std::string_view name = "Slow System";
+
+    static void OnUpdate(Schedule& schedule) {
+        schedule.Request("Slow", [](const Component_1&) { num_slow_updates++; });
+    }
+};
+
+TEST_F(EcsTest, SystemUpdateInterval) {
+    num_fast_updates = num_slow_updates = 0;
+
+    sm.Register<FastSystem, SlowSystem>();
+    sm.SetUpdateInterval<SlowSystem>(3);
+    std::ignore = em.CreateMany<Component_1>(1);
+
+    world.Update();
+    EXPECT_TRUE(world.GetLastFrameStats().skipped_systems.empty());
+    world.Update();
+    EXPECT_EQ(world.GetLastFrameStats().skipped_systems, (std::pmr::vector<std::pmr::string>{"Slow System"}));
+    EXPECT_FALSE(world.GetLastFrameStats().graph_compiled) << "The tasks of skipped systems are kept in the graph";
+    for (int i = 0; i < 5; i++) {
+        world.Update();
+        EXPECT_FALSE(world.GetLastFrameStats().graph_compiled);
+    }
+    EXPECT_EQ(num_fast_updates, 7);
+    EXPECT_EQ(num_slow_updates, 3) << "Updated at frame 1, 4 and 7";
+
+    sm.SetUpdateInterval<SlowSystem>(1);
+    world.Update();
+    EXPECT_EQ(num_slow_updates, 4);
+
+    // systems without a name are named by their demangled type names
+    sm.SetUpdateInterval<FastSystem>(2);
+    world.Update();
+    world.Update();
+    ASSERT_EQ(world.GetLastFrameStats().skipped_systems.size(), 1);
+    EXPECT_NE(world.GetLastFrameStats().skipped_systems.front().find("FastSystem"), std::pmr::string::npos);
+}
+
+TEST_F(EcsTest, TaskBudget) {
+    World budget_world("TaskBudget", {.chunk_size = 1_kB});
+    auto& budget_em = budget_world.GetEntityManager();
+
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule
+                .Request(
+                    "Sliced",
+                    [](Component_1& c1) { c1.value++; })
+                .Request(
+                    "ChangedSliced",
+                    [](Changed<const Component_1&>, Component_2& c2) { c2.value++; });
+            schedule.SetBudget("Sliced", {.max_chunks = 2});
+            schedule.SetBudget("ChangedSliced", {.max_chunks = 1});
+        }
+    };
+    budget_world.GetSystemManager().Register<System>();
+
+    auto entities = budget_em.CreateMany<Component_1, Component_2>(200);
+    budget_world.Update();
+
+    const auto& stats      = budget_world.GetLastFrameStats();
+    const auto  num_chunks = stats.tasks[0].num_chunks + stats.tasks[0].num_deferred_chunks;
+    ASSERT_GT(num_chunks, 4);
+    EXPECT_EQ(stats.tasks[0].num_chunks, 2);
+    EXPECT_EQ(stats.tasks[1].num_chunks, 1);
+    EXPECT_EQ(stats.tasks[1].num_deferred_chunks, num_chunks - 1);
+
+    for (std::size_t frame = 1; frame < num_chunks; frame++) {
+        budget_world.Update();
+    }
+    // the sliced task has visited every chunk once or twice, and the other one exactly once
+    for (const auto& entity : entities) {
+        EXPECT_GE(entity.Get<Component_1>().value, 2);
+        EXPECT_LE(entity.Get<Component_1>().value, 3);
+        EXPECT_EQ(entity.Get<Component_2>().value, 3);
+    }
+
+    // the chunks changed during the cycle are visited in the next cycle
+    budget_world.Update();
+    EXPECT_EQ(stats.tasks[1].num_chunks, 1);
+    for (std::size_t frame = 0; frame < num_chunks; frame++) {
+        budget_world.Update();
+    }
+    EXPECT_EQ(entities.back().Get<Component_2>().value, 4);
+}
+
+TEST_F(EcsTest, TaskBudgetCursorIsStable) {
+    World budget_world("TaskBudgetCursorIsStable", {.chunk_size = 1_kB});
+    auto& budget_em = budget_world.GetEntityManager();
+
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Sliced", [](Component_1& c1) { c1.value++; });
+            schedule.SetBudget("Sliced", {.max_chunks = 1});
+        }
+    };
+    budget_world.GetSystemManager().Register<System>();
+
+    // one chunk per archetype
+    std::pmr::vector<Entity> entities;
+    entities.emplace_back(budget_em.CreateMany<Component_1>(1).front());
+    entities.emplace_back(budget_em.CreateMany<Component_1, Component_2>(1).front());
+    entities.emplace_back(budget_em.CreateMany<Component_1, Component_3>(1).front());
+
+    budget_world.Update();
+    ASSERT_EQ(budget_world.GetLastFrameStats().tasks[0].num_deferred_chunks, 2);
+
+    // rehash the archetype map in the middle of the cycle with archetypes the task does not visit
+    for (int i = 0; i < 64; i++) {
+        const auto name = std::pmr::string(fmt::format("Tag_{}", i));
+        budget_em.RegisterDynamicComponent({.name = name, .size = sizeof(int)});
+        std::ignore = budget_em.CreateMany<Component_2>(1, {name});
+    }
+    budget_world.Update();
+    budget_world.Update();
+    EXPECT_EQ(budget_world.GetLastFrameStats().tasks[0].num_deferred_chunks, 0);
+    for (const auto& entity : entities) {
+        EXPECT_EQ(entity.Get<Component_1>().value, 2) << "Every chunk is visited once in a cycle";
+    }
+
+    // the cycle is finished when the remaining chunks are destroyed
+    budget_world.Update();
+    budget_em.Destroy(entities[1]);
+    budget_em.Destroy(entities[2]);
+    budget_world.Update();
+    EXPECT_EQ(entities[0].Get<Component_1>().value, 4);
+}
+
+TEST_F(EcsTest, MemoryReport) {
+    World report_world("MemoryReport", {.chunk_size = 1_kB});
+    auto& report_em = report_world.GetEntityManager();
+
+    auto entities = report_em.CreateMany<Component_1>(100);
+    std::ignore = report_em.CreateMany<Component_1, Component_2>(10);
+    // sparse components are not stored in archetypes
+    entities.front().Emplace<SparseValueComponent>();
+
+    const auto report = report_em.GetMemoryReport();
+    ASSERT_EQ(report.archetypes.size(), 2);
+
+    const auto& archetype = report.archetypes.front();
+    ASSERT_EQ(archetype.components.size(), 2);
+    EXPECT_EQ(archetype.num_entities, 100);
+    EXPECT_EQ(archetype.num_chunks, (100 + archetype.num_entities_per_chunk - 1) / archetype.num_entities_per_chunk);
+    EXPECT_DOUBLE_EQ(archetype.utilization, 100.0 / (archetype.num_chunks * archetype.num_entities_per_chunk));
+
+    std::size_t reserved_bytes = 0;
+    for (const auto& component : archetype.components) {
+        EXPECT_EQ(component.used_bytes, component.component_size * 100);
+        EXPECT_EQ(component.reserved_bytes % 64, 0) << "Columns are aligned";
+        reserved_bytes += component.reserved_bytes;
+    }
+    const auto data_bytes = archetype.num_chunks * archetype.num_entities_per_chunk * (sizeof(Entity) + sizeof(Component_1));
+    EXPECT_EQ(archetype.padding_bytes, archetype.num_chunks * archetype.chunk_size - data_bytes);
+    EXPECT_LE(reserved_bytes, archetype.num_chunks * archetype.chunk_size);
+
+    ASSERT_EQ(report.sparse_components.size(), 1);
+    EXPECT_EQ(report.sparse_components.front().used_bytes, sizeof(SparseValueComponent));
+    EXPECT_GE(report.sparse_components.front().reserved_bytes, sizeof(SparseValueComponent));
+    EXPECT_EQ(report.chunk_pool.used_memory, (archetype.num_chunks + report.archetypes[1].num_chunks) * 1_kB);
+    EXPECT_EQ(report.total_bytes, report.chunk_pool.used_memory + report.chunk_pool.free_memory + report.sparse_components.front().reserved_bytes);
+
+    const auto json = report.ToJson();
+    EXPECT_TRUE(json.starts_with(fmt::format(R"({{"total_bytes":{},)", report.total_bytes)));
+    EXPECT_NE(json.find(R"("num_entities":100,)"), std::pmr::string::npos);
+    EXPECT_NE(json.find(R"("storage":"Sparse")"), std::pmr::string::npos);
+
+    // the page of sparse indices is released with the last component in it
+    const auto page_bytes = report.sparse_components.front().reserved_bytes;
+    entities.front().Remove<SparseValueComponent>();
+    const auto released_report = report_em.GetMemoryReport();
+    ASSERT_EQ(released_report.sparse_components.size(), 1);
+    EXPECT_EQ(released_report.sparse_components.front().used_bytes, 0);
+    EXPECT_EQ(page_bytes - released_report.sparse_components.front().reserved_bytes, 4096 * sizeof(std::uint32_t));
+}
+
+TEST_F(EcsTest, Prefab) {
+    World prefab_world("Prefab", {.chunk_size = 1_kB});
+    auto& prefab_em = prefab_world.GetEntityManager();
+
+    auto outside = prefab_em.Spawn(Component_1{-1});
+    auto root    = prefab_em.Spawn(Component_1{0}, ContainerComponent{"root"}, LinkComponent{outside});
+    auto child_1 = prefab_em.Spawn(Component_1{1}, Component_2{1}, LinkComponent{root});
+    auto child_2 = prefab_em.Spawn(Component_1{2}, Component_2{2}, LinkComponent{child_1});
+    child_2.SetShared(SharedValueComponent{std::make_shared<int>(2)});
+    child_1.Emplace<SparseValueComponent>("sparse");
+
+    const std::array entities{root, child_1, child_2};
+    const auto       prefab = prefab_em.CreatePrefab(entities);
+    EXPECT_EQ(prefab.NumEntities(), 3);
+    // the prefab is a copy of the entities
+    root.Get<ContainerComponent>().value = "changed";
+
+    auto check_instances = [&](std::span<const Entity> instances, std::size_t num) {
+        ASSERT_EQ(instances.size(), num * entities.size());
+        for (std::size_t index = 0; index < num; index++) {
+            const auto instance_root = instances[index * 3];
+            const auto instance_1    = instances[index * 3 + 1];
+            const auto instance_2    = instances[index * 3 + 2];
+            ASSERT_TRUE(instance_root.Valid() && instance_1.Valid() && instance_2.Valid());
+            EXPECT_EQ(instance_root.Get<Entity>(), instance_root);
+            EXPECT_COMPONENT_EQ(instance_root, Component_1, 0);
+            EXPECT_COMPONENT_EQ(instance_2, Component_1, 2);
+            EXPECT_COMPONENT_EQ(instance_1, Component_2, 1);
+            EXPECT_EQ(instance_root.Get<ContainerComponent>().value, "root");
+            EXPECT_EQ(*instance_2.Get<SharedValueComponent>().value, 2);
+            EXPECT_EQ(instance_1.Get<SparseValueComponent>().value, "sparse");
+            EXPECT_FALSE(instance_2.Has<SparseValueComponent>());
+
+            EXPECT_FALSE(instance_root.Get<LinkComponent>().target) << "The link out of prefab is cleared";
+            EXPECT_EQ(instance_1.Get<LinkComponent>().target, instance_root);
+            EXPECT_EQ(instance_2.Get<LinkComponent>().target, instance_1);
+        }
+    };
+
+    // many instances span several chunks
+    const auto instances = prefab_em.Instantiate(prefab, 100);
+    check_instances(instances, 100);
+    EXPECT_EQ(prefab_em.NumEntities(), 4 + 300);
+    EXPECT_EQ(child_2.Get<SharedValueComponent>().value, instances[2].Get<SharedValueComponent>().value);
+
+    // instantiate again after some entities are appended
+    prefab_em.Spawn(Component_1{}, Component_2{});
+    check_instances(prefab_em.Instantiate(prefab, 7), 7);
+
+    // the prefab can be instantiated in other worlds
+    check_instances(em.Instantiate(prefab, 5), 5);
+    EXPECT_EQ(em.NumEntities(), 15);
+
+    EXPECT_THROW(std::ignore = prefab_em.CreatePrefab(std::array{root, root}), std::invalid_argument);
+
+    // dynamic components without copy constructor are copied bitwise
+    prefab_em.RegisterDynamicComponent({.name = "DynamicComponent", .size = sizeof(int)});
+    auto dynamic = prefab_em.CreateMany<Component_1>(1, {"DynamicComponent"}).front();
+    *reinterpret_cast<int*>(dynamic.Get("DynamicComponent")) = 42;
+    const auto dynamic_instance = prefab_em.Instantiate(prefab_em.CreatePrefab(std::array{dynamic}), 1).front();
+    EXPECT_DYNAMIC_COMPONENT_EQ(dynamic_instance, "DynamicComponent", 42);
+}
+
+TEST_F(EcsTest, WorldGroup) {
+    struct System {
+        static void OnUpdate(Schedule& schedule) {
+            schedule.Request("Increase", [](Component_1& c1) { c1.value++; });
+        }
+    };
+
+    hitagi::ecs::WorldGroup group(4);
+    auto&                   server  = group.CreateWorld("WorldGroup-Server");
+    auto&                   game    = group.CreateWorld("WorldGroup-Game", {.priority = 10});
+    auto&                   preview = group.CreateWorld("WorldGroup-Preview", {.priority = -1, .frame_budget = std::chrono::nanoseconds(1)});
+    EXPECT_THROW(group.CreateWorld("WorldGroup-Game"), std::invalid_argument);
+
+    std::pmr::vector<Entity> entities;
+    for (auto world : {&server, &game, &preview}) {
+        world->GetSystemManager().Register<System>();
+        entities.emplace_back(world->GetEntityManager().Spawn(Component_1{0}));
+    }
+
+    // the worlds are read at sync points
+    std::pmr::vector<int> synced_values;
+    group.AddSyncCallback([&](const hitagi::ecs::WorldGroup& synced_group) {
+        EXPECT_EQ(&synced_group.GetWorld("WorldGroup-Server").GetEntityManager(), &server.GetEntityManager());
+        synced_values.emplace_back(std::as_const(entities[0]).Get<Component_1>().value + std::as_const(entities[1]).Get<Component_1>().value);
+    });
+
+    group.Update();
+    const auto& stats = group.GetLastFrameStats();
+    ASSERT_EQ(stats.worlds.size(), 3);
+    EXPECT_EQ(stats.worlds[0].name, "WorldGroup-Game") << "Worlds are sorted by priority";
+    EXPECT_EQ(stats.worlds[1].name, "WorldGroup-Server");
+    EXPECT_EQ(stats.worlds[2].name, "WorldGroup-Preview");
+    EXPECT_TRUE(std::all_of(stats.worlds.begin(), stats.worlds.end(), [](const auto& world_stats) { return world_stats.updated; }));
+    EXPECT_LT(stats.worlds[2].budget_credit.count(), 0) << "The preview world overran its budget";
+    EXPECT_EQ(synced_values, (std::pmr::vector<int>{2}));
+
+    // the preview world is skipped until it pays back the overrun
+    group.Update();
+    EXPECT_FALSE(stats.worlds[2].updated);
+    EXPECT_COMPONENT_EQ(entities[0], Component_1, 2);
+    EXPECT_COMPONENT_EQ(entities[2], Component_1, 1);
+    EXPECT_EQ(synced_values, (std::pmr::vector<int>{2, 4}));
+
+    group.SetWorldConfig("WorldGroup-Preview", {.priority = 20});
+    group.Update();
+    EXPECT_EQ(stats.worlds[0].name, "WorldGroup-Preview");
+    EXPECT_TRUE(stats.worlds[0].updated);
+    EXPECT_COMPONENT_EQ(entities[2], Component_1, 2);
+
+    group.DestroyWorld("WorldGroup-Server");
+    EXPECT_EQ(group.NumWorlds(), 2);
+    EXPECT_THROW(group.GetWorld("WorldGroup-Server"), std::out_of_range);
+}
+
+TEST_F(EcsTest, ArchetypeSignature) {
+    auto entity_1 = em.CreateMany<Component_1, Component_2>(1).front();
+    auto entity_2 = em.CreateMany<Component_2, Component_1>(1).front();
+    auto entity_3 = em.Create();
+    entity_3.Emplace<Component_2>();
+    entity_3.Emplace<Component_1>();
+    EXPECT_EQ(&entity_1.Get<Component_1>() + 1, &entity_2.Get<Component_1>()) << "The order of components does not matter";
+    EXPECT_EQ(&entity_2.Get<Component_1>() + 1, &entity_3.Get<Component_1>()) << "The order of components does not matter";
+
+    // each dynamic component gets its own bit
+    for (std::size_t index = 0; index < 100; index++) {
+        em.RegisterDynamicComponent({.name = std::pmr::string(fmt::format("Tag-{}", index)), .size = sizeof(int)});
+    }
+    std::pmr::vector<Entity> entities;
+    for (std::size_t index = 0; index < 100; index++) {
+        entities.emplace_back(em.CreateMany<Component_1>(1, {fmt::format("Tag-{}", index)}).front());
+    }
+    for (std::size_t index = 0; index < 100; index++) {
+        EXPECT_TRUE(entities[index].Has(fmt::format("Tag-{}", index)));
+        EXPECT_FALSE(entities[index].Has(fmt::format("Tag-{}", (index + 1) % 100)));
+    }
+}
+
+TEST_F(EcsTest, ChunkPoolRecycleChunks) {
+    World pool_world("ChunkPoolRecycleChunks", {.chunk_size = 1_kB, .max_pooled_memory = 4_kB});
+    auto& pool_em = pool_world.GetEntityManager();
+
+    auto entities = pool_em.CreateMany<Component_1>(1000);
+    const auto num_chunks = pool_em.GetChunkPoolStats().num_used_chunks;
+    EXPECT_GT(num_chunks, 4);
+    EXPECT_EQ(pool_em.GetChunkPoolStats().num_allocations, num_chunks);
+
+    for (auto& entity : entities) {
+        pool_em.Destroy(entity);
+    }
+    EXPECT_EQ(pool_em.GetChunkPoolStats().num_used_chunks, 0);
+    EXPECT_EQ(pool_em.GetChunkPoolStats().num_free_chunks, 4) << "Only the chunks in budget are kept";
+    EXPECT_EQ(pool_em.GetChunkPoolStats().free_memory, 4_kB);
+    EXPECT_EQ(pool_em.GetChunkPoolStats().num_deallocations, num_chunks - 4);
+
+    // another archetype with the same chunk size reuses them
+    std::ignore = pool_em.CreateMany<Component_2>(10);
+    EXPECT_EQ(pool_em.GetChunkPoolStats().num_free_chunks, 3);
+    EXPECT_EQ(pool_em.GetChunkPoolStats().num_allocations, num_chunks);
+}
+
+TEST_F(EcsTest, CollectEmptyArchetypes) {
+    World gc_world("CollectEmptyArchetypes", {.empty_archetype_lifetime = 2});
+    auto& gc_em = gc_world.GetEntityManager();
+
+    auto entity = gc_em.Create();
+    entity.Emplace<Component_1>();
+    entity.Emplace<Component_2>();
+    EXPECT_EQ(gc_em.NumArchetypes(), 3);
+
+    gc_world.Update();
+    gc_world.Update();
+    EXPECT_EQ(gc_em.NumArchetypes(), 3) << "Empty archetypes are kept for a while";
+
+    entity.Remove<Component_2>();  // [Entity, Component_1] is used again
+    gc_world.Update();
+    EXPECT_EQ(gc_em.NumArchetypes(), 2);
+    gc_world.Update();
+    EXPECT_EQ(gc_em.NumArchetypes(), 2);
+    gc_world.Update();
+    EXPECT_EQ(gc_em.NumArchetypes(), 1);
+    EXPECT_EQ(entity.Get<Component_1>().value, 1);
+}
+
 int main(int argc, char** argv) {
     spdlog::set_level(spdlog::level::debug);
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,200 @@
+#include <hitagi/ecs/gpu_mirror.hpp>
+#include <hitagi/ecs/world.hpp>
+#include <hitagi/ecs/entity.hpp>
+#include <hitagi/ecs/query.hpp>
+#include <hitagi/utils/test.hpp>
+
+#include <spdlog/spdlog.h>
+
+using namespace hitagi::ecs;
+using namespace hitagi::gfx;
+
+struct GPUPosition {
+    constexpr static bool gpu_mirrored = true;
+    float                 value[4];
+};
+
+struct CPUOnly {
+    int value;
+};
+
+class GPUMirrorTest : public ::testing::Test {
+protected:
+    GPUMirrorTest()
+        : world(::testing::UnitTest::GetInstance()->current_test_info()->name(), {.chunk_size = 1_kB}),
+          em(world.GetEntityManager()),
+          device(Device::Create(Device::Type::Mock)),
+          mirror(em, *device) {}
+
+    auto Spawn(std::size_t num) {
+        return em.SpawnBatch(num, [](std::size_t index) {
+            const auto value = static_cast<float>(index);
+            return std::tuple{GPUPosition{value, value, value, value}, CPUOnly{static_cast<int>(index)}};
+        });
+    }
+
+    // the mock buffer is in host memory, so the whole column can be compared with the chunks
+    void ExpectMirrored() {
+        const auto columns = mirror.GetColumns<GPUPosition>();
+        ASSERT_EQ(columns.size(), 1);
+        const auto& column = columns.front();
+        const auto  data   = column.buffer->Map();
+
+        std::size_t num_entities = 0;
+        for (std::size_t chunk_index = 0; const auto& [positions] : em.Query<const GPUPosition>()) {
+            const auto offset = chunk_index++ * column.num_entities_per_chunk * sizeof(GPUPosition);
+            EXPECT_EQ(std::memcmp(data + offset, positions.data(), positions.size_bytes()), 0) << "The chunk " << chunk_index - 1 << " is not mirrored";
+            num_entities += positions.size();
+        }
+        EXPECT_EQ(column.num_entities, num_entities);
+        column.buffer->UnMap();
+    }
+
+    World                   world;
+    EntityManager&          em;
+    std::unique_ptr<Device> device;
+    GPUMirror               mirror;
+};
+
+TEST_F(GPUMirrorTest, InitialUpload) {
+    Spawn(100);
+    mirror.Upload();
+
+    const auto& stats = mirror.GetLastUploadStats();
+    EXPECT_EQ(stats.num_created_buffers, 1);
+    ASSERT_EQ(stats.ranges.size(), 1) << "All chunks are dirty, so they are uploaded in one range";
+    EXPECT_EQ(stats.ranges.front().component_id, hitagi::utils::TypeID::Create<GPUPosition>());
+    EXPECT_EQ(stats.ranges.front().offset, 0);
+    EXPECT_EQ(stats.ranges.front().size, 100 * sizeof(GPUPosition));
+    EXPECT_EQ(stats.uploaded_bytes, 100 * sizeof(GPUPosition));
+    EXPECT_GE(mirror.GetFence().GetCurrentValue(), mirror.GetFenceValue());
+    ExpectMirrored();
+
+    mirror.Upload();
+    EXPECT_TRUE(mirror.GetLastUploadStats().ranges.empty()) << "Nothing is written since the last upload";
+    EXPECT_EQ(mirror.GetLastUploadStats().uploaded_bytes, 0);
+}
+
+TEST_F(GPUMirrorTest, UploadDirtyChunks) {
+    auto entities = Spawn(100);
+    mirror.Upload();
+
+    const auto num_entities_per_chunk = mirror.GetColumns<GPUPosition>().front().num_entities_per_chunk;
+    ASSERT_LT(2 * num_entities_per_chunk, 100) << "The entities should fill more than two chunks";
+    const auto chunk_bytes = num_entities_per_chunk * sizeof(GPUPosition);
+
+    // the entities are spawned in order, so the entity of index `i` is in the chunk `i / num_entities_per_chunk`
+    auto entity = entities[num_entities_per_chunk + 1];
+    entity.Get<GPUPosition>().value[0] = -1.0f;
+    entity.MarkChanged<GPUPosition>();
+    mirror.Upload();
+    {
+        const auto& ranges = mirror.GetLastUploadStats().ranges;
+        ASSERT_EQ(ranges.size(), 1);
+        EXPECT_EQ(ranges.front().offset, chunk_bytes) << "Only the second chunk is written";
+        EXPECT_EQ(ranges.front().size, chunk_bytes);
+        ExpectMirrored();
+    }
+
+    entity = entities[0];
+    entity.Get<GPUPosition>().value[0] = -2.0f;
+    entity.MarkChanged<GPUPosition>();
+    entity = entities[99];
+    entity.Get<GPUPosition>().value[0] = -3.0f;
+    entity.MarkChanged<GPUPosition>();
+    mirror.Upload();
+    {
+        const auto& ranges     = mirror.GetLastUploadStats().ranges;
+        const auto  last_chunk = 99 / num_entities_per_chunk;
+        ASSERT_EQ(ranges.size(), 2) << "The first and the last chunk are not adjacent";
+        EXPECT_EQ(ranges[0].offset, 0);
+        EXPECT_EQ(ranges[0].size, chunk_bytes);
+        EXPECT_EQ(ranges[1].offset, last_chunk * chunk_bytes);
+        EXPECT_EQ(ranges[1].size, (100 - last_chunk * num_entities_per_chunk) * sizeof(GPUPosition));
+        ExpectMirrored();
+    }
+
+    entity = entities[5];
+    entity.Get<CPUOnly>().value = -1;
+    entity.MarkChanged<CPUOnly>();
+    mirror.Upload();
+    EXPECT_TRUE(mirror.GetLastUploadStats().ranges.empty()) << "Writes of other components are not uploaded";
+}
+
+TEST_F(GPUMirrorTest, UploadAfterQuery) {
+    Spawn(100);
+    mirror.Upload();
+
+    for (const auto& [positions] : em.Query<GPUPosition>()) {
+        for (auto& position : positions) position.value[1] += 1.0f;
+    }
+    mirror.Upload();
+
+    const auto& stats = mirror.GetLastUploadStats();
+    EXPECT_EQ(stats.num_created_buffers, 0);
+    ASSERT_EQ(stats.ranges.size(), 1) << "The adjacent dirty chunks are merged";
+    EXPECT_EQ(stats.ranges.front().size, 100 * sizeof(GPUPosition));
+    ExpectMirrored();
+}
+
+TEST_F(GPUMirrorTest, UploadRelocatedEntity) {
+    auto entities = Spawn(100);
+    mirror.Upload();
+
+    // the last entity is moved to the hole in the first chunk
+    em.Destroy(entities[3]);
+    mirror.Upload();
+
+    const auto& ranges = mirror.GetLastUploadStats().ranges;
+    ASSERT_EQ(ranges.size(), 1);
+    EXPECT_EQ(ranges.front().offset, 0);
+    ExpectMirrored();
+}
+
+TEST_F(GPUMirrorTest, GrowColumn) {
+    Spawn(10);
+    mirror.Upload();
+    EXPECT_EQ(mirror.GetLastUploadStats().num_created_buffers, 1);
+    const auto buffer = mirror.GetColumns<GPUPosition>().front().buffer;
+
+    Spawn(200);
+    mirror.Upload();
+    EXPECT_EQ(mirror.GetLastUploadStats().num_created_buffers, 1) << "The buffer is too small for the new chunks";
+    EXPECT_NE(mirror.GetColumns<GPUPosition>().front().buffer, buffer);
+    EXPECT_EQ(mirror.GetLastUploadStats().uploaded_bytes, 210 * sizeof(GPUPosition)) << "A new buffer is uploaded entirely";
+    ExpectMirrored();
+}
+
+TEST_F(GPUMirrorTest, DestroyedArchetype) {
+    auto entities = Spawn(10);
+    mirror.Upload();
+
+    for (auto& entity : entities) em.Destroy(entity);
+    for (std::size_t index = 0; index <= em.GetChunkConfig().empty_archetype_lifetime; index++) {
+        world.Update();
+    }
+    mirror.Upload();
+    EXPECT_TRUE(mirror.GetColumns<GPUPosition>().empty()) << "The column of the destroyed archetype is released";
+}
+
+TEST_F(GPUMirrorTest, RecreatedArchetype) {
+    auto entities = Spawn(10);
+    mirror.Upload();
+
+    // the new archetype may be allocated at the address of the destroyed one
+    for (auto& entity : entities) em.Destroy(entity);
+    for (std::size_t index = 0; index <= em.GetChunkConfig().empty_archetype_lifetime; index++) {
+        world.Update();
+    }
+    Spawn(10);
+    mirror.Upload();
+    EXPECT_EQ(mirror.GetLastUploadStats().num_created_buffers, 1) << "The column of the new archetype is not the old one";
+    EXPECT_EQ(mirror.GetLastUploadStats().uploaded_bytes, 10 * sizeof(GPUPosition));
+    ExpectMirrored();
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::debug);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -6,4 +6,11 @@ target("ecs_test")
 target("ecs_benchmark")
     add_files("ecs_benchmark.cpp")
     add_deps("ecs", "test_utils")
-    set_group("test/ecs")
\ No newline at end of file
+    -- keep a machine readable result for regression tracking
+    set_runargs("--benchmark_out=ecs_benchmark.json", "--benchmark_out_format=json")
+    set_group("test/ecs")
+
+target("gpu_mirror_test")
+    add_files("gpu_mirror_test.cpp")
+    add_deps("ecs_gpu", "test_utils")
+    set_group("test/ecs")
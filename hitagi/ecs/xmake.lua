@@ -3,4 +3,10 @@ target("ecs")
     add_files("src/*.cpp")
     add_includedirs("include", {public = true})
     add_deps("core", "utils")
-    add_packages("taskflow", {public = true})
\ No newline at end of file
+    add_packages("taskflow", {public = true})
+
+-- the GPU side of ecs, it is split out so that ecs itself does not depend on gfx
+target("ecs_gpu")
+    set_kind("static")
+    add_files("src/gpu/*.cpp")
+    add_deps("ecs", "gfx_device", {public = true})
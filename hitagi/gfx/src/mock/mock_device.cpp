@@ -42,7 +42,11 @@ auto MockDevice::CreateSwapChain(SwapChainDesc desc) -> std::shared_ptr<SwapChai
 }
 
 auto MockDevice::CreateGPUBuffer(GPUBufferDesc desc, std::span<const std::byte> initial_data) -> std::shared_ptr<GPUBuffer> {
-    return std::make_shared<MockGPUBuffer>(*this, std::move(desc));
+    auto buffer = std::make_shared<MockGPUBuffer>(*this, std::move(desc));
+    if (!initial_data.empty()) {
+        std::memcpy(buffer->buffer.GetData(), initial_data.data(), std::min<std::size_t>(initial_data.size(), buffer->Size()));
+    }
+    return buffer;
 }
 
 auto MockDevice::CreateTexture(TextureDesc desc, std::span<const std::byte> initial_data) -> std::shared_ptr<Texture> {
@@ -4,12 +4,15 @@
 #include <hitagi/gfx/command_context.hpp>
 #include <hitagi/gfx/command_queue.hpp>
 
+#include <cstring>
+
 namespace hitagi::gfx {
 
+// the data lives in host memory, so copies and mapping can be checked in tests
 struct MockGPUBuffer : public GPUBuffer {
-    MockGPUBuffer(Device& device, GPUBufferDesc desc) : GPUBuffer(device, std::move(desc)) {}
+    MockGPUBuffer(Device& device, GPUBufferDesc desc) : GPUBuffer(device, std::move(desc)), buffer(Size()) {}
 
-    auto Map() -> std::byte* final { return nullptr; }
+    auto Map() -> std::byte* final { return buffer.GetData(); }
     void UnMap() final {}
 
     core::Buffer buffer;
@@ -100,7 +103,12 @@ struct MockCommandQueue : public CommandQueue {
     void Submit(
         std::span<const std::reference_wrapper<const CommandContext>> contexts,
         std::span<const FenceWaitInfo>                                wait_fences   = {},
-        std::span<const FenceSignalInfo>                              signal_fences = {}) final {}
+        std::span<const FenceSignalInfo>                              signal_fences = {}) final {
+        // commands are executed when they are recorded
+        for (const auto& signal_info : signal_fences) {
+            signal_info.fence.Signal(signal_info.value);
+        }
+    }
     void WaitIdle() final{};
 };
 
@@ -171,7 +179,11 @@ struct MockCopyCommandContext : public CopyCommandContext {
         std::span<const GPUBufferBarrier> buffer_barriers  = {},
         std::span<const TextureBarrier>   texture_barriers = {}) final {}
 
-    void CopyBuffer(const GPUBuffer& src, std::size_t src_offset, GPUBuffer& dst, std::size_t dst_offset, std::size_t size) final {}
+    void CopyBuffer(const GPUBuffer& src, std::size_t src_offset, GPUBuffer& dst, std::size_t dst_offset, std::size_t size) final {
+        std::memcpy(static_cast<MockGPUBuffer&>(dst).buffer.GetData() + dst_offset,
+                    static_cast<const MockGPUBuffer&>(src).buffer.GetData() + src_offset,
+                    size);
+    }
 
     void CopyBufferToTexture(
         const GPUBuffer&        src,
@@ -324,6 +324,55 @@ Matrix<T, D> absolute(const Matrix<T, D>& a) {
     return res;
 }
 
+// Bulk products over arrays like the ones of vectors, 4x4 float and double matrices are computed by ispc kernels.
+// out[i] = mat * vectors[i]
+template <typename T, unsigned D>
+void mul(const Matrix<T, D>& mat, std::span<const Vector<T, D>> vectors, std::span<Vector<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T> && D == 4) {
+        ispc::mat4_mult_vec4(mat, 0, reinterpret_cast<const T*>(vectors.data()), reinterpret_cast<T*>(out.data()), out.size());
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = mat * vectors[i];
+}
+
+// out[i] = matrices[i] * vectors[i]
+template <typename T, unsigned D>
+void mul(std::span<const Matrix<T, D>> matrices, std::span<const Vector<T, D>> vectors, std::span<Vector<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T> && D == 4) {
+        ispc::mat4_mult_vec4(reinterpret_cast<const T*>(matrices.data()), D * D, reinterpret_cast<const T*>(vectors.data()), reinterpret_cast<T*>(out.data()), out.size());
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = matrices[i] * vectors[i];
+}
+
+// out[i] = lhs * rhs[i]
+template <typename T, unsigned D>
+void mul(const Matrix<T, D>& lhs, std::span<const Matrix<T, D>> rhs, std::span<Matrix<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T> && D == 4) {
+        ispc::mat4_mult_mat4(lhs, 0, reinterpret_cast<const T*>(rhs.data()), reinterpret_cast<T*>(out.data()), out.size());
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = lhs * rhs[i];
+}
+
+// out[i] = lhs[i] * rhs[i]
+template <typename T, unsigned D>
+void mul(std::span<const Matrix<T, D>> lhs, std::span<const Matrix<T, D>> rhs, std::span<Matrix<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T> && D == 4) {
+        ispc::mat4_mult_mat4(reinterpret_cast<const T*>(lhs.data()), D * D, reinterpret_cast<const T*>(rhs.data()), reinterpret_cast<T*>(out.data()), out.size());
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = lhs[i] * rhs[i];
+}
+
 template <typename T, unsigned D>
 auto format_as(const Matrix<T, D>& m) { return fmt::join(m.data, ", \n"); }
 
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <iostream>
 #include <array>
+#include <span>
 
 #if defined(USE_ISPC)
 #include "ispc_math.hpp"
@@ -391,6 +392,87 @@ constexpr Vector<T, 3> cross(const Vector<T, 3>& v1, const Vector<T, 3>& v2) {
             v1.x * v2.y - v1.y * v2.x};
 }
 
+// Bulk operations over arrays of vectors, the number of vectors is the size of `out` and the inputs are at least as long.
+// `out` can be one of the inputs. Arrays of float and double vectors are computed by ispc kernels which take a vector per
+// program instance, so the dispatch cost is paid once per array instead of once per vector.
+template <typename T, unsigned D>
+void add(std::span<const Vector<T, D>> lhs, std::span<const Vector<T, D>> rhs, std::span<Vector<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T>) {
+        ispc::vector_add(reinterpret_cast<const T*>(lhs.data()), reinterpret_cast<const T*>(rhs.data()), reinterpret_cast<T*>(out.data()), out.size() * D);
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = lhs[i] + rhs[i];
+}
+
+// multiply component-wise
+template <typename T, unsigned D>
+void mul(std::span<const Vector<T, D>> lhs, std::span<const Vector<T, D>> rhs, std::span<Vector<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T>) {
+        ispc::vector_mult_vector(reinterpret_cast<const T*>(lhs.data()), reinterpret_cast<const T*>(rhs.data()), reinterpret_cast<T*>(out.data()), out.size() * D);
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = lhs[i] * rhs[i];
+}
+
+template <typename T, unsigned D>
+void mul(std::span<const Vector<T, D>> lhs, const T& rhs, std::span<Vector<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T>) {
+        ispc::vector_mult(reinterpret_cast<const T*>(lhs.data()), rhs, reinterpret_cast<T*>(out.data()), out.size() * D);
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = lhs[i] * rhs;
+}
+
+template <typename T, unsigned D>
+void dot(std::span<const Vector<T, D>> lhs, std::span<const Vector<T, D>> rhs, std::span<T> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T>) {
+        ispc::vectors_dot(reinterpret_cast<const T*>(lhs.data()), reinterpret_cast<const T*>(rhs.data()), out.data(), out.size(), D);
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = dot(lhs[i], rhs[i]);
+}
+
+template <typename T>
+void cross(std::span<const Vector<T, 3>> lhs, std::span<const Vector<T, 3>> rhs, std::span<Vector<T, 3>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T>) {
+        ispc::vectors_cross(reinterpret_cast<const T*>(lhs.data()), reinterpret_cast<const T*>(rhs.data()), reinterpret_cast<T*>(out.data()), out.size());
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = cross(lhs[i], rhs[i]);
+}
+
+template <typename T, unsigned D>
+void normalize(std::span<const Vector<T, D>> v, std::span<Vector<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T>) {
+        ispc::vectors_normalize(reinterpret_cast<const T*>(v.data()), reinterpret_cast<T*>(out.data()), out.size(), D);
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = normalize(v[i]);
+}
+
+template <typename T, unsigned D>
+void lerp(std::span<const Vector<T, D>> from, std::span<const Vector<T, D>> to, const T& t, std::span<Vector<T, D>> out) noexcept {
+#if defined(USE_ISPC)
+    if constexpr (IspcAccelerable<T>) {
+        ispc::vector_lerp(reinterpret_cast<const T*>(from.data()), reinterpret_cast<const T*>(to.data()), t, reinterpret_cast<T*>(out.data()), out.size() * D);
+        return;
+    }
+#endif  // USE_ISPC
+    for (std::size_t i = 0; i < out.size(); i++) out[i] = from[i] + (to[i] - from[i]) * t;
+}
+
 template <typename T, unsigned D>
 constexpr Vector<T, D> absolute(const Vector<T, D>& a) {
     Vector<T, D> res;
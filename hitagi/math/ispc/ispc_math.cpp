@@ -1,5 +1,6 @@
 #include "ispc_math.hpp"
 #include "vector.ispc.h"
+#include "matrix.ispc.h"
 
 namespace ispc {
 // float
@@ -42,6 +43,24 @@ void zero(float* data, int32_t size) {
 void vector_inverse(const float* data, float* out, const int32_t size) {
     vector_inverse_float(data, out, size);
 }
+void vector_lerp(const float* a, const float* b, const float t, float* out, const int32_t size) {
+    vector_lerp_float(a, b, t, out, size);
+}
+void vectors_dot(const float* a, const float* b, float* out, const int32_t count, const int32_t dim) {
+    vectors_dot_float(a, b, out, count, dim);
+}
+void vectors_cross(const float* a, const float* b, float* out, const int32_t count) {
+    vectors_cross_float(a, b, out, count);
+}
+void vectors_normalize(const float* data, float* out, const int32_t count, const int32_t dim) {
+    vectors_normalize_float(data, out, count, dim);
+}
+void mat4_mult_vec4(const float* m, const int32_t m_stride, const float* v, float* out, const int32_t count) {
+    mat4_mult_vec4_float(m, m_stride, v, out, count);
+}
+void mat4_mult_mat4(const float* lhs, const int32_t lhs_stride, const float* rhs, float* out, const int32_t count) {
+    mat4_mult_mat4_float(lhs, lhs_stride, rhs, out, count);
+}
 
 // double
 void vector_add_assign(double* a, const double* b, const int32_t size) {
@@ -83,4 +102,22 @@ void zero(double* data, int32_t size) {
 void vector_inverse(const double* data, double* out, const int32_t size) {
     vector_inverse_double(data, out, size);
 }
+void vector_lerp(const double* a, const double* b, const double t, double* out, const int32_t size) {
+    vector_lerp_double(a, b, t, out, size);
+}
+void vectors_dot(const double* a, const double* b, double* out, const int32_t count, const int32_t dim) {
+    vectors_dot_double(a, b, out, count, dim);
+}
+void vectors_cross(const double* a, const double* b, double* out, const int32_t count) {
+    vectors_cross_double(a, b, out, count);
+}
+void vectors_normalize(const double* data, double* out, const int32_t count, const int32_t dim) {
+    vectors_normalize_double(data, out, count, dim);
+}
+void mat4_mult_vec4(const double* m, const int32_t m_stride, const double* v, double* out, const int32_t count) {
+    mat4_mult_vec4_double(m, m_stride, v, out, count);
+}
+void mat4_mult_mat4(const double* lhs, const int32_t lhs_stride, const double* rhs, double* out, const int32_t count) {
+    mat4_mult_mat4_double(lhs, lhs_stride, rhs, out, count);
+}
 };  // namespace ispc
\ No newline at end of file
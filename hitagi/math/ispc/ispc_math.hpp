@@ -22,6 +22,15 @@ void  vector_sub(const float* a, const float* b, float* out, const int32_t size)
 void  zero(float* data, int32_t size);
 void  vector_inverse(const float* data, float* out, const int32_t size);
 
+// arrays of `count` vectors with `dim` components
+void  vector_lerp(const float* a, const float* b, const float t, float* out, const int32_t size);
+void  vectors_dot(const float* a, const float* b, float* out, const int32_t count, const int32_t dim);
+void  vectors_cross(const float* a, const float* b, float* out, const int32_t count);
+void  vectors_normalize(const float* data, float* out, const int32_t count, const int32_t dim);
+// arrays of `count` 4x4 matrices, a stride of 0 applies one matrix to all
+void  mat4_mult_vec4(const float* m, const int32_t m_stride, const float* v, float* out, const int32_t count);
+void  mat4_mult_mat4(const float* lhs, const int32_t lhs_stride, const float* rhs, float* out, const int32_t count);
+
 // double
 void   vector_add_assign(double* a, const double* b, const int32_t size);
 void   vector_add(const double* a, const double* b, double* out, const int32_t size);
@@ -36,4 +45,11 @@ void   vector_sub_assign(double* a, const double* b, const int32_t size);
 void   vector_sub(const double* a, const double* b, double* out, const int32_t size);
 void   zero(double* data, int32_t size);
 void   vector_inverse(const double* data, double* out, const int32_t size);
+
+void   vector_lerp(const double* a, const double* b, const double t, double* out, const int32_t size);
+void   vectors_dot(const double* a, const double* b, double* out, const int32_t count, const int32_t dim);
+void   vectors_cross(const double* a, const double* b, double* out, const int32_t count);
+void   vectors_normalize(const double* data, double* out, const int32_t count, const int32_t dim);
+void   mat4_mult_vec4(const double* m, const int32_t m_stride, const double* v, double* out, const int32_t count);
+void   mat4_mult_mat4(const double* lhs, const int32_t lhs_stride, const double* rhs, double* out, const int32_t count);
 };  // namespace ispc
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include <hitagi/math/transform.hpp>
+#include <hitagi/utils/test.hpp>
+
+#include <random>
+
+using namespace hitagi::math;
+
+// Each operation is measured with a scalar loop over the array and with the bulk function,
+// the argument is the number of vectors or matrices.
+
+template <typename T>
+auto random_array(std::size_t num) {
+    std::mt19937                          engine(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    std::vector<T> result(num);
+    for (auto& item : result) {
+        for (auto scalar = static_cast<float*>(item); scalar != static_cast<float*>(item) + sizeof(T) / sizeof(float); scalar++) {
+            *scalar = distribution(engine);
+        }
+    }
+    return result;
+}
+
+static void Math_AddLoop(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = a[i] + b[i];
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_AddLoop)->Arg(10'000);
+
+static void Math_AddBulk(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        add(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_AddBulk)->Arg(10'000);
+
+static void Math_MulLoop(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = a[i] * b[i];
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_MulLoop)->Arg(10'000);
+
+static void Math_MulBulk(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        mul(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_MulBulk)->Arg(10'000);
+
+static void Math_DotLoop(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<float>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = dot(a[i], b[i]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_DotLoop)->Arg(10'000);
+
+static void Math_DotBulk(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<float>(state.range(0));
+    for (auto _ : state) {
+        dot(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_DotBulk)->Arg(10'000);
+
+static void Math_CrossLoop(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = cross(a[i], b[i]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_CrossLoop)->Arg(10'000);
+
+static void Math_CrossBulk(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        cross(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_CrossBulk)->Arg(10'000);
+
+static void Math_NormalizeLoop(benchmark::State& state) {
+    const auto a   = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = normalize(a[i]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_NormalizeLoop)->Arg(10'000);
+
+static void Math_NormalizeBulk(benchmark::State& state) {
+    const auto a   = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        normalize(std::span<const vec3f>(a), std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_NormalizeBulk)->Arg(10'000);
+
+static void Math_LerpLoop(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = a[i] + (b[i] - a[i]) * 0.5f;
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_LerpLoop)->Arg(10'000);
+
+static void Math_LerpBulk(benchmark::State& state) {
+    const auto a = random_array<vec3f>(state.range(0)), b = random_array<vec3f>(state.range(0));
+    auto       out = std::vector<vec3f>(state.range(0));
+    for (auto _ : state) {
+        lerp(std::span<const vec3f>(a), std::span<const vec3f>(b), 0.5f, std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_LerpBulk)->Arg(10'000);
+
+static void Math_TransformPointsLoop(benchmark::State& state) {
+    const auto matrix  = random_array<mat4f>(1).front();
+    const auto vectors = random_array<vec4f>(state.range(0));
+    auto       out     = std::vector<vec4f>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = matrix * vectors[i];
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_TransformPointsLoop)->Arg(10'000);
+
+static void Math_TransformPointsBulk(benchmark::State& state) {
+    const auto matrix  = random_array<mat4f>(1).front();
+    const auto vectors = random_array<vec4f>(state.range(0));
+    auto       out     = std::vector<vec4f>(state.range(0));
+    for (auto _ : state) {
+        mul(matrix, std::span<const vec4f>(vectors), std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_TransformPointsBulk)->Arg(10'000);
+
+static void Math_MatMulLoop(benchmark::State& state) {
+    const auto lhs = random_array<mat4f>(state.range(0)), rhs = random_array<mat4f>(state.range(0));
+    auto       out = std::vector<mat4f>(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < out.size(); i++) out[i] = lhs[i] * rhs[i];
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_MatMulLoop)->Arg(10'000);
+
+static void Math_MatMulBulk(benchmark::State& state) {
+    const auto lhs = random_array<mat4f>(state.range(0)), rhs = random_array<mat4f>(state.range(0));
+    auto       out = std::vector<mat4f>(state.range(0));
+    for (auto _ : state) {
+        mul(std::span<const mat4f>(lhs), std::span<const mat4f>(rhs), std::span(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Math_MatMulBulk)->Arg(10'000);
+
+BENCHMARK_MAIN();
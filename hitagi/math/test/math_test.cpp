@@ -195,6 +195,76 @@ TEST(ConvertTest, EulerToQuaternion) {
         quatf(-0.092296, 0.4304593, 0.5609855, 0.7010574));
 }
 
+// the sizes are not multiple of the ispc gang size, so the tails of kernels are covered
+TEST(BulkTest, VectorArrays) {
+    std::vector<vec3f> a, b;
+    for (std::size_t i = 0; i < 37; i++) {
+        const auto f = 0.1f * static_cast<float>(i);
+        a.emplace_back(f + 1, 2 * f, -f);
+        b.emplace_back(f, 1.0f, f * f + 1);
+    }
+
+    std::vector<vec3f> out(a.size());
+    std::vector<float> dots(a.size());
+
+    add(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(out));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_VEC_EQ(out[i], a[i] + b[i]);
+
+    mul(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(out));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_VEC_EQ(out[i], a[i] * b[i]);
+
+    mul(std::span<const vec3f>(a), 2.0f, std::span(out));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_VEC_EQ(out[i], a[i] * 2.0f);
+
+    dot(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(dots));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_FLOAT_EQ(dots[i], dot(a[i], b[i]));
+
+    cross(std::span<const vec3f>(a), std::span<const vec3f>(b), std::span(out));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_VEC_EQ(out[i], cross(a[i], b[i]));
+
+    normalize(std::span<const vec3f>(a), std::span(out));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_VEC_EQ(out[i], normalize(a[i]));
+
+    lerp(std::span<const vec3f>(a), std::span<const vec3f>(b), 0.25f, std::span(out));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_VEC_EQ(out[i], a[i] + (b[i] - a[i]) * 0.25f);
+
+    // in place
+    auto expected = a;
+    for (auto& v : expected) v = cross(v, vec3f(0, 0, 1));
+    cross(std::span<const vec3f>(a), std::span<const vec3f>(std::vector<vec3f>(a.size(), vec3f(0, 0, 1))), std::span(a));
+    for (std::size_t i = 0; i < a.size(); i++) EXPECT_VEC_EQ(a[i], expected[i]);
+}
+
+TEST(BulkTest, MatrixArrays) {
+    std::vector<mat4f> matrices;
+    std::vector<vec4f> vectors;
+    for (std::size_t i = 0; i < 37; i++) {
+        const auto f = 0.1f * static_cast<float>(i);
+        matrices.emplace_back(translate(vec3f(f, -f, 1.0f)) * rotate_z(f) * scale(vec3f(1.0f + f)));
+        vectors.emplace_back(f, 1.0f, -f, 1.0f);
+    }
+    const mat4f parent = rotate_x(0.5f) * translate(vec3f(1, 2, 3));
+
+    std::vector<vec4f> vector_out(vectors.size());
+    mul(parent, std::span<const vec4f>(vectors), std::span(vector_out));
+    for (std::size_t i = 0; i < vectors.size(); i++) EXPECT_VEC_EQ(vector_out[i], parent * vectors[i]);
+
+    mul(std::span<const mat4f>(matrices), std::span<const vec4f>(vectors), std::span(vector_out));
+    for (std::size_t i = 0; i < vectors.size(); i++) EXPECT_VEC_EQ(vector_out[i], matrices[i] * vectors[i]);
+
+    std::vector<mat4f> matrix_out(matrices.size());
+    mul(parent, std::span<const mat4f>(matrices), std::span(matrix_out));
+    for (std::size_t i = 0; i < matrices.size(); i++) EXPECT_MAT_EQ(matrix_out[i], parent * matrices[i]);
+
+    std::vector<mat4f> lhs(matrices.rbegin(), matrices.rend());
+    mul(std::span<const mat4f>(lhs), std::span<const mat4f>(matrices), std::span(matrix_out));
+    for (std::size_t i = 0; i < matrices.size(); i++) EXPECT_MAT_EQ(matrix_out[i], lhs[i] * matrices[i]);
+
+    // in place, like updating world matrices from their parents
+    mul(std::span<const mat4f>(lhs), std::span<const mat4f>(matrices), std::span(matrices));
+    for (std::size_t i = 0; i < matrices.size(); i++) EXPECT_MAT_EQ(matrices[i], matrix_out[i]);
+}
+
 TEST(BenchmarkTest, MatrixOperator) {
     mat4f a = {{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}, {13, 14, 15, 16}};
     mat4f b = {{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}, {13, 14, 15, 16}};
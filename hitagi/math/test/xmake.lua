@@ -2,3 +2,8 @@ target("math_test")
     add_files("math_test.cpp")
     add_deps("math", "test_utils")
     set_group("test/math")
+
+target("math_benchmark")
+    add_files("math_benchmark.cpp")
+    add_deps("math", "test_utils")
+    set_group("test/math")
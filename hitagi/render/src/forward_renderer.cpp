@@ -3,6 +3,7 @@
 #include <hitagi/application.hpp>
 #include <hitagi/gfx/utils.hpp>
 #include <hitagi/asset/transform.hpp>
+#include <hitagi/ecs/query.hpp>
 
 #include <imgui.h>
 #include <magic_enum_utility.hpp>
@@ -77,10 +78,12 @@ void ForwardRenderer::RenderScene(std::shared_ptr<asset::Scene> scene, const ass
             true)
         .AddSampler(m_Sampler);
 
-    for (const auto entity : scene->GetMeshEntities()) {
-        const auto mesh      = entity.Get<asset::MeshComponent>().mesh;
-        const auto transform = entity.Get<asset::Transform>().world_matrix;
-        RecordInstance(render_pass_builder, mesh, transform);
+    // the mesh is shared by all entities in a chunk
+    const auto& entity_manager = scene->GetWorld().GetEntityManager();
+    for (const auto& [meshes, transforms] : entity_manager.Query<const asset::MeshComponent, const asset::Transform>()) {
+        for (const auto& transform : transforms) {
+            RecordInstance(render_pass_builder, meshes.front().mesh, transform.world_matrix);
+        }
     }
     UpdateConstantBuffer(render_pass_builder);
 
@@ -98,9 +101,10 @@ void ForwardRenderer::RenderScene(std::shared_ptr<asset::Scene> scene, const ass
         frame_constant.inv_projection = math::inverse(frame_constant.projection);
         frame_constant.inv_proj_view  = math::inverse(frame_constant.proj_view);
 
-        if (!scene->GetLightEntities().empty()) {
-            const auto light           = scene->GetLightEntities().front().Get<asset::LightComponent>().light;
-            const auto light_transform = scene->GetLightEntities().front().Get<asset::Transform>().world_matrix;
+        if (const auto light_query = entity_manager.Query<const asset::LightComponent, const asset::Transform>(); light_query.NumChunks() != 0) {
+            const auto& [lights, light_transforms] = light_query[0];
+            const auto light                       = lights.front().light;
+            const auto light_transform             = light_transforms.front().world_matrix;
 
             frame_constant.light_position    = light_transform.col(3);
             frame_constant.light_pos_in_view = frame_constant.view * frame_constant.light_position;
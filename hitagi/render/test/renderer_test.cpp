@@ -67,6 +67,10 @@ TEST_P(RendererTest, ForwardRenderer) {
             ImGui::DragFloat3("Light Position", light_transform.position, 0.1f);
             ImGui::DragFloat3("Camera Position", camera_transform.position, 0.1f);
             ImGui::DragFloat3("cube Position", cube_transform.position, 0.1f);
+
+            scene->GetLightEntities().front().MarkChanged<asset::Transform>();
+            scene->GetCameraEntities().front().MarkChanged<asset::Transform>();
+            scene->GetMeshEntities().front().MarkChanged<asset::Transform>();
         });
         gui_manager->Tick();
 
@@ -4,6 +4,7 @@
 #include <fmt/format.h>
 
 constexpr std::size_t operator""_kB(unsigned long long val) { return val << 10; }
+constexpr std::size_t operator""_MB(unsigned long long val) { return val << 20; }
 
 namespace hitagi::utils {
 constexpr std::size_t align(size_t x, size_t a) {